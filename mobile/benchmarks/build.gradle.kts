@@ -0,0 +1,92 @@
+import com.android.build.api.attributes.BuildTypeAttr
+import org.jetbrains.kotlin.gradle.tasks.KotlinCompile
+
+plugins {
+   pureKotlinModule
+   alias(libs.plugins.kotlin.allopen)
+   alias(libs.plugins.kotlinx.benchmark)
+}
+
+// JMH benchmarks of the phone-side hot paths. They run on a plain JVM:
+//
+//    ./gradlew :benchmarks:benchmark
+//
+// Results are written as JMH JSON into build/reports/benchmarks/main/<timestamp>/main.json,
+// so runs from different releases can be diffed directly.
+
+allOpen {
+   annotation("org.openjdk.jmh.annotations.State")
+}
+
+benchmark {
+   targets {
+      register("main")
+   }
+
+   configurations {
+      named("main") {
+         warmups = 3
+         iterations = 5
+         iterationTime = 1
+         iterationTimeUnit = "s"
+         reportFormat = "json"
+      }
+
+      register("smoke") {
+         warmups = 1
+         iterations = 1
+         iterationTime = 200
+         iterationTimeUnit = "ms"
+         reportFormat = "json"
+      }
+   }
+}
+
+/**
+ * Benchmarked modules are Android libraries. Benchmarks only need their compiled classes, so consume the plain class
+ * jars of their release variants instead of the AARs.
+ */
+fun ModuleDependency.androidClasses() {
+   attributes {
+      attribute(BuildTypeAttr.ATTRIBUTE, objects.named("release"))
+      attribute(TargetJvmEnvironment.TARGET_JVM_ENVIRONMENT_ATTRIBUTE, objects.named(TargetJvmEnvironment.ANDROID))
+      attribute(Attribute.of("artifactType", String::class.java), "android-classes-jar")
+   }
+}
+
+/**
+ * Make internal declarations of the [module] visible to the benchmarks, so internal hot paths can be benchmarked
+ * directly, without making them public.
+ */
+fun KotlinCompile.addFriendModule(module: ProjectDependency) {
+   val modulePath = module.path
+   friendPaths.from(
+      configurations.compileClasspath.map { classpath ->
+         classpath.incoming.artifactView {
+            componentFilter { it is ProjectComponentIdentifier && it.projectPath == modulePath }
+         }.files
+      }
+   )
+}
+
+tasks.named<KotlinCompile>("compileKotlin") {
+   addFriendModule(projects.notification.data)
+}
+
+dependencies {
+   implementation(projects.bluetooth.data) { androidClasses() }
+   implementation(projects.bluetoothCommon) { androidClasses() }
+   implementation(projects.notification.data) { androidClasses() }
+   implementation(projects.bucketsync.test) { androidClasses() }
+   implementation(testFixtures(projects.common))
+   implementation(testFixtures(projects.rules.api))
+
+   implementation(libs.androidx.datastore.preferences.core)
+   implementation(libs.dispatch)
+   implementation(libs.kotlin.coroutines)
+   implementation(libs.kotlinx.benchmark.runtime)
+
+   // Android framework classes (such as Bitmap) that are referenced by the benchmarked classes.
+   // Benchmarks never construct them, all images are built from synthetic pixel arrays.
+   implementation(libs.unmock.androidJar)
+}
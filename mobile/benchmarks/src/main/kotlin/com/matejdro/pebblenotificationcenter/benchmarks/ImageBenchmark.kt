@@ -0,0 +1,109 @@
+package com.matejdro.pebblenotificationcenter.benchmarks
+
+import com.matejdro.pebblenotificationcenter.bluetooth.images.ImagePixels
+import com.matejdro.pebblenotificationcenter.bluetooth.images.OptimizedPng
+import com.matejdro.pebblenotificationcenter.bluetooth.images.dither
+import com.matejdro.pebblenotificationcenter.bluetooth.images.encodeColorImageIntoBytes
+import com.matejdro.pebblenotificationcenter.bluetooth.images.encodeMonochromeImageIntoBytes
+import com.matejdro.pebblenotificationcenter.bluetooth.images.encodeSmallestColorImage
+import org.openjdk.jmh.annotations.Benchmark
+import org.openjdk.jmh.annotations.BenchmarkMode
+import org.openjdk.jmh.annotations.Mode
+import org.openjdk.jmh.annotations.OutputTimeUnit
+import org.openjdk.jmh.annotations.Param
+import org.openjdk.jmh.annotations.Scope
+import org.openjdk.jmh.annotations.Setup
+import org.openjdk.jmh.annotations.State
+import java.util.concurrent.TimeUnit
+import kotlin.random.Random
+import kotlin.time.Duration
+
+/**
+ * Image pipeline that runs for every picture sent to the watch: dithering into the watch palette and PNG encoding.
+ *
+ * Images are built from synthetic pixel arrays, so no Android [android.graphics.Bitmap] is involved.
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+class ImageBenchmark {
+   /**
+    * Width and height of the image, in pixels
+    */
+   @Param("144x168", "200x228")
+   var size: String = ""
+
+   private lateinit var sourcePixels: IntArray
+   private lateinit var colorImage: ImagePixels
+   private lateinit var monochromeImage: ImagePixels
+   private var width = 0
+   private var height = 0
+
+   @Setup
+   fun setUp() {
+      val (width, height) = size.split("x").map { it.toInt() }
+      this.width = width
+      this.height = height
+
+      sourcePixels = createPhotoLikePixels(width, height)
+      colorImage = ImagePixels(width, height, sourcePixels.copyOf()).dither(toColorScreen = true)
+      monochromeImage = ImagePixels(width, height, sourcePixels.copyOf()).dither(toColorScreen = false)
+   }
+
+   /**
+    * Dithering works in place, so every invocation also copies the source pixels. The copy is a small fraction
+    * of the dithering cost.
+    */
+   @Benchmark
+   fun ditherColor(): ImagePixels {
+      return ImagePixels(width, height, sourcePixels.copyOf()).dither(toColorScreen = true)
+   }
+
+   @Benchmark
+   fun ditherMonochrome(): ImagePixels {
+      return ImagePixels(width, height, sourcePixels.copyOf()).dither(toColorScreen = false)
+   }
+
+   @Benchmark
+   fun encodeColor(): ByteArray {
+      return colorImage.encodeColorImageIntoBytes()
+   }
+
+   @Benchmark
+   fun encodeMonochrome(): ByteArray {
+      return monochromeImage.encodeMonochromeImageIntoBytes()
+   }
+
+   /**
+    * Search through all encoder settings without a time limit, to measure the worst case cost of the search
+    */
+   @Benchmark
+   fun encodeSmallestColor(): OptimizedPng {
+      return colorImage.encodeSmallestColorImage(Duration.INFINITE)
+   }
+}
+
+/**
+ * Create smooth gradients with some noise, which dither and compress similarly to a downscaled photo.
+ */
+private fun createPhotoLikePixels(width: Int, height: Int): IntArray {
+   val random = Random(RANDOM_SEED)
+
+   return IntArray(width * height) { index ->
+      val x = index % width
+      val y = index / width
+
+      val red = (x * CHANNEL_MAX / width + random.nextInt(NOISE)).coerceAtMost(CHANNEL_MAX)
+      val green = (y * CHANNEL_MAX / height + random.nextInt(NOISE)).coerceAtMost(CHANNEL_MAX)
+      val blue = ((x + y) * CHANNEL_MAX / (width + height) + random.nextInt(NOISE)).coerceAtMost(CHANNEL_MAX)
+
+      OPAQUE or (red shl RED_SHIFT) or (green shl GREEN_SHIFT) or blue
+   }
+}
+
+private const val RANDOM_SEED = 1337
+private const val NOISE = 16
+private const val CHANNEL_MAX = 255
+private const val RED_SHIFT = 16
+private const val GREEN_SHIFT = 8
+private const val OPAQUE = 0xFF shl 24
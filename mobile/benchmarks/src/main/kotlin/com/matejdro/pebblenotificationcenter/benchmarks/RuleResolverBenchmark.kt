@@ -0,0 +1,74 @@
+package com.matejdro.pebblenotificationcenter.benchmarks
+
+import com.matejdro.pebblenotificationcenter.notification.ResolvedRules
+import com.matejdro.pebblenotificationcenter.notification.RuleResolver
+import com.matejdro.pebblenotificationcenter.notification.model.ParsedNotification
+import com.matejdro.pebblenotificationcenter.rules.FakeRulesRepository
+import com.matejdro.pebblenotificationcenter.rules.MasterSwitch
+import com.matejdro.pebblenotificationcenter.rules.RuleOption
+import com.matejdro.pebblenotificationcenter.rules.keys.setTo
+import kotlinx.coroutines.runBlocking
+import org.openjdk.jmh.annotations.Benchmark
+import org.openjdk.jmh.annotations.BenchmarkMode
+import org.openjdk.jmh.annotations.Mode
+import org.openjdk.jmh.annotations.OutputTimeUnit
+import org.openjdk.jmh.annotations.Param
+import org.openjdk.jmh.annotations.Scope
+import org.openjdk.jmh.annotations.Setup
+import org.openjdk.jmh.annotations.State
+import java.time.Instant
+import java.util.concurrent.TimeUnit
+
+/**
+ * Rule matching that runs for every notification, with a synthetic set of rules.
+ *
+ * Every tenth rule matches the benchmarked notification's app, the rest target other apps.
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+class RuleResolverBenchmark {
+   /**
+    * Number of rules, including the default settings
+    */
+   @Param("10", "100")
+   var ruleCount: Int = 0
+
+   private lateinit var resolver: RuleResolver
+
+   @Setup
+   fun setUp() = runBlocking {
+      val repository = FakeRulesRepository()
+      repository.insert("Default Settings")
+
+      for (index in 2..ruleCount) {
+         val id = repository.insert("Rule $index")
+         val pkg = if (index % MATCHING_RULE_INTERVAL == 0) NOTIFICATION.pkg else "com.app$index"
+
+         repository.updateRulePreferences(
+            id,
+            RuleOption.conditionAppPackage setTo pkg,
+            RuleOption.masterSwitch setTo MasterSwitch.MUTE
+         )
+      }
+
+      resolver = RuleResolver(repository)
+   }
+
+   @Benchmark
+   fun resolveRules(): ResolvedRules = runBlocking {
+      resolver.resolveRules(NOTIFICATION)
+   }
+}
+
+private const val MATCHING_RULE_INTERVAL = 10
+
+private val NOTIFICATION = ParsedNotification(
+   "key",
+   "com.messenger",
+   "Alice",
+   "Group chat",
+   "Are we still on for lunch tomorrow?",
+   Instant.ofEpochSecond(1_767_554_305),
+   channel = "messages"
+)
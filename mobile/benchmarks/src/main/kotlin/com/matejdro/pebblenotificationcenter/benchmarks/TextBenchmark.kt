@@ -0,0 +1,77 @@
+package com.matejdro.pebblenotificationcenter.benchmarks
+
+import com.matejdro.pebble.bluetooth.common.util.LimitingStringEncoder
+import com.matejdro.pebblenotificationcenter.notification.CompiledRegexReplacements
+import com.matejdro.pebblenotificationcenter.notification.compileRegexReplacements
+import com.matejdro.pebblenotificationcenter.notification.replaceRegexes
+import org.openjdk.jmh.annotations.Benchmark
+import org.openjdk.jmh.annotations.BenchmarkMode
+import org.openjdk.jmh.annotations.Mode
+import org.openjdk.jmh.annotations.OutputTimeUnit
+import org.openjdk.jmh.annotations.Param
+import org.openjdk.jmh.annotations.Scope
+import org.openjdk.jmh.annotations.Setup
+import org.openjdk.jmh.annotations.State
+import java.util.concurrent.TimeUnit
+
+/**
+ * Text processing that runs for every notification: user's regex replacements and size-limited UTF-8 encoding.
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+class TextBenchmark {
+   /**
+    * Length of the notification text, in characters
+    */
+   @Param("200", "2000")
+   var textLength: Int = 0
+
+   private lateinit var text: String
+   private lateinit var compiledReplacements: CompiledRegexReplacements
+   private val encoder = LimitingStringEncoder()
+
+   @Setup
+   fun setUp() {
+      text = SAMPLE_TEXT.repeat(textLength / SAMPLE_TEXT.length + 1).take(textLength)
+      compiledReplacements = compileRegexReplacements(REPLACEMENTS)
+   }
+
+   /**
+    * Regex replacement, including the compilation of all patterns
+    */
+   @Benchmark
+   fun replaceRegexesUncached(): String {
+      return replaceRegexes(text, REPLACEMENTS)
+   }
+
+   /**
+    * Regex replacement with precompiled patterns, as used when the replacement set is cached
+    */
+   @Benchmark
+   fun replaceRegexesCompiled(): String {
+      return compiledReplacements.replace(text)
+   }
+
+   @Benchmark
+   fun encodeSizeLimited(): ByteArray {
+      return encoder.encodeSizeLimited(text, MAX_ENCODED_BYTES, true).encodedString
+   }
+}
+
+private const val SAMPLE_TEXT = "Alice: Are we still on for lunch tomorrow at 12:30? 🍕 " +
+   "Čestitke za novo službo! Call me at +386 40 123 456 or write to alice@example.com.\n\n"
+
+private val REPLACEMENTS = listOf(
+   "\\+?[0-9][0-9 ]{7,}[0-9]" to "<phone>",
+   "[A-Za-z0-9._%+-]+@[A-Za-z0-9.-]+\\.[A-Za-z]{2,}" to "<email>",
+   "\\n{2,}" to "\\n",
+   "(\\d{1,2}):(\\d{2})" to "$1h$2",
+   "(?i)lunch" to "food",
+   "^Alice: " to "",
+   "\\s+$" to "",
+   "Čestitke" to "Congratulations",
+)
+
+// Roughly the space left for the body in a single notification bucket
+private const val MAX_ENCODED_BYTES = 240
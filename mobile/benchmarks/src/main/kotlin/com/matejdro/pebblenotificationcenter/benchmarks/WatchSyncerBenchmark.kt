@@ -0,0 +1,89 @@
+package com.matejdro.pebblenotificationcenter.benchmarks
+
+import androidx.datastore.preferences.core.emptyPreferences
+import com.matejdro.bucketsync.FakeBucketSyncRepository
+import com.matejdro.pebblenotificationcenter.bluetooth.WatchSyncerImpl
+import com.matejdro.pebblenotificationcenter.common.test.InMemoryDataStore
+import com.matejdro.pebblenotificationcenter.notification.model.ParsedNotification
+import com.matejdro.pebblenotificationcenter.notification.model.ProcessedNotification
+import dispatch.core.DefaultCoroutineScope
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.cancel
+import kotlinx.coroutines.runBlocking
+import org.openjdk.jmh.annotations.Benchmark
+import org.openjdk.jmh.annotations.BenchmarkMode
+import org.openjdk.jmh.annotations.Level
+import org.openjdk.jmh.annotations.Mode
+import org.openjdk.jmh.annotations.OutputTimeUnit
+import org.openjdk.jmh.annotations.Param
+import org.openjdk.jmh.annotations.Scope
+import org.openjdk.jmh.annotations.Setup
+import org.openjdk.jmh.annotations.State
+import org.openjdk.jmh.annotations.TearDown
+import java.time.Instant
+import java.util.concurrent.TimeUnit
+
+/**
+ * Encoding of a notification into its watch bucket and its placement into the watch window.
+ *
+ * Fake bucket repository keeps all written buckets in memory, so it is re-created for every iteration.
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+class WatchSyncerBenchmark {
+   /**
+    * Length of the notification body, in characters
+    */
+   @Param("100", "1000")
+   var bodyLength: Int = 0
+
+   private lateinit var scope: DefaultCoroutineScope
+   private lateinit var watchSyncer: WatchSyncerImpl
+   private lateinit var notifications: List<ProcessedNotification>
+   private var nextNotification = 0
+
+   @Setup(Level.Iteration)
+   fun setUp() = runBlocking {
+      scope = DefaultCoroutineScope(SupervisorJob() + Dispatchers.Default)
+
+      val bucketSyncRepository = FakeBucketSyncRepository(BUCKET_SYNC_PROTOCOL_VERSION)
+      watchSyncer = WatchSyncerImpl(bucketSyncRepository, InMemoryDataStore(emptyPreferences()), scope)
+      watchSyncer.init()
+
+      val body = "Are we still on for lunch tomorrow? 🍕\n".repeat(bodyLength).take(bodyLength)
+      notifications = List(ACTIVE_NOTIFICATIONS) { index ->
+         ProcessedNotification(
+            ParsedNotification(
+               "key$index",
+               "com.messenger",
+               "Alice $index",
+               "Group chat",
+               body,
+               Instant.ofEpochSecond(FIRST_NOTIFICATION_TIME + index)
+            )
+         )
+      }
+   }
+
+   @TearDown(Level.Iteration)
+   fun tearDown() {
+      scope.cancel()
+   }
+
+   /**
+    * Sync an update of one of the active notifications
+    */
+   @Benchmark
+   fun syncNotification(): Int = runBlocking {
+      val notification = notifications[nextNotification]
+      nextNotification = (nextNotification + 1) % notifications.size
+
+      watchSyncer.syncNotification(notification, emptyPreferences())
+   }
+}
+
+private const val ACTIVE_NOTIFICATIONS = 50
+private const val BUCKET_SYNC_PROTOCOL_VERSION = 1
+private const val FIRST_NOTIFICATION_TIME = 1_767_554_305L
@@ -5,6 +5,10 @@ class WatchMetadata(
    var colorWatch: Boolean = false,
    var screenWidth: Int = STOCK_PEBBLE_WIDTH,
    var screenHeight: Int = STOCK_PEBBLE_HEIGHT,
+   /**
+    * Whether the watch can decompress packet data (see the "Compression" section of the protocol.md)
+    */
+   var supportsCompression: Boolean = false,
 )
 
 private const val STOCK_PEBBLE_WIDTH = 144
@@ -0,0 +1,19 @@
+package com.matejdro.pebblenotificationcenter.bluetooth
+
+import com.matejdro.pebblenotificationcenter.notification.model.ProcessedNotification
+
+/**
+ * Prepares notification details (the data watch requests when the user opens the notification) ahead of time,
+ * so they can be sent immediately when the watch asks for them.
+ */
+interface NotificationDetailsPrebuilder {
+   /**
+    * Start preparing details of the [notification] in the background. [ProcessedNotification.bucketId] must be set.
+    */
+   fun prebuild(notification: ProcessedNotification)
+
+   /**
+    * Drop any prepared details of the notification in the bucket [bucketId].
+    */
+   fun invalidate(bucketId: Int)
+}
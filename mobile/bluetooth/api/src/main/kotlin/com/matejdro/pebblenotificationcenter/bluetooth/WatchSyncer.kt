@@ -3,6 +3,13 @@ package com.matejdro.pebblenotificationcenter.bluetooth
 import androidx.datastore.preferences.core.Preferences
 import com.matejdro.pebblenotificationcenter.notification.model.ProcessedNotification
 
+/**
+ * Syncs notifications to the watch.
+ *
+ * Watch can only store a limited number of notifications. Syncer keeps a full list of notifications and only stores
+ * a window of them on the watch, that can be moved with [moveWindow]. Notifications outside the window have no
+ * bucket id.
+ */
 interface WatchSyncer {
    suspend fun init()
 
@@ -10,9 +17,41 @@ interface WatchSyncer {
    suspend fun clearNotification(key: String)
 
    /**
-    * @return bucket id of the notification
+    * @return bucket id of the notification or 0 if the notification is outside the window
     */
    suspend fun syncNotification(notification: ProcessedNotification, preferences: Preferences): Int
 
    suspend fun prepareNotificationReadStatus(notification: ProcessedNotification, preferences: Preferences)
+
+   /**
+    * Start a batch of notification changes, that are all written to the watch storage at once, when
+    * [WatchSyncBatch.commit] is called.
+    */
+   fun startBatch(): WatchSyncBatch
+
+   /**
+    * Move the window of notifications stored on the watch, so that it is centered around the notification at the
+    * [selectedIndex] of the full notification list.
+    */
+   suspend fun moveWindow(selectedIndex: Int)
+
+   /**
+    * @return bucket id of the notification with the [key] or *null* if the notification is not on the watch
+    */
+   fun getBucketId(key: String): Int?
+
+   /**
+    * @return key of the notification in the bucket [bucketId] or *null* if there is no such notification
+    */
+   fun getNotificationKey(bucketId: Int): String?
+}
+
+interface WatchSyncBatch {
+   fun stageNotification(notification: ProcessedNotification, preferences: Preferences)
+   fun stageDeletion(key: String)
+
+   /**
+    * @return bucket ids of all staged notifications, by their keys (0 for notifications outside the window)
+    */
+   suspend fun commit(): Map<String, Int>
 }
@@ -1,5 +1,7 @@
 package com.matejdro.pebblenotificationcenter.bluetooth.images
 
+import com.matejdro.pebblenotificationcenter.notification.model.LazyImage
+
 interface ImageSender {
-   suspend fun showImageOnTheWatch(notificationId: UByte, icon: Any, fill: Boolean)
+   suspend fun showImageOnTheWatch(notificationId: UByte, image: LazyImage, fill: Boolean)
 }
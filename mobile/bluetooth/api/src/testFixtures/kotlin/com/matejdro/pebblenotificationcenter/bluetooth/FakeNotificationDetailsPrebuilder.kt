@@ -0,0 +1,16 @@
+package com.matejdro.pebblenotificationcenter.bluetooth
+
+import com.matejdro.pebblenotificationcenter.notification.model.ProcessedNotification
+
+class FakeNotificationDetailsPrebuilder : NotificationDetailsPrebuilder {
+   val prebuiltNotifications = mutableListOf<ProcessedNotification>()
+   val invalidatedBuckets = mutableListOf<Int>()
+
+   override fun prebuild(notification: ProcessedNotification) {
+      prebuiltNotifications.add(notification)
+   }
+
+   override fun invalidate(bucketId: Int) {
+      invalidatedBuckets.add(bucketId)
+   }
+}
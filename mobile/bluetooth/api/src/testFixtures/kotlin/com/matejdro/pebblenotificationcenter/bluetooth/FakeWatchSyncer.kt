@@ -8,6 +8,9 @@ class FakeWatchSyncer : WatchSyncer {
    val syncedNotificationReadStatuses = mutableListOf<ProcessedNotification>()
    val clearedNotifications = mutableListOf<String>()
    var clearAllCalled = false
+   var committedBatches = 0
+   val windowMoves = mutableListOf<Int>()
+   private val bucketIds = HashMap<String, Int>()
 
    var nextBucketId = 1
 
@@ -16,10 +19,12 @@ class FakeWatchSyncer : WatchSyncer {
 
    override suspend fun clearAllNotifications() {
       clearAllCalled = true
+      bucketIds.clear()
    }
 
    override suspend fun clearNotification(key: String) {
       clearedNotifications.add(key)
+      bucketIds.remove(key)
    }
 
    override suspend fun syncNotification(
@@ -27,10 +32,54 @@ class FakeWatchSyncer : WatchSyncer {
       preferences: Preferences,
    ): Int {
       syncedNotifications.add(notification)
-      return nextBucketId++
+      return assignBucketId(notification.systemData.key)
    }
 
    override suspend fun prepareNotificationReadStatus(notification: ProcessedNotification, preferences: Preferences) {
       syncedNotificationReadStatuses.add(notification)
    }
+
+   override fun startBatch(): WatchSyncBatch {
+      return object : WatchSyncBatch {
+         private val stagedNotifications = LinkedHashMap<String, ProcessedNotification>()
+         private val stagedDeletions = LinkedHashSet<String>()
+
+         override fun stageNotification(notification: ProcessedNotification, preferences: Preferences) {
+            stagedDeletions.remove(notification.systemData.key)
+            stagedNotifications[notification.systemData.key] = notification
+         }
+
+         override fun stageDeletion(key: String) {
+            stagedNotifications.remove(key)
+            stagedDeletions.add(key)
+         }
+
+         override suspend fun commit(): Map<String, Int> {
+            committedBatches++
+            clearedNotifications.addAll(stagedDeletions)
+            bucketIds.keys.removeAll(stagedDeletions)
+            syncedNotifications.addAll(stagedNotifications.values)
+            return stagedNotifications.mapValues { assignBucketId(it.key) }
+         }
+      }
+   }
+
+   override suspend fun moveWindow(selectedIndex: Int) {
+      windowMoves.add(selectedIndex)
+   }
+
+   override fun getBucketId(key: String): Int? {
+      return bucketIds[key]
+   }
+
+   override fun getNotificationKey(bucketId: Int): String? {
+      return bucketIds.entries.firstOrNull { it.value == bucketId }?.key
+   }
+
+   private fun assignBucketId(key: String): Int {
+      val bucketId = nextBucketId++
+      bucketIds.values.remove(bucketId)
+      bucketIds[key] = bucketId
+      return bucketId
+   }
 }
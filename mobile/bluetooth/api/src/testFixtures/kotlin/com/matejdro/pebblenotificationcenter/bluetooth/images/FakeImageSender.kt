@@ -1,13 +1,15 @@
 package com.matejdro.pebblenotificationcenter.bluetooth.images
 
+import com.matejdro.pebblenotificationcenter.notification.model.LazyImage
+
 class FakeImageSender : ImageSender {
    var lastSentIcon: Any? = null
    var lastSentNotificationId: UByte? = null
    var lastFilled: Boolean? = null
 
-   override suspend fun showImageOnTheWatch(notificationId: UByte, icon: Any, fill: Boolean) {
+   override suspend fun showImageOnTheWatch(notificationId: UByte, image: LazyImage, fill: Boolean) {
       lastSentNotificationId = notificationId
-      lastSentIcon = icon
+      lastSentIcon = image
       lastFilled = fill
    }
 }
@@ -0,0 +1,205 @@
+package com.matejdro.pebblenotificationcenter.bluetooth
+
+import com.matejdro.pebble.bluetooth.common.util.LimitingStringEncoder
+import com.matejdro.pebble.bluetooth.common.util.fixPebbleIndentation
+import com.matejdro.pebble.bluetooth.common.util.writeUByte
+import com.matejdro.pebble.bluetooth.common.util.writeUShort
+import com.matejdro.pebblenotificationcenter.bluetooth.images.EncodedIconCache
+import com.matejdro.pebblenotificationcenter.bluetooth.images.EncodedIconKey
+import com.matejdro.pebblenotificationcenter.bluetooth.images.IconEncoder
+import com.matejdro.pebblenotificationcenter.notification.ActionOrderRepository
+import com.matejdro.pebblenotificationcenter.notification.model.Action
+import com.matejdro.pebblenotificationcenter.notification.model.ParsedNotification
+import com.matejdro.pebblenotificationcenter.notification.model.ProcessedNotification
+import dev.zacsweers.metro.AppScope
+import dev.zacsweers.metro.ContributesBinding
+import dev.zacsweers.metro.Inject
+import dev.zacsweers.metro.SingleIn
+import dispatch.core.DefaultCoroutineScope
+import io.rebble.pebblekit2.common.model.PebbleDictionary
+import io.rebble.pebblekit2.common.model.PebbleDictionaryItem
+import io.rebble.pebblekit2.common.util.sizeInBytes
+import kotlinx.coroutines.CancellationException
+import kotlinx.coroutines.CoroutineStart
+import kotlinx.coroutines.Deferred
+import kotlinx.coroutines.async
+import kotlinx.coroutines.currentCoroutineContext
+import kotlinx.coroutines.ensureActive
+import logcat.logcat
+import okio.Buffer
+import java.util.concurrent.ConcurrentHashMap
+
+/**
+ * Builds notification details packets (packet 5).
+ *
+ * Packets are built ahead of time, right after the notification is posted, using the watch parameters of the
+ * last details request. Prebuilt packets are only used if the notification, its actions, the action order and
+ * the watch parameters all still match the request.
+ */
+@Inject
+@SingleIn(AppScope::class)
+@ContributesBinding(AppScope::class)
+class NotificationDetailsPacketBuilder(
+   private val actionOrderRepository: ActionOrderRepository,
+   private val iconEncoder: IconEncoder,
+   private val iconCache: EncodedIconCache,
+   private val scope: DefaultCoroutineScope,
+) : NotificationDetailsPrebuilder {
+   private val prebuiltPackets = ConcurrentHashMap<Int, PrebuiltPacket>()
+
+   @Volatile
+   private var lastWatchParameters: WatchParameters? = null
+
+   override fun prebuild(notification: ProcessedNotification) {
+      val watchParameters = lastWatchParameters ?: return
+      val key = createKey(notification, notification.bucketId, watchParameters)
+
+      val packet = scope.async(start = CoroutineStart.LAZY) {
+         buildPacket(notification, key, rememberNewActions = false)
+      }
+      prebuiltPackets.put(notification.bucketId, PrebuiltPacket(key, packet))?.packet?.cancel()
+      packet.start()
+   }
+
+   override fun invalidate(bucketId: Int) {
+      prebuiltPackets.remove(bucketId)?.packet?.cancel()
+   }
+
+   /**
+    * Return details packet of the [notification], using the prebuilt packet if it is still valid.
+    */
+   suspend fun getPacket(
+      notification: ProcessedNotification?,
+      bucketId: Int,
+      maxPacketSize: Int,
+      colorWatch: Boolean,
+   ): PebbleDictionary {
+      val watchParameters = WatchParameters(maxPacketSize, colorWatch)
+      lastWatchParameters = watchParameters
+
+      val key = createKey(notification, bucketId, watchParameters)
+      val prebuilt = prebuiltPackets[bucketId]
+      if (prebuilt != null && prebuilt.key == key) {
+         try {
+            val packet = prebuilt.packet.await()
+
+            // Prebuilding does not remember new actions, so they are remembered once the user actually opens the details
+            actionOrderRepository.sort(notification?.actions.orEmpty().take(MAX_ACTIONS_TO_SEND))
+            return packet
+         } catch (e: CancellationException) {
+            // Only continue if the prebuilding was cancelled, not the caller
+            currentCoroutineContext().ensureActive()
+            logcat { "Prebuilt details for $bucketId were cancelled: ${e.message}" }
+         } catch (e: Exception) {
+            logcat { "Prebuilding details for $bucketId failed: ${e.message}" }
+         }
+      }
+
+      return buildPacket(notification, key, rememberNewActions = true)
+   }
+
+   private fun createKey(
+      notification: ProcessedNotification?,
+      bucketId: Int,
+      watchParameters: WatchParameters,
+   ): PacketKey {
+      return PacketKey(
+         bucketId = bucketId,
+         systemData = notification?.systemData,
+         actions = notification?.actions.orEmpty(),
+         actionOrderVersion = actionOrderRepository.orderVersion,
+         watchParameters = watchParameters,
+      )
+   }
+
+   // Magic numbers are a whole point of this function (protocol constants).
+   // Use is not required for memory-only Buffer
+   @Suppress("MagicNumber", "MissingUseCall")
+   private suspend fun buildPacket(
+      notification: ProcessedNotification?,
+      key: PacketKey,
+      rememberNewActions: Boolean,
+   ): PebbleDictionary {
+      // Packets are built concurrently, so every build needs its own encoder
+      val stringEncoder = LimitingStringEncoder()
+      val buffer = Buffer()
+      buffer.writeUByte(key.bucketId.toUByte())
+
+      val actionsToSend = notification?.actions.orEmpty().take(MAX_ACTIONS_TO_SEND)
+      val sortedActions = actionOrderRepository.sort(actionsToSend, rememberNewActions)
+
+      buffer.writeUByte(sortedActions.size.toUByte())
+
+      for (action in sortedActions) {
+         buffer.writeUByte(action.id)
+         buffer.write(stringEncoder.encodeSizeLimited(action.title, MAX_ACTIONS_TEXT_BYTES).encodedString)
+         buffer.writeUByte(0u)
+      }
+
+      val iconData = notification?.systemData?.let { getIconData(it, key.watchParameters.colorWatch) }
+      if (iconData != null) {
+         buffer.writeUShort(iconData.size.toUShort())
+         buffer.write(iconData)
+      } else {
+         buffer.writeUShort(0u)
+      }
+
+      val packetBeforeText = mapOf(
+         0u to PebbleDictionaryItem.UInt8(5u),
+         1u to PebbleDictionaryItem.Bytes(ByteArray(buffer.size.toInt()))
+      )
+
+      val maxTextSize = key.watchParameters.maxPacketSize - packetBeforeText.sizeInBytes()
+      val encodedText = stringEncoder.encodeSizeLimited(
+         notification?.systemData?.body.orEmpty().fixPebbleIndentation(),
+         maxTextSize
+      ).encodedString
+      buffer.write(encodedText)
+
+      val packet = packetBeforeText + mapOf(
+         1u to PebbleDictionaryItem.Bytes(buffer.readByteArray())
+      )
+
+      logcat { "Built notification details for ${key.bucketId}: ${packet.sizeInBytes()} (${sortedActions.size} actions)" }
+
+      return packet
+   }
+
+   private fun getIconData(notification: ParsedNotification, colorWatch: Boolean): ByteArray? {
+      val icon = notification.icon ?: return null
+
+      // Icon is only loaded when it is not cached yet
+      val encode = {
+         iconEncoder.convertIconToBitmapBytes(icon, ICON_SIZE_PIXELS, ICON_SIZE_PIXELS, colorWatch)
+      }
+
+      val iconId = notification.iconId ?: return encode()
+      val encodedIcon = iconCache.getOrPut(EncodedIconKey(notification.pkg, iconId, ICON_SIZE_PIXELS, colorWatch)) {
+         encode() ?: EMPTY_ICON
+      }
+      return encodedIcon.takeIf { it.isNotEmpty() }
+   }
+
+   private data class WatchParameters(
+      val maxPacketSize: Int,
+      val colorWatch: Boolean,
+   )
+
+   private data class PacketKey(
+      val bucketId: Int,
+      val systemData: ParsedNotification?,
+      val actions: List<Action>,
+      val actionOrderVersion: Int,
+      val watchParameters: WatchParameters,
+   )
+
+   private class PrebuiltPacket(
+      val key: PacketKey,
+      val packet: Deferred<PebbleDictionary>,
+   )
+}
+
+private const val MAX_ACTIONS_TO_SEND = 20
+private const val MAX_ACTIONS_TEXT_BYTES = 20
+private const val ICON_SIZE_PIXELS = 32
+private val EMPTY_ICON = ByteArray(0)
@@ -0,0 +1,103 @@
+package com.matejdro.pebblenotificationcenter.bluetooth
+
+/**
+ * Full list of notifications, ordered by their sort key, with a window of up to [windowSize] notifications
+ * that are stored on the watch.
+ *
+ * Only first [maxSize] notifications can be displayed on the watch. Window stays anchored to the notifications it
+ * contains when other notifications are inserted or removed before it.
+ */
+internal class NotificationWindow<T>(
+   private val windowSize: Int,
+   private val maxSize: Int,
+) {
+   private val entries = ArrayList<Entry<T>>()
+   private val entriesByKey = HashMap<String, Entry<T>>()
+   private val entryComparator = compareBy<Entry<T>>({ it.sortKey }, { it.key })
+
+   var windowStart: Int = 0
+      private set
+
+   /**
+    * Number of notifications that can be displayed on the watch
+    */
+   val size: Int
+      get() = entries.size.coerceAtMost(maxSize)
+
+   operator fun get(key: String): T? {
+      return entriesByKey[key]?.value
+   }
+
+   fun put(key: String, sortKey: Long, value: T) {
+      removeEntry(key)
+
+      val entry = Entry(key, sortKey, value)
+      val searchResult = entries.binarySearch(entry, entryComparator)
+      val index = if (searchResult < 0) -searchResult - 1 else searchResult
+
+      entries.add(index, entry)
+      entriesByKey[key] = entry
+
+      if (index < windowStart) {
+         windowStart++
+      }
+      clampWindow()
+   }
+
+   fun remove(key: String) {
+      removeEntry(key)
+      clampWindow()
+   }
+
+   fun clear() {
+      entries.clear()
+      entriesByKey.clear()
+      windowStart = 0
+   }
+
+   /**
+    * Move the window, so that notification at the [index] is in its center
+    */
+   fun moveTo(index: Int) {
+      windowStart = index - windowSize / 2
+      clampWindow()
+   }
+
+   /**
+    * Move the window by the least amount needed to make notification with the [key] visible
+    */
+   fun ensureVisible(key: String) {
+      val entry = entriesByKey[key] ?: return
+      val index = entries.binarySearch(entry, entryComparator)
+      if (index >= maxSize) {
+         return
+      }
+
+      if (index < windowStart) {
+         windowStart = index
+      } else if (index >= windowStart + windowSize) {
+         windowStart = index - windowSize + 1
+      }
+   }
+
+   fun visibleKeys(): List<String> {
+      return entries.subList(windowStart, (windowStart + windowSize).coerceAtMost(size)).map { it.key }
+   }
+
+   private fun removeEntry(key: String) {
+      val entry = entriesByKey.remove(key) ?: return
+      val index = entries.binarySearch(entry, entryComparator)
+      entries.removeAt(index)
+
+      if (index < windowStart) {
+         windowStart--
+      }
+   }
+
+   private fun clampWindow() {
+      windowStart = windowStart.coerceAtMost(size - windowSize).coerceAtLeast(0)
+   }
+
+   private class Entry<T>(val key: String, val sortKey: Long, val value: T)
+}
+
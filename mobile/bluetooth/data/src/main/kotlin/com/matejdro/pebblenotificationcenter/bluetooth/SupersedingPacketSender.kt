@@ -0,0 +1,126 @@
+package com.matejdro.pebblenotificationcenter.bluetooth
+
+import com.matejdro.pebble.bluetooth.common.PacketQueue
+import com.matejdro.pebble.bluetooth.common.di.WatchappConnectionScope
+import com.matejdro.pebblenotificationcenter.bluetooth.compression.PacketCompressor
+import dev.zacsweers.metro.Inject
+import dev.zacsweers.metro.SingleIn
+import io.rebble.pebblekit2.common.model.PebbleDictionary
+import kotlinx.coroutines.CoroutineStart
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.coroutineScope
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.updateAndGet
+import kotlinx.coroutines.launch
+import logcat.logcat
+
+/**
+ * Sends packets through the [PacketQueue], making sure that only the latest packet of every [PacketSupersessionKey]
+ * is waiting in the queue. Older packets with the same key, that were not sent yet, are dropped from the queue.
+ *
+ * Packets are compressed with the [PacketCompressor] right before they are sent.
+ */
+@Inject
+@SingleIn(WatchappConnectionScope::class)
+class SupersedingPacketSender(
+   private val packetQueue: PacketQueue,
+   private val packetCompressor: PacketCompressor,
+) {
+   private val sendingJobs = HashMap<PacketSupersessionKey, Job>()
+
+   private val _metrics = MutableStateFlow(PacketSupersessionMetrics())
+
+   /**
+    * Counts of superseded and dropped packets. They are also logged whenever they change.
+    */
+   val metrics: StateFlow<PacketSupersessionMetrics> = _metrics
+
+   /**
+    * Send the [packet], superseding any previous packet with the same [key] that was not sent yet.
+    *
+    * @return *true* if the packet was sent, *false* if it was superseded or cancelled before it could be sent
+    */
+   suspend fun sendPacket(key: PacketSupersessionKey, packet: PebbleDictionary, priority: Int): Boolean {
+      return coroutineScope {
+         val sendingJob = launch(start = CoroutineStart.LAZY) {
+            packetQueue.sendPacket(packetCompressor.compress(packet), priority = priority)
+         }
+
+         val previousJob = synchronized(sendingJobs) {
+            sendingJobs.put(key, sendingJob)
+         }
+         if (previousJob != null && previousJob.isActive) {
+            previousJob.cancel()
+            val metrics = _metrics.updateAndGet { it.copy(supersededPackets = it.supersededPackets + 1) }
+            logcat { "Packet $key superseded by a newer one. $metrics" }
+         }
+
+         sendingJob.start()
+         sendingJob.join()
+
+         synchronized(sendingJobs) {
+            if (sendingJobs[key] === sendingJob) {
+               sendingJobs.remove(key)
+            }
+         }
+
+         !sendingJob.isCancelled
+      }
+   }
+
+   /**
+    * Drop the packet with the [key] from the queue, if it was not sent yet.
+    */
+   fun cancel(key: PacketSupersessionKey) {
+      cancelAll { it == key }
+   }
+
+   /**
+    * Drop all packets whose key matches the [filter] from the queue, if they were not sent yet.
+    */
+   fun cancelAll(filter: (PacketSupersessionKey) -> Boolean) {
+      val jobs = synchronized(sendingJobs) {
+         val matchingKeys = sendingJobs.keys.filter(filter)
+         matchingKeys.map { it to sendingJobs.remove(it) }
+      }
+
+      for ((key, job) in jobs) {
+         if (job != null && job.isActive) {
+            job.cancel()
+            val metrics = _metrics.updateAndGet { it.copy(droppedPackets = it.droppedPackets + 1) }
+            logcat { "Packet $key cancelled. $metrics" }
+         }
+      }
+   }
+}
+
+sealed interface PacketSupersessionKey {
+   /**
+    * Details of the notification in the bucket [bucketId]. Details of other notifications are cancelled separately,
+    * when the user moves to another notification.
+    */
+   data class NotificationDetails(val bucketId: Int) : PacketSupersessionKey
+
+   /**
+    * Watch only plays the latest vibration, regardless of the notification
+    */
+   data object Vibration : PacketSupersessionKey
+
+   /**
+    * Image chunks of the notification with the [notificationId]
+    */
+   data class Image(val notificationId: Int) : PacketSupersessionKey
+}
+
+data class PacketSupersessionMetrics(
+   /**
+    * Number of packets that were replaced by a newer packet with the same key before they were sent
+    */
+   val supersededPackets: Int = 0,
+
+   /**
+    * Number of packets that were explicitly cancelled before they were sent
+    */
+   val droppedPackets: Int = 0,
+)
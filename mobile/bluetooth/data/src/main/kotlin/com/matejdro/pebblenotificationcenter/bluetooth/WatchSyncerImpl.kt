@@ -18,15 +18,19 @@ import com.matejdro.pebblenotificationcenter.rules.keys.get
 import dev.zacsweers.metro.AppScope
 import dev.zacsweers.metro.ContributesBinding
 import dev.zacsweers.metro.Inject
+import dev.zacsweers.metro.SingleIn
 import dispatch.core.DefaultCoroutineScope
 import kotlinx.coroutines.flow.debounce
 import kotlinx.coroutines.launch
+import kotlinx.coroutines.sync.Mutex
+import kotlinx.coroutines.sync.withLock
 import logcat.logcat
 import okio.Buffer
 import kotlin.experimental.or
 import kotlin.time.Duration.Companion.milliseconds
 
 @Inject
+@SingleIn(AppScope::class)
 @ContributesBinding(AppScope::class)
 class WatchSyncerImpl(
    private val bucketSyncRepository: BucketSyncRepository,
@@ -35,6 +39,29 @@ class WatchSyncerImpl(
 ) : WatchSyncer {
    private val utf8Encoder = LimitingStringEncoder()
 
+   private val dynamicPool = 2..MAX_BUCKET_ID
+
+   private val windowMutex = Mutex()
+   private val window = NotificationWindow<NotificationBucket>(
+      windowSize = dynamicPool.count(),
+      maxSize = MAX_NOTIFICATIONS_IN_LIST
+   )
+
+   /**
+    * Latest global preferences, written into the bucket 1 together with the window position. *null* until the
+    * preferences are loaded.
+    */
+   private var settingsPreferences: Preferences? = null
+   private var lastSettingsBucketData: ByteArray? = null
+   private val bucketIds = HashMap<String, Int>()
+   private val keysByBucketIds = HashMap<Int, String>()
+
+   /**
+    * Key of the last notification that vibrated (and thus opened the watchapp). When it has to be written to the watch
+    * again (for example when all notifications are reloaded), it is written before all other notifications.
+    */
+   private var triggerKey: String? = null
+
    override suspend fun init() {
       init(enablePreferences = true)
    }
@@ -43,7 +70,7 @@ class WatchSyncerImpl(
    internal suspend fun init(enablePreferences: Boolean) {
       val reloadAllData = !bucketSyncRepository.init(
          BUCKET_DATA_VERSION.toInt(),
-         dynamicPool = 2..MAX_BUCKET_ID
+         dynamicPool = dynamicPool
       )
       if (reloadAllData) {
          logcat { "Got different protocol version, resetting all data" }
@@ -54,14 +81,36 @@ class WatchSyncerImpl(
       }
    }
 
+   override suspend fun syncNotification(notification: ProcessedNotification, preferences: Preferences): Int {
+      logcat { "Syncing notification ${notification.systemData.key} ${notification.systemData.title}" }
+
+      val key = notification.systemData.key
+      val bucket = createBucket(notification, preferences)
+
+      val id = updateWindow(changedKeys = setOf(key), firstKey = key) {
+         window.put(key, bucket.sortKey, bucket)
+         if (notification.vibrated) {
+            triggerKey = key
+            window.ensureVisible(key)
+         }
+      }.getValue(key)
+
+      logcat { "Synced" }
+
+      return id
+   }
+
+   override fun startBatch(): WatchSyncBatch {
+      return Batch()
+   }
+
    // Magic numbers are a whole point of this function (protocol constants).
    // Use is not required for memory-only Buffer
    @Suppress("MagicNumber", "MissingUseCall")
-   override suspend fun syncNotification(notification: ProcessedNotification, preferences: Preferences): Int {
+   private fun createBucket(notification: ProcessedNotification, preferences: Preferences): NotificationBucket {
       val buffer = Buffer()
 
       val notificationData = notification.systemData
-      logcat { "Syncing notification ${notificationData.key} ${notificationData.title}" }
 
       val epochSecond = notificationData.timestamp.epochSecond
       buffer.writeUInt(epochSecond.toUInt())
@@ -95,19 +144,16 @@ class WatchSyncerImpl(
          ).encodedString
       )
 
-      val flags: UByte = getNotificationFlags(notification, preferences)
-
-      val sortKey = -epochSecond * preferences[RuleOption.priority]
-      val id = bucketSyncRepository.updateBucketDynamic(
-         notificationData.key,
-         buffer.readByteArray(),
-         sortKey = sortKey,
-         flags = flags
+      return NotificationBucket(
+         data = buffer.readByteArray(),
+         sortKey = -epochSecond * preferences[RuleOption.priority],
+         flags = getNotificationFlags(notification, preferences),
+         writePriority = when {
+            notification.vibrated -> WRITE_PRIORITY_VIBRATING
+            notification.unread -> WRITE_PRIORITY_UNREAD
+            else -> WRITE_PRIORITY_DEFAULT
+         }
       )
-
-      logcat { "Synced" }
-
-      return id
    }
 
    @Suppress("MagicNumber") // Protocol constants
@@ -130,56 +176,214 @@ class WatchSyncerImpl(
    }
 
    override suspend fun clearAllNotifications() {
-      bucketSyncRepository.clearAllDynamic()
+      windowMutex.withLock {
+         window.clear()
+         synchronized(bucketIds) {
+            bucketIds.clear()
+            keysByBucketIds.clear()
+         }
+         bucketSyncRepository.clearAllDynamic()
+         writeSettingsBucket()
+      }
    }
 
    override suspend fun clearNotification(key: String) {
-      bucketSyncRepository.deleteBucketDynamic(key)
+      updateWindow(changedKeys = emptySet()) {
+         window.remove(key)
+         if (triggerKey == key) {
+            triggerKey = null
+         }
+      }
       logcat { "Deleting Notification $key from the store" }
    }
 
    override suspend fun prepareNotificationReadStatus(notification: ProcessedNotification, preferences: Preferences) {
-      bucketSyncRepository.updateBucketFlagsSilently(
-         id = notification.bucketId.toUByte(),
-         flags = getNotificationFlags(notification, preferences)
-      )
+      val key = notification.systemData.key
+      val flags = getNotificationFlags(notification, preferences)
+
+      windowMutex.withLock {
+         val bucket = window[key] ?: return
+         window.put(key, bucket.sortKey, bucket.withFlags(flags))
+
+         val bucketId = getBucketId(key) ?: return
+         bucketSyncRepository.updateBucketFlagsSilently(id = bucketId.toUByte(), flags = flags)
+      }
    }
 
-   @Suppress("MissingUseCall", "MagicNumber") // Buffer does not need to be closed, protocol constants
-   private fun syncPreferences() {
-      defaultScope.launch {
-         preferenceStore.data.debounce(50.milliseconds).collect { preferences ->
-            var flags: Byte = 0
-            if (preferences[GlobalPreferenceKeys.muteWatch]) {
-               flags = flags or 0x01
+   override suspend fun moveWindow(selectedIndex: Int) {
+      logcat { "Moving notification window to $selectedIndex" }
+      updateWindow(changedKeys = emptySet()) {
+         window.moveTo(selectedIndex)
+      }
+   }
+
+   override fun getBucketId(key: String): Int? {
+      return synchronized(bucketIds) { bucketIds[key] }
+   }
+
+   override fun getNotificationKey(bucketId: Int): String? {
+      return synchronized(bucketIds) { keysByBucketIds[bucketId] }
+   }
+
+   /**
+    * Perform the [change] of the window and write all notifications that entered the window (or were changed
+    * while in the window) to the watch.
+    *
+    * Notification with the [firstKey] (or the last notification that vibrated, if no key is given) is written first,
+    * followed by the rest, ordered by their [NotificationBucket.writePriority].
+    *
+    * @return bucket ids of all [changedKeys] (0 for notifications that are not in the window)
+    */
+   private suspend fun updateWindow(
+      changedKeys: Set<String>,
+      firstKey: String? = null,
+      change: () -> Unit,
+   ): Map<String, Int> {
+      return windowMutex.withLock {
+         val previouslyVisibleKeys = window.visibleKeys().toSet()
+         change()
+         val visibleKeys = window.visibleKeys()
+
+         // Watch maps window buckets to notification indexes with the window start from the bucket 1, so it has to be
+         // written first, to arrive in the same sync as the moved window
+         writeSettingsBucket()
+
+         // Delete first, to free up the bucket IDs for the new notifications
+         for (key in previouslyVisibleKeys - visibleKeys.toSet()) {
+            bucketSyncRepository.deleteBucketDynamic(key)
+            synchronized(bucketIds) {
+               bucketIds.remove(key)?.let { keysByBucketIds.remove(it) }
             }
-            if (preferences[GlobalPreferenceKeys.mutePhone]) {
-               flags = flags or 0x02
+         }
+
+         // Write the most important notifications first, so they are not stuck behind the rest on the way to the watch
+         val keyToWriteFirst = firstKey ?: triggerKey
+         val bucketsToWrite = visibleKeys
+            .filter { it in changedKeys || it !in previouslyVisibleKeys }
+            .mapNotNull { key -> window[key]?.let { key to it } }
+            .sortedWith(
+               compareByDescending<Pair<String, NotificationBucket>> { it.first == keyToWriteFirst }
+                  .thenByDescending { it.second.writePriority }
+            )
+
+         for ((key, bucket) in bucketsToWrite) {
+            val id = bucketSyncRepository.updateBucketDynamic(
+               key,
+               bucket.data,
+               sortKey = bucket.sortKey,
+               flags = bucket.flags
+            )
+            synchronized(bucketIds) {
+               bucketIds.put(key, id)?.let { keysByBucketIds.remove(it) }
+               keysByBucketIds[id] = key
             }
-            if (!preferences[GlobalPreferenceKeys.scrollWrapAround]) {
-               flags = flags or 0x04
+         }
+
+         changedKeys.associateWith { getBucketId(it) ?: 0 }
+      }
+   }
+
+   private inner class Batch : WatchSyncBatch {
+      private val stagedBuckets = LinkedHashMap<String, NotificationBucket>()
+      private val stagedDeletions = LinkedHashSet<String>()
+
+      override fun stageNotification(notification: ProcessedNotification, preferences: Preferences) {
+         val key = notification.systemData.key
+         stagedDeletions.remove(key)
+         stagedBuckets[key] = createBucket(notification, preferences)
+      }
+
+      override fun stageDeletion(key: String) {
+         stagedBuckets.remove(key)
+         stagedDeletions.add(key)
+      }
+
+      override suspend fun commit(): Map<String, Int> {
+         logcat { "Committing ${stagedBuckets.size} notifications and ${stagedDeletions.size} deletions" }
+
+         return updateWindow(changedKeys = stagedBuckets.keys) {
+            for (key in stagedDeletions) {
+               window.remove(key)
             }
-            if (preferences[GlobalPreferenceKeys.turnOnBacklight]) {
-               flags = flags or 0x08
+
+            for ((key, bucket) in stagedBuckets) {
+               window.put(key, bucket.sortKey, bucket)
             }
-            if (preferences[GlobalPreferenceKeys.largeStatusBarFont]) {
-               flags = flags or 0x10
+         }
+      }
+   }
+
+   private fun syncPreferences() {
+      defaultScope.launch {
+         preferenceStore.data.debounce(50.milliseconds).collect { preferences ->
+            windowMutex.withLock {
+               settingsPreferences = preferences
+               writeSettingsBucket()
             }
+         }
+      }
+   }
 
-            val autoClose = preferences[GlobalPreferenceKeys.autoCloseSeconds]
+   /**
+    * Write the global preferences and the window position into the bucket 1, if they changed since the last write.
+    * Must be called while holding the [windowMutex].
+    */
+   @Suppress("MissingUseCall", "MagicNumber") // Buffer does not need to be closed, protocol constants
+   private suspend fun writeSettingsBucket() {
+      val preferences = settingsPreferences ?: return
 
-            val buffer = Buffer()
+      var flags: Byte = 0
+      if (preferences[GlobalPreferenceKeys.muteWatch]) {
+         flags = flags or 0x01
+      }
+      if (preferences[GlobalPreferenceKeys.mutePhone]) {
+         flags = flags or 0x02
+      }
+      if (!preferences[GlobalPreferenceKeys.scrollWrapAround]) {
+         flags = flags or 0x04
+      }
+      if (preferences[GlobalPreferenceKeys.turnOnBacklight]) {
+         flags = flags or 0x08
+      }
+      if (preferences[GlobalPreferenceKeys.largeStatusBarFont]) {
+         flags = flags or 0x10
+      }
 
-            buffer.writeByte(flags.toInt())
-            buffer.writeUShort(autoClose.toUShort())
+      val autoClose = preferences[GlobalPreferenceKeys.autoCloseSeconds]
 
-            bucketSyncRepository.updateBucket(
-               1u,
-               buffer.readByteArray()
-            )
-         }
+      val buffer = Buffer()
+
+      buffer.writeByte(flags.toInt())
+      buffer.writeUShort(autoClose.toUShort())
+      buffer.writeUByte(window.size.toUByte())
+      buffer.writeUByte(window.windowStart.toUByte())
+
+      val data = buffer.readByteArray()
+      if (data.contentEquals(lastSettingsBucketData)) {
+         return
       }
+
+      bucketSyncRepository.updateBucket(1u, data)
+      lastSettingsBucketData = data
    }
 }
 
 private const val MAX_TITLE_TEXT_LENGTH = 20
+
+/**
+ * Number of notifications that the watch can index (and display dots for)
+ */
+private const val MAX_NOTIFICATIONS_IN_LIST = 100
+
+private class NotificationBucket(
+   val data: ByteArray,
+   val sortKey: Long,
+   val flags: UByte,
+   val writePriority: Int,
+) {
+   fun withFlags(flags: UByte) = NotificationBucket(data, sortKey, flags, writePriority)
+}
+
+private const val WRITE_PRIORITY_VIBRATING = 2
+private const val WRITE_PRIORITY_UNREAD = 1
+private const val WRITE_PRIORITY_DEFAULT = 0
@@ -52,6 +52,8 @@ class WatchappConnectionImpl(
    private val watchMetadata: WatchMetadata,
    private val serviceController: NotificationServiceController,
    private val imageSender: ImageSender,
+   private val packetSender: SupersedingPacketSender,
+   private val watchSyncer: WatchSyncer,
 ) : WatchAppConnection {
 
    private var reInitRequestJob: Job? = null
@@ -107,6 +109,11 @@ class WatchappConnectionImpl(
             if (handleResendImageAction(data)) ReceiveResult.Ack else ReceiveResult.Nack
          }
 
+         16u -> {
+            watchSyncer.moveWindow(selectedIndex = data.requireUint(1u).toInt())
+            ReceiveResult.Ack
+         }
+
          else -> {
             logcat { "Unknown packet ID. Nacking..." }
             ReceiveResult.Nack
@@ -152,6 +159,7 @@ class WatchappConnectionImpl(
 
       val flags = data.requireUint(4u)
       watchMetadata.colorWatch = (flags and 0x01u) != 0u
+      watchMetadata.supportsCompression = (flags and 0x02u) != 0u
 
       bucketSyncWatchLoop.sendFirstPacketAndStartLoop(
          mapOfNotNull(
@@ -232,7 +240,7 @@ class WatchappConnectionImpl(
          0u to PebbleDictionaryItem.UInt8(7u),
          1u to PebbleDictionaryItem.Bytes(buffer.readByteArray())
       )
-      packetQueue.sendPacket(packet, priority = PRIORITY_VIBRATION)
+      packetSender.sendPacket(PacketSupersessionKey.Vibration, packet, priority = PRIORITY_VIBRATION)
    }
 
    private suspend fun handleResendImageAction(data: PebbleDictionary): Boolean {
@@ -240,7 +248,7 @@ class WatchappConnectionImpl(
       val fill = data.requireUint(2u) == 1u
       val notification = notificationRepository.getNotification(notificationId.toInt()) ?: return false
       val image = notification.systemData.largeImage ?: return false
-      imageSender.showImageOnTheWatch(notificationId = notificationId.toUByte(), icon = image, fill = fill)
+      imageSender.showImageOnTheWatch(notificationId = notificationId.toUByte(), image = image, fill = fill)
       return true
    }
 
@@ -0,0 +1,127 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.compression
+
+/**
+ * Compress packet data with a small-window LZ77 codec that the watch can decompress without any extra memory
+ * besides the output buffer. See the "Compression" section of the protocol.md for the format.
+ *
+ * Compression is greedy and only remembers the last position of every 3-byte sequence, which is good enough
+ * for the notification text and fast enough to run on every packet.
+ */
+// Numbers are part of the compressed format
+@Suppress("MagicNumber")
+fun compressPacketData(input: ByteArray): ByteArray {
+   require(input.size <= MAX_UNCOMPRESSED_SIZE) { "Data too large to compress: ${input.size}" }
+
+   // Worst case: header + every byte is a literal
+   val output = ByteArray(HEADER_SIZE + input.size + (input.size + MAX_LITERAL_RUN - 1) / MAX_LITERAL_RUN)
+   output[0] = (input.size shr 8).toByte()
+   output[1] = input.size.toByte()
+   var outputPosition = HEADER_SIZE
+
+   fun writeLiterals(from: Int, to: Int) {
+      var start = from
+      while (start < to) {
+         val runLength = minOf(MAX_LITERAL_RUN, to - start)
+         output[outputPosition++] = (runLength - 1).toByte()
+         System.arraycopy(input, start, output, outputPosition, runLength)
+         outputPosition += runLength
+         start += runLength
+      }
+   }
+
+   val lastPositions = IntArray(HASH_TABLE_SIZE) { -1 }
+   var literalStart = 0
+   var position = 0
+   while (position + MIN_MATCH_LENGTH <= input.size) {
+      val hash = input.hashAt(position)
+      val candidate = lastPositions[hash]
+      lastPositions[hash] = position
+
+      var matchLength = 0
+      if (candidate >= 0 && position - candidate <= MAX_OFFSET) {
+         val maxLength = minOf(MAX_MATCH_LENGTH, input.size - position)
+         while (matchLength < maxLength && input[candidate + matchLength] == input[position + matchLength]) {
+            matchLength++
+         }
+      }
+
+      if (matchLength < MIN_MATCH_LENGTH) {
+         position++
+         continue
+      }
+
+      writeLiterals(literalStart, position)
+
+      val offset = position - candidate - 1
+      output[outputPosition++] = (0x80 or ((matchLength - MIN_MATCH_LENGTH) shl 3) or (offset shr 8)).toByte()
+      output[outputPosition++] = offset.toByte()
+
+      for (skipped in position + 1 until minOf(position + matchLength, input.size - MIN_MATCH_LENGTH + 1)) {
+         lastPositions[input.hashAt(skipped)] = skipped
+      }
+
+      position += matchLength
+      literalStart = position
+   }
+
+   writeLiterals(literalStart, input.size)
+
+   return output.copyOf(outputPosition)
+}
+
+/**
+ * Reverse of the [compressPacketData]. Phone never receives compressed data, this mirrors the watch's decoder.
+ */
+// Numbers are part of the compressed format
+@Suppress("MagicNumber")
+fun decompressPacketData(input: ByteArray): ByteArray {
+   require(input.size >= HEADER_SIZE) { "Missing header" }
+
+   val outputSize = ((input[0].toInt() and 0xFF) shl 8) or (input[1].toInt() and 0xFF)
+   val output = ByteArray(outputSize)
+   var outputPosition = 0
+   var inputPosition = HEADER_SIZE
+
+   while (inputPosition < input.size) {
+      val control = input[inputPosition++].toInt() and 0xFF
+      if (control and 0x80 == 0) {
+         val runLength = control + 1
+         System.arraycopy(input, inputPosition, output, outputPosition, runLength)
+         inputPosition += runLength
+         outputPosition += runLength
+      } else {
+         val matchLength = ((control shr 3) and 0x0F) + MIN_MATCH_LENGTH
+         val offset = (((control and 0x07) shl 8) or (input[inputPosition++].toInt() and 0xFF)) + 1
+         require(offset <= outputPosition) { "Offset $offset points before the start of the data" }
+
+         repeat(matchLength) {
+            output[outputPosition] = output[outputPosition - offset]
+            outputPosition++
+         }
+      }
+   }
+
+   require(outputPosition == outputSize) { "Expected $outputSize bytes, got $outputPosition" }
+   return output
+}
+
+@Suppress("MagicNumber") // Hash constants
+private fun ByteArray.hashAt(position: Int): Int {
+   val value = ((this[position].toInt() and 0xFF) shl 16) or
+      ((this[position + 1].toInt() and 0xFF) shl 8) or
+      (this[position + 2].toInt() and 0xFF)
+
+   return (value * HASH_MULTIPLIER) ushr (Int.SIZE_BITS - HASH_BITS)
+}
+
+private const val HEADER_SIZE = 2
+private const val MAX_UNCOMPRESSED_SIZE = 0xFFFF
+
+private const val MAX_LITERAL_RUN = 128
+private const val MIN_MATCH_LENGTH = 3
+private const val MAX_MATCH_LENGTH = MIN_MATCH_LENGTH + 15
+private const val MAX_OFFSET = 2048
+
+private const val HASH_BITS = 12
+private const val HASH_TABLE_SIZE = 1 shl HASH_BITS
+private const val HASH_MULTIPLIER = -0x61c88647 // 0x9E3779B9, golden ratio
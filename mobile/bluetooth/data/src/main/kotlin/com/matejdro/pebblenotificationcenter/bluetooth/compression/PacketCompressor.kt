@@ -0,0 +1,100 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.compression
+
+import com.matejdro.pebble.bluetooth.WatchMetadata
+import com.matejdro.pebble.bluetooth.common.di.WatchappConnectionScope
+import dev.zacsweers.metro.Inject
+import dev.zacsweers.metro.SingleIn
+import io.rebble.pebblekit2.common.model.PebbleDictionary
+import io.rebble.pebblekit2.common.model.PebbleDictionaryItem
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.updateAndGet
+import logcat.logcat
+
+/**
+ * Compresses the data of bulk packets before they are sent to the watch, if the watch supports it.
+ *
+ * Data is only compressed when that makes the packet smaller, so packets never grow.
+ */
+@Inject
+@SingleIn(WatchappConnectionScope::class)
+class PacketCompressor(
+   private val watchMetadata: WatchMetadata,
+) {
+   private val _metrics = MutableStateFlow<Map<UInt, PacketCompressionMetrics>>(emptyMap())
+
+   /**
+    * Compression metrics of every packet type, by packet ID. They are also logged after every packet.
+    */
+   val metrics: StateFlow<Map<UInt, PacketCompressionMetrics>> = _metrics
+
+   fun compress(packet: PebbleDictionary): PebbleDictionary {
+      if (!watchMetadata.supportsCompression) {
+         return packet
+      }
+
+      val packetId = (packet[0u] as? PebbleDictionaryItem.UInt8)?.value?.toUInt() ?: return packet
+      if (packetId !in COMPRESSIBLE_PACKETS) {
+         return packet
+      }
+
+      val data = (packet[DATA_KEY] as? PebbleDictionaryItem.Bytes)?.value ?: return packet
+      val compressedData = compressPacketData(data)
+      val compressed = compressedData.size < data.size
+
+      val metrics = _metrics.updateAndGet { allMetrics ->
+         val previous = allMetrics[packetId] ?: PacketCompressionMetrics()
+         val updated = previous.copy(
+            packets = previous.packets + 1,
+            compressedPackets = previous.compressedPackets + if (compressed) 1 else 0,
+            originalBytes = previous.originalBytes + data.size,
+            sentBytes = previous.sentBytes + if (compressed) compressedData.size else data.size,
+         )
+
+         allMetrics + (packetId to updated)
+      }.getValue(packetId)
+
+      logcat {
+         "Packet $packetId: ${data.size} -> ${if (compressed) compressedData.size else data.size} bytes. " +
+            "Total: ${metrics.originalBytes} -> ${metrics.sentBytes} bytes over ${metrics.packets} packets " +
+            "(ratio ${metrics.compressionRatio})"
+      }
+
+      if (!compressed) {
+         return packet
+      }
+
+      return packet - DATA_KEY + (COMPRESSED_DATA_KEY to PebbleDictionaryItem.Bytes(compressedData))
+   }
+}
+
+data class PacketCompressionMetrics(
+   val packets: Int = 0,
+
+   /**
+    * Number of packets that were sent compressed. Other packets did not get smaller with compression.
+    */
+   val compressedPackets: Int = 0,
+
+   /**
+    * Total size of the packet data before compression
+    */
+   val originalBytes: Long = 0,
+
+   /**
+    * Total size of the packet data that was actually sent
+    */
+   val sentBytes: Long = 0,
+) {
+   val compressionRatio: Double
+      get() = if (originalBytes == 0L) 1.0 else sentBytes.toDouble() / originalBytes
+}
+
+/**
+ * Notification details (5) and image (11). Follow up bucket data (3) is sent by the bucket sync directly,
+ * without going through the compressor.
+ */
+private val COMPRESSIBLE_PACKETS = setOf(5u, 11u)
+
+private const val DATA_KEY = 1u
+private const val COMPRESSED_DATA_KEY = 100u
@@ -2,17 +2,29 @@ package com.matejdro.pebblenotificationcenter.bluetooth.images
 
 import android.content.Context
 import android.graphics.Bitmap
+import android.graphics.BitmapFactory
+import android.graphics.BitmapRegionDecoder
 import android.graphics.Canvas
-import android.graphics.drawable.Drawable
+import android.graphics.Paint
+import android.graphics.Rect
 import android.graphics.drawable.Icon
+import android.net.Uri
+import android.os.Build
 import com.matejdro.pebble.bluetooth.WatchMetadata
 import com.matejdro.pebble.bluetooth.common.di.WatchappConnectionScope
 import dev.zacsweers.metro.ContributesBinding
 import dev.zacsweers.metro.Inject
+import logcat.logcat
+import java.io.IOException
+import java.io.InputStream
+import java.io.OutputStream
+import kotlin.time.Duration.Companion.milliseconds
 
 interface DrawableExtractor {
-   fun convertIconDrawableToBitmapBytes(drawable: Drawable, width: Int, height: Int, colorWatch: Boolean): ByteArray
-   fun convertIconToBitmapBytes(icon: Icon, fill: Boolean): ByteArray
+   /**
+    * Convert the icon into the image that fits the watch screen and write encoded bytes into the [output].
+    */
+   fun convertIconToBitmapBytes(icon: Icon, fill: Boolean, output: OutputStream)
 }
 
 @Inject
@@ -21,86 +33,115 @@ class DrawableExtractorImpl(
    private val context: Context,
    private val watchMetadata: WatchMetadata,
 ) : DrawableExtractor {
-   override fun convertIconDrawableToBitmapBytes(
-      drawable: Drawable,
-      width: Int,
-      height: Int,
-      colorWatch: Boolean,
-   ): ByteArray {
-      val bitmap = Bitmap.createBitmap(width, height, Bitmap.Config.ARGB_8888)
-      val canvas = Canvas(bitmap)
-
-      drawable.setBounds(0, 0, width, height)
-      drawable.draw(canvas)
+   override fun convertIconToBitmapBytes(icon: Icon, fill: Boolean, output: OutputStream) {
+      val downsampledBitmap = if (icon.type == Icon.TYPE_URI) decodeDownsampled(icon.uri, fill) else null
+      val bitmap = downsampledBitmap ?: drawFullDrawable(icon, fill)
 
       val finalImage = ImagePixels(bitmap)
-         .useAlphaAsValues()
+         .dither(toColorScreen = watchMetadata.colorWatch)
 
-      return if (colorWatch) {
-         finalImage
-            .dither(toColorScreen = true)
-            .encodeColorImageIntoBytes()
+      val png = if (watchMetadata.colorWatch) {
+         finalImage.encodeSmallestColorImage(IMAGE_ENCODING_TIME_BUDGET)
       } else {
-         finalImage.encodeMonochromeImageIntoBytes()
+         finalImage.encodeSmallestMonochromeImage(IMAGE_ENCODING_TIME_BUDGET)
       }
+
+      logcat { "Encoded image into ${png.bytes.size} bytes, saved ${png.bytesSaved} bytes with ${png.settings}" }
+      output.write(png.bytes)
    }
 
-   override fun convertIconToBitmapBytes(icon: Icon, fill: Boolean): ByteArray {
+   private fun drawFullDrawable(icon: Icon, fill: Boolean): Bitmap {
       val drawable = icon.loadDrawable(context) ?: error("Drawable cannot be loaded. Icon: $icon")
+      val layout = calculateLayout(drawable.intrinsicWidth, drawable.intrinsicHeight, fill)
 
-      val screenWidth = watchMetadata.screenWidth
-      val screenHeight = watchMetadata.screenHeight
-      val originalWidth: Int = drawable.intrinsicWidth
-      val originalHeight: Int = drawable.intrinsicHeight
-
-      val targetWidth: Int
-      val targetHeight: Int
-      if (fill) {
-         val preCropWidth: Int
-         val preCropHeight: Int
-         if (screenWidth / originalWidth.toFloat() > screenHeight / originalHeight.toFloat()) {
-            preCropWidth = screenWidth
-            preCropHeight = originalHeight * screenWidth / originalWidth
-         } else {
-            preCropWidth = originalWidth * screenHeight / originalHeight
-            preCropHeight = screenHeight
-         }
+      drawable.setBounds(layout.destinationLeft, layout.destinationTop, layout.destinationRight, layout.destinationBottom)
 
-         targetWidth = screenWidth
-         targetHeight = screenHeight
+      val bitmap = Bitmap.createBitmap(layout.targetWidth, layout.targetHeight, Bitmap.Config.ARGB_8888)
+      drawable.draw(Canvas(bitmap))
+      return bitmap
+   }
 
-         val cropX = (preCropWidth - targetWidth) / 2
-         val cropY = (preCropHeight - targetHeight) / 2
-         drawable.setBounds(
-            -cropX,
-            -cropY,
-            screenWidth + cropX,
-            screenHeight + cropY
-         )
-      } else {
-         if (screenWidth / originalWidth.toFloat() < screenHeight / originalHeight.toFloat()) {
-            targetWidth = screenWidth
-            targetHeight = originalHeight * screenWidth / originalWidth
-         } else {
-            targetWidth = originalWidth * screenHeight / originalHeight
-            targetHeight = screenHeight
-         }
+   /**
+    * Content URIs usually point to full resolution camera photos. Instead of decoding the whole photo and scaling it
+    * down, read its size first and only decode the visible region, subsampled to just above the screen size.
+    *
+    * @return decoded image or *null* if the image could not be decoded this way
+    */
+   private fun decodeDownsampled(uri: Uri, fill: Boolean): Bitmap? {
+      val contentResolver = context.contentResolver
+
+      val boundsOptions = BitmapFactory.Options().apply { inJustDecodeBounds = true }
+      contentResolver.openInputStream(uri)?.use { BitmapFactory.decodeStream(it, null, boundsOptions) } ?: return null
+      if (boundsOptions.outWidth <= 0 || boundsOptions.outHeight <= 0) {
+         return null
+      }
 
-         drawable.setBounds(0, 0, targetWidth, targetHeight)
+      val layout = calculateLayout(boundsOptions.outWidth, boundsOptions.outHeight, fill)
+      val decodeOptions = BitmapFactory.Options().apply {
+         inSampleSize = layout.calculateSampleSize()
+         inPreferredConfig = Bitmap.Config.ARGB_8888
       }
 
-      val bitmap = Bitmap.createBitmap(targetWidth, targetHeight, Bitmap.Config.ARGB_8888)
-      val canvas = Canvas(bitmap)
+      val visibleRegion = Rect(layout.cropLeft, layout.cropTop, layout.cropRight, layout.cropBottom)
+      val regionBitmap = if (layout.isCropped) {
+         contentResolver.openInputStream(uri)?.use { decodeRegion(it, visibleRegion, decodeOptions) }
+      } else {
+         null
+      }
 
-      drawable.draw(canvas)
+      val source: Bitmap
+      val sourceRegion: Rect
+      if (regionBitmap != null) {
+         source = regionBitmap
+         sourceRegion = Rect(0, 0, regionBitmap.width, regionBitmap.height)
+      } else {
+         // Region decoding is not supported for all formats. Decode the whole subsampled image and crop it while drawing.
+         source = contentResolver.openInputStream(uri)?.use { BitmapFactory.decodeStream(it, null, decodeOptions) }
+            ?: return null
+         val sampleSize = decodeOptions.inSampleSize
+         sourceRegion = Rect(
+            visibleRegion.left / sampleSize,
+            visibleRegion.top / sampleSize,
+            visibleRegion.right / sampleSize,
+            visibleRegion.bottom / sampleSize
+         )
+      }
 
-      val finalImage = ImagePixels(bitmap)
-         .dither(toColorScreen = watchMetadata.colorWatch)
+      val bitmap = Bitmap.createBitmap(layout.targetWidth, layout.targetHeight, Bitmap.Config.ARGB_8888)
+      Canvas(bitmap).drawBitmap(
+         source,
+         sourceRegion,
+         Rect(0, 0, layout.targetWidth, layout.targetHeight),
+         Paint(Paint.FILTER_BITMAP_FLAG)
+      )
+      source.recycle()
 
-      return if (watchMetadata.colorWatch) {
-         finalImage.encodeColorImageIntoBytes()
-      } else {
-         finalImage.encodeMonochromeImageIntoBytes()
+      return bitmap
+   }
+
+   private fun decodeRegion(stream: InputStream, region: Rect, options: BitmapFactory.Options): Bitmap? {
+      val decoder = try {
+         if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.S) {
+            BitmapRegionDecoder.newInstance(stream)
+         } else {
+            @Suppress("DEPRECATION")
+            BitmapRegionDecoder.newInstance(stream, false)
+         }
+      } catch (e: IOException) {
+         logcat { "Region decoding not supported: ${e.message}" }
+         return null
+      } ?: return null
+
+      return try {
+         decoder.decodeRegion(region, options)
+      } finally {
+         decoder.recycle()
       }
    }
+
+   private fun calculateLayout(sourceWidth: Int, sourceHeight: Int, fill: Boolean): ImageLayout {
+      return ImageLayout.calculate(sourceWidth, sourceHeight, watchMetadata.screenWidth, watchMetadata.screenHeight, fill)
+   }
 }
+
+private val IMAGE_ENCODING_TIME_BUDGET = 100.milliseconds
@@ -0,0 +1,170 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.images
+
+import android.content.Context
+import android.util.LruCache
+import dev.zacsweers.metro.AppScope
+import dev.zacsweers.metro.ContributesBinding
+import dev.zacsweers.metro.Inject
+import dev.zacsweers.metro.SingleIn
+import logcat.logcat
+import okio.ByteString.Companion.encodeUtf8
+import java.io.File
+import java.io.IOException
+import java.util.concurrent.TimeUnit
+import java.util.concurrent.atomic.AtomicBoolean
+import java.util.concurrent.atomic.AtomicInteger
+
+/**
+ * Cache of icons that were already encoded into the watch format, so re-opening notifications from the same app
+ * does not need to render and encode the same icon again.
+ */
+interface EncodedIconCache {
+   /**
+    * Return the cached icon for the [key] or encode it with the [encode] and cache it.
+    *
+    * Empty results mark icons that could not be loaded. They are only cached in memory, since the failure
+    * might be temporary (for example, while the app is being updated).
+    */
+   fun getOrPut(key: EncodedIconKey, encode: () -> ByteArray): ByteArray
+}
+
+data class EncodedIconKey(
+   val pkg: String,
+   /**
+    * Identity of the icon, that does not change between notifications (for example, its resource ID and the version
+    * of the app that owns the resource)
+    */
+   val iconId: String,
+   val size: Int,
+   val colorWatch: Boolean,
+)
+
+@SingleIn(AppScope::class)
+@ContributesBinding(AppScope::class)
+class EncodedIconCacheImpl(
+   /**
+    * Folder where encoded icons are persisted across process restarts. When null, icons are only cached in memory.
+    */
+   private val diskCacheFolder: File?,
+   maxMemoryBytes: Int = DEFAULT_MAX_MEMORY_BYTES,
+   private val diskCacheExpiryMillis: Long = DEFAULT_DISK_CACHE_EXPIRY_MILLIS,
+   private val maxDiskBytes: Long = DEFAULT_MAX_DISK_BYTES,
+   private val currentTimeMillis: () -> Long = System::currentTimeMillis,
+) : EncodedIconCache {
+   @Inject
+   constructor(context: Context) : this(File(context.cacheDir, ICON_CACHE_FOLDER_NAME))
+
+   private val memoryCache = object : LruCache<EncodedIconKey, ByteArray>(maxMemoryBytes) {
+      override fun sizeOf(key: EncodedIconKey, value: ByteArray): Int {
+         return value.size
+      }
+   }
+
+   private val initialSweepDone = AtomicBoolean(false)
+   private val writesSinceSweep = AtomicInteger(0)
+
+   override fun getOrPut(key: EncodedIconKey, encode: () -> ByteArray): ByteArray {
+      memoryCache.get(key)?.let { return it }
+
+      if (diskCacheFolder != null && initialSweepDone.compareAndSet(false, true)) {
+         sweepDiskCache(diskCacheFolder)
+      }
+
+      val file = diskCacheFolder?.let { File(it, key.fileName()) }
+      val bytes = file?.let(::readFromDisk) ?: encode().also { encoded ->
+         if (file != null && encoded.isNotEmpty()) {
+            writeToDisk(file, encoded)
+         }
+      }
+
+      memoryCache.put(key, bytes)
+      return bytes
+   }
+
+   private fun readFromDisk(file: File): ByteArray? {
+      if (!file.exists()) {
+         return null
+      }
+
+      // Icon might have changed with the app update, so do not keep using old files forever
+      if (currentTimeMillis() - file.lastModified() > diskCacheExpiryMillis) {
+         file.delete()
+         return null
+      }
+
+      return try {
+         file.readBytes()
+      } catch (e: IOException) {
+         logcat { "Failed to read cached icon ${file.name}: ${e.message}" }
+         null
+      }
+   }
+
+   private fun writeToDisk(file: File, bytes: ByteArray) {
+      try {
+         file.parentFile?.mkdirs()
+
+         // Write to a temporary file first, so a process death mid-write cannot leave a corrupted icon behind.
+         // Every write gets its own temporary file, so concurrent writes of the same icon do not mix their bytes.
+         val temporaryFile = File.createTempFile(file.name, TEMPORARY_FILE_SUFFIX, file.parentFile)
+         temporaryFile.writeBytes(bytes)
+         if (!temporaryFile.renameTo(file)) {
+            temporaryFile.delete()
+         }
+      } catch (e: IOException) {
+         logcat { "Failed to cache icon ${file.name}: ${e.message}" }
+      }
+
+      if (writesSinceSweep.incrementAndGet() >= WRITES_BETWEEN_SWEEPS) {
+         writesSinceSweep.set(0)
+         file.parentFile?.let(::sweepDiskCache)
+      }
+   }
+
+   /**
+    * Delete expired icons, that are never read again (for example, icons of the previous app versions) and
+    * temporary files left behind by a process death. Then delete the oldest icons until the cache fits into
+    * the [maxDiskBytes].
+    */
+   @Synchronized
+   private fun sweepDiskCache(folder: File) {
+      val now = currentTimeMillis()
+      val files = folder.listFiles() ?: return
+
+      val remainingFiles = files.filter { file ->
+         val age = now - file.lastModified()
+         val isTemporary = file.name.endsWith(TEMPORARY_FILE_SUFFIX)
+         val delete = if (isTemporary) age > TEMPORARY_FILE_MAX_AGE_MILLIS else age > diskCacheExpiryMillis
+
+         if (delete) {
+            file.delete()
+         }
+         !delete && !isTemporary
+      }.sortedBy { it.lastModified() }
+
+      var totalBytes = remainingFiles.sumOf { it.length() }
+      for (file in remainingFiles) {
+         if (totalBytes <= maxDiskBytes) {
+            break
+         }
+
+         totalBytes -= file.length()
+         file.delete()
+      }
+
+      logcat { "Swept icon cache: ${files.size} files before, $totalBytes bytes left" }
+   }
+
+   private fun EncodedIconKey.fileName(): String {
+      val colorSuffix = if (colorWatch) "color" else "bw"
+      return "${toString().encodeUtf8().sha256().hex()}_${size}_$colorSuffix.png"
+   }
+}
+
+private const val ICON_CACHE_FOLDER_NAME = "encoded_icons"
+private const val TEMPORARY_FILE_SUFFIX = ".tmp"
+private const val DEFAULT_MAX_MEMORY_BYTES = 256 * 1024
+private const val DEFAULT_MAX_DISK_BYTES = 2L * 1024 * 1024
+private const val WRITES_BETWEEN_SWEEPS = 50
+private val TEMPORARY_FILE_MAX_AGE_MILLIS = TimeUnit.MINUTES.toMillis(1)
+private val DEFAULT_DISK_CACHE_EXPIRY_MILLIS = TimeUnit.DAYS.toMillis(7)
@@ -1,99 +1,238 @@
 package com.matejdro.pebblenotificationcenter.bluetooth.images
 
-import android.graphics.Color
 import ar.com.hjg.pngj.ImageInfo
 import ar.com.hjg.pngj.ImageLineByte
 import ar.com.hjg.pngj.PngWriter
 import java.io.ByteArrayOutputStream
+import java.io.OutputStream
+import kotlin.time.Duration
+import kotlin.time.TimeSource
 
 /**
  * Encode a monochrome image into a grayscale PNG.
  */
 fun ImagePixels.encodeMonochromeImageIntoBytes(): ByteArray {
+   @Suppress("MissingUseCall") // ByteArrayOutputStream does not need to be closed
+   val byteStream = ByteArrayOutputStream(estimateEncodedSize(MONOCHROME_BIT_DEPTH, paletteEntries = 0))
+   encodeMonochromeImage(byteStream)
+   return byteStream.toByteArray()
+}
+
+/**
+ * Encode a monochrome image into the smallest grayscale PNG that can be found within the [timeBudget].
+ */
+fun ImagePixels.encodeSmallestMonochromeImage(
+   timeBudget: Duration,
+   timeSource: TimeSource = TimeSource.Monotonic,
+): OptimizedPng {
+   val estimatedSize = estimateEncodedSize(MONOCHROME_BIT_DEPTH, paletteEntries = 0)
+   return encodeSmallest(estimatedSize, timeBudget, timeSource) { output, settings -> encodeMonochromeImage(output, settings) }
+}
+
+/**
+ * Encode a monochrome image into a grayscale PNG, writing the bytes into the [output] as they get compressed.
+ */
+fun ImagePixels.encodeMonochromeImage(output: OutputStream, settings: PngSettings = PngSettings.DEFAULT) {
    val imageInfo: ImageInfo = ImageInfo(
       /* cols = */ width,
       /* rows = */ height,
-      /* bitdepth = */ 1,
+      /* bitdepth = */ MONOCHROME_BIT_DEPTH,
       /* alpha = */ false,
       /* grayscale = */ true,
       /* indexed = */ false
    )
 
-   @Suppress("MissingUseCall") // ByteArrayOutputStream does not need to be closed
-   val byteStream = ByteArrayOutputStream()
-   val pngWriter = PngWriter(byteStream, imageInfo)
+   val pngWriter = PngWriter(output, imageInfo)
+   pngWriter.applySettings(settings)
+   val imageLine = ImageLineByte(imageInfo)
+   val scanline = imageLine.getScanline()
 
    for (y in 0..<height) {
-      val imageLine = ImageLineByte(imageInfo)
       for (x in 0..<width) {
-         val pixel: Int = this[x, y]
-         val color = Color.red(pixel)
+         val red = (this[x, y] shr RED_SHIFT) and CHANNEL_MASK
 
-         imageLine.getScanline()[x] = (if (color > BLACK_THRESHOLD) 1 else 0).toByte()
+         scanline[x] = (if (red > BLACK_THRESHOLD) 1 else 0).toByte()
       }
 
       pngWriter.writeRow(imageLine, y)
    }
 
    pngWriter.end()
-   return byteStream.toByteArray()
 }
 
 /**
  * Encode an image in Pebble colors into color indexed PNG
  */
-@Suppress("MagicNumber") // PNG constants
 fun ImagePixels.encodeColorImageIntoBytes(): ByteArray {
    @Suppress("MissingUseCall") // ByteArrayOutputStream does not need to be closed
-   val byteStream = ByteArrayOutputStream()
+   val byteStream = ByteArrayOutputStream(estimateEncodedSize(MAX_COLOR_BIT_DEPTH, PEBBLE_PALETTE_SIZE))
+   encodeColorImage(byteStream)
+   return byteStream.toByteArray()
+}
+
+/**
+ * Encode an image in Pebble colors into the smallest color indexed PNG that can be found within the [timeBudget].
+ */
+fun ImagePixels.encodeSmallestColorImage(
+   timeBudget: Duration,
+   timeSource: TimeSource = TimeSource.Monotonic,
+): OptimizedPng {
+   val estimatedSize = estimateEncodedSize(MAX_COLOR_BIT_DEPTH, PEBBLE_PALETTE_SIZE)
+   return encodeSmallest(estimatedSize, timeBudget, timeSource) { output, settings -> encodeColorImage(output, settings) }
+}
+
+/**
+ * Encode an image in Pebble colors into color indexed PNG, writing the bytes into the [output]
+ * as they get compressed.
+ *
+ * Palette only contains the colors that are used in the image and the bit depth is the smallest one that can
+ * index all of them.
+ */
+fun ImagePixels.encodeColorImage(output: OutputStream, settings: PngSettings = PngSettings.DEFAULT) {
+   val pebbleIndexes = ByteArray(width * height)
+   // Maps Pebble palette indexes to the indexes in the PNG palette, -1 for unused colors
+   val pngIndexes = IntArray(PEBBLE_PALETTE_SIZE) { -1 }
+
+   for (y in 0..<height) {
+      for (x in 0..<width) {
+         val pixel: Int = this[x, y] and RGB_MASK
+         val index = pebblePaletteIndexOf(pixel)
+
+         require(index >= 0) { "Color is not supported by Pebble Time: " + Integer.toHexString(pixel) }
+
+         pebbleIndexes[y * width + x] = index.toByte()
+         pngIndexes[index] = 0
+      }
+   }
+
+   var colorCount = 0
+   for (i in 0..<PEBBLE_PALETTE_SIZE) {
+      if (pngIndexes[i] >= 0) {
+         pngIndexes[i] = colorCount++
+      }
+   }
+
    val imageInfo = ImageInfo(
       /* cols = */ width,
       /* rows = */ height,
-      /* bitdepth = */ 8,
+      /* bitdepth = */ indexedBitDepth(colorCount),
       /* alpha = */ false,
       /* grayscale = */ false,
       /* indexed = */ true
    )
-   val pngWriter = PngWriter(byteStream, imageInfo)
+   val pngWriter = PngWriter(output, imageInfo)
+   pngWriter.applySettings(settings)
 
    val paletteChunk = pngWriter.getMetadata().createPLTEChunk()
-   paletteChunk.setNentries(64)
-   for (i in 0..63) {
+   paletteChunk.setNentries(colorCount)
+   for (i in 0..<PEBBLE_PALETTE_SIZE) {
+      val pngIndex = pngIndexes[i]
+      if (pngIndex < 0) {
+         continue
+      }
+
       val color: Int = PEBBLE_TIME_PALETTE[i]
-      paletteChunk.setEntry(i, Color.red(color), Color.green(color), Color.blue(color))
+      paletteChunk.setEntry(
+         pngIndex,
+         (color shr RED_SHIFT) and CHANNEL_MASK,
+         (color shr GREEN_SHIFT) and CHANNEL_MASK,
+         color and CHANNEL_MASK
+      )
    }
 
+   val imageLine = ImageLineByte(imageInfo)
+   val scanline = imageLine.getScanline()
+
    for (y in 0..<height) {
-      val imageLine = ImageLineByte(imageInfo)
+      val rowStart = y * width
       for (x in 0..<width) {
-         val pixel: Int = this[x, y] and 0x00FFFFFF
-         val index = PEBBLE_TIME_PALETTE_MAP[pixel]
-
-         requireNotNull(index) { "Color is not supported by Pebble Time: " + Integer.toHexString(pixel) }
-
-         imageLine.getScanline()[x] = index
+         scanline[x] = pngIndexes[pebbleIndexes[rowStart + x].toInt()].toByte()
       }
 
       pngWriter.writeRow(imageLine, y)
    }
 
    pngWriter.end()
-   return byteStream.toByteArray()
 }
 
-private val PEBBLE_TIME_PALETTE = IntArray(64)
-private val PEBBLE_TIME_PALETTE_MAP = HashMap<Int, Byte>().apply {
-   var counter = 0
-   for (r in 0x000000..0xFF0000 step 0x550000) {
-      for (g in 0x000000..0x00FF00 step 0x005500) {
-         for (b in 0x000000..0x0000FF step 0x000055) {
-            val color = r or g or b
-            PEBBLE_TIME_PALETTE[counter] = color
-            this[color] = counter.toByte()
-            counter++
-         }
+/**
+ * @return smallest bit depth of an indexed PNG that can index [colorCount] palette entries
+ */
+@Suppress("MagicNumber") // Bit depths allowed by the PNG specification
+internal fun indexedBitDepth(colorCount: Int): Int {
+   return when {
+      colorCount <= 2 -> 1
+      colorCount <= 4 -> 2
+      colorCount <= 16 -> 4
+      else -> 8
+   }
+}
+
+/**
+ * Encode the image with every one of the [PngSettings.SEARCH_CANDIDATES], until the [timeBudget] runs out,
+ * and keep the smallest result. Default settings are always tried first, so there is always a result to compare to.
+ */
+private inline fun encodeSmallest(
+   estimatedSize: Int,
+   timeBudget: Duration,
+   timeSource: TimeSource,
+   encode: (OutputStream, PngSettings) -> Unit,
+): OptimizedPng {
+   val start = timeSource.markNow()
+
+   @Suppress("MissingUseCall") // ByteArrayOutputStream does not need to be closed
+   val byteStream = ByteArrayOutputStream(estimatedSize)
+   encode(byteStream, PngSettings.DEFAULT)
+   val defaultSize = byteStream.size()
+
+   var smallestBytes = byteStream.toByteArray()
+   var smallestSettings = PngSettings.DEFAULT
+   for (settings in PngSettings.SEARCH_CANDIDATES) {
+      if (start.elapsedNow() >= timeBudget) {
+         break
+      }
+
+      byteStream.reset()
+      encode(byteStream, settings)
+
+      if (byteStream.size() < smallestBytes.size) {
+         smallestBytes = byteStream.toByteArray()
+         smallestSettings = settings
       }
    }
+
+   return OptimizedPng(smallestBytes, smallestSettings, defaultSize)
 }
 
+private fun PngWriter.applySettings(settings: PngSettings) {
+   setFilterType(settings.filterType)
+   setCompLevel(settings.compressionLevel)
+}
+
+/**
+ * Estimate the size of the encoded PNG, used as the initial size of output buffers. This is the size of all headers
+ * plus the size of the unfiltered image data. It is only a sizing hint: dithered images usually compress below it,
+ * but incompressible data can exceed it, in which case the buffer grows.
+ */
+internal fun ImagePixels.estimateEncodedSize(bitDepth: Int, paletteEntries: Int): Int {
+   val rowBytes = (width * bitDepth + Byte.SIZE_BITS - 1) / Byte.SIZE_BITS + 1
+   val paletteChunkSize = if (paletteEntries > 0) CHUNK_OVERHEAD + paletteEntries * 3 else 0
+
+   return PNG_HEADERS_SIZE + paletteChunkSize + CHUNK_OVERHEAD + rowBytes * height
+}
+
+private const val MONOCHROME_BIT_DEPTH = 1
+private const val MAX_COLOR_BIT_DEPTH = 8
+
+private const val RED_SHIFT = 16
+private const val GREEN_SHIFT = 8
+private const val CHANNEL_MASK = 0xFF
+private const val RGB_MASK = 0x00FFFFFF
+
+// Signature + IHDR + IEND
+private const val PNG_HEADERS_SIZE = 8 + 25 + 12
+
+// Length + type + CRC
+private const val CHUNK_OVERHEAD = 12
+
 private val BLACK_THRESHOLD = UByte.MAX_VALUE.toInt() / 2
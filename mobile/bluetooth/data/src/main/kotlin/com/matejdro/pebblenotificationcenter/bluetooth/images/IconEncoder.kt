@@ -0,0 +1,60 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.images
+
+import android.content.Context
+import android.graphics.Bitmap
+import android.graphics.Canvas
+import android.graphics.drawable.Icon
+import dev.zacsweers.metro.AppScope
+import dev.zacsweers.metro.ContributesBinding
+import dev.zacsweers.metro.Inject
+import kotlin.time.Duration.Companion.milliseconds
+
+/**
+ * Encodes notification icons into the watch format. Unlike [DrawableExtractor], this does not depend
+ * on the connected watch, so icons can be encoded before the watch asks for them.
+ */
+interface IconEncoder {
+   /**
+    * Load the [icon] (android.graphics.drawable.Icon) and encode it.
+    *
+    * @return encoded icon or *null* if the icon could not be loaded
+    */
+   fun convertIconToBitmapBytes(icon: Any, width: Int, height: Int, colorWatch: Boolean): ByteArray?
+}
+
+@Inject
+@ContributesBinding(AppScope::class)
+class IconEncoderImpl(
+   private val context: Context,
+) : IconEncoder {
+   override fun convertIconToBitmapBytes(
+      icon: Any,
+      width: Int,
+      height: Int,
+      colorWatch: Boolean,
+   ): ByteArray? {
+      val drawable = (icon as Icon).loadDrawable(context) ?: return null
+
+      val bitmap = Bitmap.createBitmap(width, height, Bitmap.Config.ARGB_8888)
+      val canvas = Canvas(bitmap)
+
+      drawable.setBounds(0, 0, width, height)
+      drawable.draw(canvas)
+
+      val finalImage = ImagePixels(bitmap)
+         .useAlphaAsValues()
+
+      // Encoded icons are cached, so it is worth spending some extra time to make them smaller
+      val png = if (colorWatch) {
+         finalImage
+            .dither(toColorScreen = true)
+            .encodeSmallestColorImage(ICON_ENCODING_TIME_BUDGET)
+      } else {
+         finalImage.encodeSmallestMonochromeImage(ICON_ENCODING_TIME_BUDGET)
+      }
+
+      return png.bytes
+   }
+}
+
+private val ICON_ENCODING_TIME_BUDGET = 20.milliseconds
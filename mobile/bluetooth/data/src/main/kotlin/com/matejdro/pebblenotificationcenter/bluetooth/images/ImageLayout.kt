@@ -0,0 +1,127 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.images
+
+/**
+ * Placement of the source image of size [sourceWidth]x[sourceHeight] on the watch screen.
+ */
+data class ImageLayout(
+   val sourceWidth: Int,
+   val sourceHeight: Int,
+   /**
+    * Size of the final image
+    */
+   val targetWidth: Int,
+   val targetHeight: Int,
+   /**
+    * Bounds of the whole (uncropped) source image, in the final image coordinates
+    */
+   val destinationLeft: Int,
+   val destinationTop: Int,
+   val destinationRight: Int,
+   val destinationBottom: Int,
+   /**
+    * Part of the source image that remains visible after cropping, in the source image coordinates
+    */
+   val cropLeft: Int,
+   val cropTop: Int,
+   val cropRight: Int,
+   val cropBottom: Int,
+) {
+   val isCropped: Boolean
+      get() = cropLeft > 0 || cropTop > 0 || cropRight < sourceWidth || cropBottom < sourceHeight
+
+   /**
+    * Largest power of two sample size, for which the subsampled visible part of the source image is still at least
+    * as large as the final image.
+    */
+   fun calculateSampleSize(): Int {
+      val visibleWidth = cropRight - cropLeft
+      val visibleHeight = cropBottom - cropTop
+
+      var sampleSize = 1
+      while (visibleWidth / (sampleSize * 2) >= targetWidth && visibleHeight / (sampleSize * 2) >= targetHeight) {
+         sampleSize *= 2
+      }
+
+      return sampleSize
+   }
+
+   companion object {
+      /**
+       * @param fill when *true*, image is scaled to cover the whole screen and cropped to the screen size. Otherwise,
+       * it is scaled to fit inside the screen without cropping.
+       */
+      fun calculate(
+         sourceWidth: Int,
+         sourceHeight: Int,
+         screenWidth: Int,
+         screenHeight: Int,
+         fill: Boolean,
+      ): ImageLayout {
+         return if (fill) {
+            calculateFill(sourceWidth, sourceHeight, screenWidth, screenHeight)
+         } else {
+            calculateFit(sourceWidth, sourceHeight, screenWidth, screenHeight)
+         }
+      }
+
+      private fun calculateFill(sourceWidth: Int, sourceHeight: Int, screenWidth: Int, screenHeight: Int): ImageLayout {
+         val preCropWidth: Int
+         val preCropHeight: Int
+         if (screenWidth / sourceWidth.toFloat() > screenHeight / sourceHeight.toFloat()) {
+            preCropWidth = screenWidth
+            preCropHeight = sourceHeight * screenWidth / sourceWidth
+         } else {
+            preCropWidth = sourceWidth * screenHeight / sourceHeight
+            preCropHeight = screenHeight
+         }
+
+         val cropX = (preCropWidth - screenWidth) / 2
+         val cropY = (preCropHeight - screenHeight) / 2
+
+         val cropLeft = (cropX.toLong() * sourceWidth / preCropWidth).toInt()
+         val cropTop = (cropY.toLong() * sourceHeight / preCropHeight).toInt()
+
+         return ImageLayout(
+            sourceWidth = sourceWidth,
+            sourceHeight = sourceHeight,
+            targetWidth = screenWidth,
+            targetHeight = screenHeight,
+            destinationLeft = -cropX,
+            destinationTop = -cropY,
+            destinationRight = screenWidth + cropX,
+            destinationBottom = screenHeight + cropY,
+            cropLeft = cropLeft,
+            cropTop = cropTop,
+            cropRight = sourceWidth - cropLeft,
+            cropBottom = sourceHeight - cropTop,
+         )
+      }
+
+      private fun calculateFit(sourceWidth: Int, sourceHeight: Int, screenWidth: Int, screenHeight: Int): ImageLayout {
+         val targetWidth: Int
+         val targetHeight: Int
+         if (screenWidth / sourceWidth.toFloat() < screenHeight / sourceHeight.toFloat()) {
+            targetWidth = screenWidth
+            targetHeight = sourceHeight * screenWidth / sourceWidth
+         } else {
+            targetWidth = sourceWidth * screenHeight / sourceHeight
+            targetHeight = screenHeight
+         }
+
+         return ImageLayout(
+            sourceWidth = sourceWidth,
+            sourceHeight = sourceHeight,
+            targetWidth = targetWidth,
+            targetHeight = targetHeight,
+            destinationLeft = 0,
+            destinationTop = 0,
+            destinationRight = targetWidth,
+            destinationBottom = targetHeight,
+            cropLeft = 0,
+            cropTop = 0,
+            cropRight = sourceWidth,
+            cropBottom = sourceHeight,
+         )
+      }
+   }
+}
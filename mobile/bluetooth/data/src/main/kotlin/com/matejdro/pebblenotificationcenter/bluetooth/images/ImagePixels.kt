@@ -4,16 +4,19 @@ import android.graphics.Bitmap
 
 /**
  * Lighter bitmap container that allows much faster access to getPixel and setPixel methods than Android's [Bitmap].
+ *
+ * Pixels are stored row-major as ARGB ints.
  */
-class ImagePixels(bitmap: Bitmap) {
-   val width: Int
-   val height: Int
-   private val pixels: IntArray
-
+class ImagePixels(
+   val width: Int,
+   val height: Int,
+   private val pixels: IntArray = IntArray(width * height),
+) {
    init {
-      width = bitmap.width
-      height = bitmap.height
-      pixels = IntArray(width * height)
+      require(pixels.size == width * height) { "Expected ${width * height} pixels, got ${pixels.size}" }
+   }
+
+   constructor(bitmap: Bitmap) : this(bitmap.width, bitmap.height) {
       bitmap.getPixels(pixels, 0, width, 0, 0, width, height)
    }
 
@@ -2,30 +2,26 @@ package com.matejdro.pebblenotificationcenter.bluetooth.images
 
 import android.graphics.drawable.Icon
 import com.matejdro.pebble.bluetooth.WatchMetadata
-import com.matejdro.pebble.bluetooth.common.PacketQueue
 import com.matejdro.pebblenotificationcenter.bluetooth.PRIORITY_USER_INTERACTION
+import com.matejdro.pebblenotificationcenter.bluetooth.PacketSupersessionKey
+import com.matejdro.pebblenotificationcenter.bluetooth.SupersedingPacketSender
+import com.matejdro.pebblenotificationcenter.notification.model.LazyImage
 import dev.zacsweers.metro.AppScope
 import dev.zacsweers.metro.ContributesBinding
 import dev.zacsweers.metro.Inject
 import io.rebble.pebblekit2.common.model.PebbleDictionaryItem
 import io.rebble.pebblekit2.common.util.sizeInBytes
+import logcat.logcat
 
 @Inject
 @ContributesBinding(AppScope::class)
 class ImageSenderImpl(
    private val drawableExtractor: DrawableExtractor,
-   private val packetQueue: PacketQueue,
+   private val packetSender: SupersedingPacketSender,
    private val watchMetadata: WatchMetadata,
 ) : ImageSender {
    @Suppress("MagicNumber") // Protocol constants
-   override suspend fun showImageOnTheWatch(notificationId: UByte, icon: Any, fill: Boolean) {
-      icon as Icon
-
-      val pebbleBitmapData = drawableExtractor.convertIconToBitmapBytes(icon, fill)
-      if (pebbleBitmapData.size > MAX_IMAGE_BYTES) {
-         error("Image too large: ${pebbleBitmapData.size}")
-      }
-
+   override suspend fun showImageOnTheWatch(notificationId: UByte, image: LazyImage, fill: Boolean) {
       val packetOverhead = mapOf(
          0u to PebbleDictionaryItem.UInt8(11),
          1u to PebbleDictionaryItem.Bytes(byteArrayOf())
@@ -35,34 +31,55 @@ class ImageSenderImpl(
          return
       }
 
+      val icon = image.load() as Icon?
+      if (icon == null) {
+         logcat { "Image for $notificationId is no longer available" }
+         return
+      }
+
       val maxPacketSize = watchMetadata.watchBufferSize - packetOverhead
 
-      val splits = pebbleBitmapData.toList().chunked(maxPacketSize)
+      // Encoded image is written straight into the packet byte arrays. Header is filled in afterwards, since it has to
+      // contain the total size of the image.
+      val chunkingStream = PacketChunkingOutputStream(IMAGE_PACKET_HEADER_SIZE, maxPacketSize)
+      drawableExtractor.convertIconToBitmapBytes(icon, fill, chunkingStream)
+      val packets = chunkingStream.finish()
 
-      splits.forEachIndexed { index, split ->
+      val totalSize = chunkingStream.totalBytes
+      if (totalSize > MAX_IMAGE_BYTES) {
+         error("Image too large: $totalSize")
+      }
+
+      for ((index, packet) in packets.withIndex()) {
          var flags = 0
          if (index == 0) {
             flags = flags or 1
          }
-         if (index == splits.lastIndex) {
+         if (index == packets.lastIndex) {
             flags = flags or 2
          }
 
-         val header = byteArrayOf(
-            notificationId.toByte(),
-            (pebbleBitmapData.size shr 8).toByte(),
-            pebbleBitmapData.size.toByte(),
-            flags.toByte(),
-         )
-         packetQueue.sendPacket(
+         packet[0] = notificationId.toByte()
+         packet[1] = (totalSize shr 8).toByte()
+         packet[2] = totalSize.toByte()
+         packet[3] = flags.toByte()
+
+         val sent = packetSender.sendPacket(
+            PacketSupersessionKey.Image(notificationId.toInt()),
             mapOf(
                0u to PebbleDictionaryItem.UInt8(11),
-               1u to PebbleDictionaryItem.Bytes(header + split.toByteArray()),
+               1u to PebbleDictionaryItem.Bytes(packet),
             ),
             priority = PRIORITY_USER_INTERACTION,
          )
+
+         if (!sent) {
+            logcat { "Image for $notificationId was superseded. Stopping..." }
+            return
+         }
       }
    }
 }
 
 private const val MAX_IMAGE_BYTES = 24000
+private const val IMAGE_PACKET_HEADER_SIZE = 4
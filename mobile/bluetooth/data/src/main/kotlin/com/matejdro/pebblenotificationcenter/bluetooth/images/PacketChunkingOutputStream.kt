@@ -0,0 +1,87 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.images
+
+import java.io.OutputStream
+
+/**
+ * Output stream that splits all written bytes directly into packet-sized byte arrays.
+ *
+ * Every chunk starts with [headerSize] reserved bytes, so packet headers can be written into the chunk in place
+ * later, without copying the payload again. Every time a chunk fills up, it is passed to the [onChunkFilled].
+ */
+class PacketChunkingOutputStream(
+   private val headerSize: Int,
+   private val maxPayloadSize: Int,
+   private val onChunkFilled: (ByteArray) -> Unit = {},
+) : OutputStream() {
+   private val chunks = ArrayList<ByteArray>()
+   private var currentChunk: ByteArray? = null
+   private var currentChunkPosition = 0
+   private var finished = false
+
+   /**
+    * Total amount of payload bytes written so far
+    */
+   var totalBytes: Int = 0
+      private set
+
+   init {
+      require(maxPayloadSize > 0) { "Max payload size must be positive, got $maxPayloadSize" }
+   }
+
+   override fun write(b: Int) {
+      val chunk = obtainChunkWithSpace()
+      chunk[currentChunkPosition++] = b.toByte()
+      totalBytes++
+      onChunkWritten()
+   }
+
+   override fun write(b: ByteArray, off: Int, len: Int) {
+      var sourcePosition = off
+      var remaining = len
+      while (remaining > 0) {
+         val chunk = obtainChunkWithSpace()
+         val toCopy = minOf(remaining, chunk.size - currentChunkPosition)
+         System.arraycopy(b, sourcePosition, chunk, currentChunkPosition, toCopy)
+
+         currentChunkPosition += toCopy
+         sourcePosition += toCopy
+         remaining -= toCopy
+         totalBytes += toCopy
+         onChunkWritten()
+      }
+   }
+
+   /**
+    * Finish writing and return all chunks. Last chunk is trimmed to only contain the written bytes.
+    */
+   fun finish(): List<ByteArray> {
+      check(!finished) { "Stream was already finished" }
+      finished = true
+
+      val lastChunk = currentChunk
+      if (lastChunk != null) {
+         chunks += lastChunk.copyOf(currentChunkPosition)
+         currentChunk = null
+      }
+
+      return chunks
+   }
+
+   private fun obtainChunkWithSpace(): ByteArray {
+      check(!finished) { "Stream was already finished" }
+
+      return currentChunk ?: ByteArray(headerSize + maxPayloadSize).also {
+         currentChunk = it
+         currentChunkPosition = headerSize
+      }
+   }
+
+   private fun onChunkWritten() {
+      val chunk = currentChunk ?: return
+      if (currentChunkPosition == chunk.size) {
+         chunks += chunk
+         currentChunk = null
+         onChunkFilled(chunk)
+      }
+   }
+}
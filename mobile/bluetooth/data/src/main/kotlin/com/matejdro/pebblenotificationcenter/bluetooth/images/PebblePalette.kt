@@ -0,0 +1,71 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.images
+
+import kotlin.math.roundToInt
+
+/**
+ * Pebble's color palette is a 4×4×4 cube: every channel has 4 levels (0x00, 0x55, 0xAA, 0xFF).
+ * Palette index of a color is its red level in the top two bits, then green and then blue.
+ */
+internal const val PEBBLE_PALETTE_SIZE = 64
+
+/**
+ * RGB values (without alpha) of all Pebble colors, ordered by their palette index.
+ */
+internal val PEBBLE_TIME_PALETTE = IntArray(PEBBLE_PALETTE_SIZE) { index ->
+   val r = (index shr 4) and CHANNEL_LEVEL_MASK
+   val g = (index shr 2) and CHANNEL_LEVEL_MASK
+   val b = index and CHANNEL_LEVEL_MASK
+   ((r * RGB_TO_PEBBLE_DIVIDER) shl 16) or ((g * RGB_TO_PEBBLE_DIVIDER) shl 8) or (b * RGB_TO_PEBBLE_DIVIDER)
+}
+
+@Suppress("MagicNumber") // Bit layout of the palette index
+internal fun pebblePaletteIndex(redLevel: Int, greenLevel: Int, blueLevel: Int): Int {
+   return (redLevel shl 4) or (greenLevel shl 2) or blueLevel
+}
+
+/**
+ * @return palette index of the provided RGB color (without alpha) or -1 if the color is not in the Pebble palette
+ */
+@Suppress("MagicNumber") // Bit layout of the RGB color
+internal fun pebblePaletteIndexOf(rgb: Int): Int {
+   val r = (rgb shr 16) and 0xFF
+   val g = (rgb shr 8) and 0xFF
+   val b = rgb and 0xFF
+
+   if (rgb ushr 24 != 0 || r % RGB_TO_PEBBLE_DIVIDER != 0 || g % RGB_TO_PEBBLE_DIVIDER != 0 ||
+      b % RGB_TO_PEBBLE_DIVIDER != 0
+   ) {
+      return -1
+   }
+
+   return pebblePaletteIndex(r / RGB_TO_PEBBLE_DIVIDER, g / RGB_TO_PEBBLE_DIVIDER, b / RGB_TO_PEBBLE_DIVIDER)
+}
+
+/**
+ * Nearest Pebble level (0-3) of a single color channel.
+ *
+ * Dithering pushes channel values slightly outside the 0-255 range, so the lookup table covers a wider range
+ * and only falls back to clamping outside of it.
+ */
+internal fun nearestPebbleChannelLevel(value: Int): Int {
+   val tableIndex = value - CHANNEL_LEVEL_TABLE_START
+   return if (tableIndex >= 0 && tableIndex < CHANNEL_LEVEL_TABLE.size) {
+      CHANNEL_LEVEL_TABLE[tableIndex]
+   } else if (tableIndex < 0) {
+      0
+   } else {
+      CHANNEL_LEVEL_MASK
+   }
+}
+
+private val CHANNEL_LEVEL_TABLE_START = -UByte.MAX_VALUE.toInt()
+private val CHANNEL_LEVEL_TABLE = IntArray(UByte.MAX_VALUE.toInt() * 3) { index ->
+   ((index + CHANNEL_LEVEL_TABLE_START) / RGB_TO_PEBBLE_DIVIDER.toFloat()).roundToInt().coerceIn(0, CHANNEL_LEVEL_MASK)
+}
+
+private const val CHANNEL_LEVEL_MASK = 0b11
+
+/**
+ * Divider of the 8-bit color value into the Pebble's 2-bit color.
+ */
+internal const val RGB_TO_PEBBLE_DIVIDER = 85
@@ -0,0 +1,52 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.images
+
+import ar.com.hjg.pngj.FilterType
+
+/**
+ * PNG encoder settings.
+ *
+ * Dithered images compress very differently depending on the row filter, so there is no single best setting.
+ */
+data class PngSettings(
+   val filterType: FilterType,
+   /**
+    * Deflate compression level, from 0 (no compression) to 9 (best compression)
+    */
+   val compressionLevel: Int,
+) {
+   companion object {
+      val DEFAULT = PngSettings(FilterType.FILTER_DEFAULT, DEFAULT_COMPRESSION_LEVEL)
+
+      /**
+       * Settings that are tried when searching for the smallest encoding, ordered from the ones
+       * that most often win for dithered images
+       */
+      val SEARCH_CANDIDATES = listOf(
+         PngSettings(FilterType.FILTER_NONE, MAX_COMPRESSION_LEVEL),
+         PngSettings(FilterType.FILTER_PAETH, MAX_COMPRESSION_LEVEL),
+         PngSettings(FilterType.FILTER_SUB, MAX_COMPRESSION_LEVEL),
+         PngSettings(FilterType.FILTER_UP, MAX_COMPRESSION_LEVEL),
+         PngSettings(FilterType.FILTER_ADAPTIVE_FULL, MAX_COMPRESSION_LEVEL),
+         PngSettings(FilterType.FILTER_NONE, DEFAULT_COMPRESSION_LEVEL),
+         PngSettings(FilterType.FILTER_ADAPTIVE_FULL, DEFAULT_COMPRESSION_LEVEL),
+      )
+   }
+}
+
+/**
+ * Result of the smallest PNG search
+ */
+class OptimizedPng(
+   val bytes: ByteArray,
+   val settings: PngSettings,
+   /**
+    * Size of the image when encoded with the [PngSettings.DEFAULT]
+    */
+   val defaultSize: Int,
+) {
+   val bytesSaved: Int
+      get() = defaultSize - bytes.size
+}
+
+private const val DEFAULT_COMPRESSION_LEVEL = 6
+private const val MAX_COMPRESSION_LEVEL = 9
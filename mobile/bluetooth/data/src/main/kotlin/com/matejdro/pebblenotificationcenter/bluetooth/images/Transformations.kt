@@ -30,40 +30,85 @@ fun ImagePixels.useAlphaAsValues(): ImagePixels {
  * Dither pixels into this image either into black/white (when [toColorScreen] is false)
  * or into Pebble colors (when [toColorScreen] is true).
  */
-// Splitting it up would it be even worse. Numbers are part of the algorithm.
-@Suppress("CognitiveComplexMethod", "MagicNumber")
 fun ImagePixels.dither(toColorScreen: Boolean): ImagePixels {
-   // Implementation of the Floyd Steinberg dithering
-   val separatedColorArray: Array<Array<SeparatedColor>?> =
-      Array(width) { x ->
-         Array(height) { y ->
-            SeparatedColor(this[x, y])
-         }
-      }
+   val palette = if (toColorScreen) DitherPalette.PEBBLE_COLORS else DitherPalette.BLACK_WHITE
+   return ditherFloydSteinberg(palette)
+}
+
+/**
+ * Implementation of the Floyd Steinberg dithering.
+ *
+ * Instead of keeping the error-adjusted color of every pixel, it only keeps accumulated per-channel quantization
+ * errors of the current and the next row in two primitive buffers that are swapped after every row.
+ * Every buffer has one padding pixel on each side, so the edge pixels do not need special handling.
+ */
+// Splitting it up would it be even worse. Numbers are part of the algorithm.
+@Suppress("MagicNumber")
+private fun ImagePixels.ditherFloydSteinberg(palette: DitherPalette): ImagePixels {
+   val rowBufferSize = (width + 2) * CHANNELS
+   var currentRowErrors = IntArray(rowBufferSize)
+   var nextRowErrors = IntArray(rowBufferSize)
 
    for (y in 0..<height) {
       for (x in 0..<width) {
-         val oldColor: SeparatedColor = separatedColorArray[x]!![y]
-         val newColor: SeparatedColor = if (toColorScreen) {
-            oldColor.getNearestPebbleTimeColor()
-         } else {
-            oldColor.getNearestBlackWhiteColor()
-         }
-         this[x, y] = newColor.toRGB()
-
-         newColor.reverseSub(oldColor)
-
-         if (x < width - 1) separatedColorArray[x + 1]!![y].addAndMultiplyAndDivide16(newColor, 7)
+         val pixel = this[x, y]
+         val errorIndex = (x + 1) * CHANNELS
 
-         if (y < height - 1) {
-            if (x > 0) separatedColorArray[x - 1]!![y + 1].addAndMultiplyAndDivide16(newColor, 3)
+         val oldR = ((pixel shr 16) and 0xFF) + currentRowErrors[errorIndex]
+         val oldG = ((pixel shr 8) and 0xFF) + currentRowErrors[errorIndex + 1]
+         val oldB = (pixel and 0xFF) + currentRowErrors[errorIndex + 2]
 
-            separatedColorArray[x]!![y + 1].addAndMultiplyAndDivide16(newColor, 5)
+         val newColor = palette.nearest(oldR, oldG, oldB)
+         this[x, y] = OPAQUE or newColor
 
-            if (x < width - 1) separatedColorArray[x + 1]!![y + 1].addAndMultiplyAndDivide16(newColor, 1)
-         }
+         currentRowErrors.distributeError(errorIndex + CHANNELS, newColor, oldR, oldG, oldB, 7)
+         nextRowErrors.distributeError(errorIndex - CHANNELS, newColor, oldR, oldG, oldB, 3)
+         nextRowErrors.distributeError(errorIndex, newColor, oldR, oldG, oldB, 5)
+         nextRowErrors.distributeError(errorIndex + CHANNELS, newColor, oldR, oldG, oldB, 1)
       }
+
+      val finishedRow = currentRowErrors
+      currentRowErrors = nextRowErrors
+      nextRowErrors = finishedRow
+      nextRowErrors.fill(0)
    }
 
    return this
 }
+
+@Suppress("MagicNumber", "LongParameterList") // Part of the algorithm, kept flat to avoid allocations
+private fun IntArray.distributeError(index: Int, newColor: Int, oldR: Int, oldG: Int, oldB: Int, scalar: Int) {
+   this[index] += (oldR - ((newColor shr 16) and 0xFF)) * scalar / 16
+   this[index + 1] += (oldG - ((newColor shr 8) and 0xFF)) * scalar / 16
+   this[index + 2] += (oldB - (newColor and 0xFF)) * scalar / 16
+}
+
+private enum class DitherPalette {
+   PEBBLE_COLORS {
+      override fun nearest(r: Int, g: Int, b: Int): Int {
+         return PEBBLE_TIME_PALETTE[
+            pebblePaletteIndex(
+               nearestPebbleChannelLevel(r),
+               nearestPebbleChannelLevel(g),
+               nearestPebbleChannelLevel(b),
+            )
+         ]
+      }
+   },
+   BLACK_WHITE {
+      @Suppress("MagicNumber") // Math formulas
+      override fun nearest(r: Int, g: Int, b: Int): Int {
+         val luma = (r + r + b + g + g + g) / 6
+         return if (luma > UByte.MAX_VALUE.toInt() / 2) 0xFFFFFF else 0
+      }
+   },
+   ;
+
+   /**
+    * @return RGB value (without alpha) of the palette color that is the nearest to the provided channels
+    */
+   abstract fun nearest(r: Int, g: Int, b: Int): Int
+}
+
+private const val CHANNELS = 3
+private const val OPAQUE = 0xFF shl 24
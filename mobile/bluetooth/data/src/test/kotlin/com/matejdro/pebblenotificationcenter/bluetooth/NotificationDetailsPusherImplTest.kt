@@ -3,12 +3,15 @@ package com.matejdro.pebblenotificationcenter.bluetooth
 import android.graphics.Canvas
 import android.graphics.ColorFilter
 import android.graphics.drawable.Drawable
+import com.matejdro.pebble.bluetooth.WatchMetadata
 import com.matejdro.pebble.bluetooth.common.PacketQueue
 import com.matejdro.pebble.bluetooth.common.test.FakePebbleSender
 import com.matejdro.pebble.bluetooth.common.test.sentData
 import com.matejdro.pebble.bluetooth.common.util.requireBytes
 import com.matejdro.pebblenotificationcenter.bluetooth.api.WATCHAPP_UUID
-import com.matejdro.pebblenotificationcenter.bluetooth.images.FakeDrawableExtractor
+import com.matejdro.pebblenotificationcenter.bluetooth.compression.PacketCompressor
+import com.matejdro.pebblenotificationcenter.bluetooth.images.EncodedIconCacheImpl
+import com.matejdro.pebblenotificationcenter.bluetooth.images.FakeIconEncoder
 import com.matejdro.pebblenotificationcenter.notification.FakeActionOrderRepository
 import com.matejdro.pebblenotificationcenter.notification.FakeNotificationRepository
 import com.matejdro.pebblenotificationcenter.notification.model.Action
@@ -39,13 +42,19 @@ class NotificationDetailsPusherImplTest {
 
    private val actionOrderRepository = FakeActionOrderRepository()
 
-   private val drawableExtractor = FakeDrawableExtractor()
+   private val iconEncoder = FakeIconEncoder()
+
+   private val packetBuilder = NotificationDetailsPacketBuilder(
+      actionOrderRepository,
+      iconEncoder,
+      EncodedIconCacheImpl(diskCacheFolder = null),
+      DefaultCoroutineScope(scope.backgroundScope.coroutineContext),
+   )
 
    private val notificationDetailsPusher = NotificationDetailsPusherImpl(
-      packetQueue,
+      SupersedingPacketSender(packetQueue, PacketCompressor(WatchMetadata())),
       notificationRepository,
-      actionOrderRepository,
-      drawableExtractor,
+      packetBuilder,
       DefaultCoroutineScope(scope.backgroundScope.coroutineContext),
       {},
    )
@@ -622,8 +631,8 @@ class NotificationDetailsPusherImplTest {
          }
       }
 
-      drawableExtractor.registerOutput(
-         drawable = fakeDrawable,
+      iconEncoder.registerOutput(
+         icon = fakeDrawable,
          width = 32,
          height = 32,
          colorWatch = false,
@@ -642,7 +651,7 @@ class NotificationDetailsPusherImplTest {
                "",
                "Hello",
                Instant.MIN,
-               iconDrawable = fakeDrawable,
+               icon = fakeDrawable,
             )
          )
       )
@@ -698,8 +707,8 @@ class NotificationDetailsPusherImplTest {
          }
       }
 
-      drawableExtractor.registerOutput(
-         drawable = fakeDrawable,
+      iconEncoder.registerOutput(
+         icon = fakeDrawable,
          width = 32,
          height = 32,
          colorWatch = true,
@@ -718,7 +727,7 @@ class NotificationDetailsPusherImplTest {
                "",
                "Hello",
                Instant.MIN,
-               iconDrawable = fakeDrawable,
+               icon = fakeDrawable,
             )
          )
       )
@@ -753,6 +762,153 @@ class NotificationDetailsPusherImplTest {
       )
    }
 
+   @Test
+   fun `Reuse encoded icons with the same identity`() = scope.runTest {
+      val fakeDrawable = object : Drawable() {
+         override fun draw(canvas: Canvas) {
+            throw UnsupportedOperationException()
+         }
+
+         @Deprecated("Deprecated in Java")
+         override fun getOpacity(): Int {
+            throw UnsupportedOperationException()
+         }
+
+         override fun setAlpha(alpha: Int) {
+            throw UnsupportedOperationException()
+         }
+
+         override fun setColorFilter(colorFilter: ColorFilter?) {
+            throw UnsupportedOperationException()
+         }
+      }
+
+      iconEncoder.registerOutput(
+         icon = fakeDrawable,
+         width = 32,
+         height = 32,
+         colorWatch = false,
+         output = byteArrayOf(1, 2, 3)
+      )
+
+      setup()
+
+      repeat(2) { index ->
+         notificationRepository.putNotification(
+            12 + index,
+            ProcessedNotification(
+               ParsedNotification(
+                  "",
+                  "com.app",
+                  "",
+                  "",
+                  "Hello",
+                  Instant.MIN,
+                  icon = fakeDrawable,
+                  iconId = "com.app:10",
+               )
+            )
+         )
+      }
+
+      notificationDetailsPusher.pushNotificationDetails(bucketId = 12, maxPacketSize = 100, colorWatch = false)
+      runCurrent()
+      notificationDetailsPusher.pushNotificationDetails(bucketId = 13, maxPacketSize = 100, colorWatch = false)
+      runCurrent()
+
+      iconEncoder.drawableConversions shouldBe 1
+      sender.sentData.map { it.requireBytes(1u).copyOfRange(2, 7).toList() }.shouldContainExactly(
+         listOf<Byte>(0, 3, 1, 2, 3),
+         listOf<Byte>(0, 3, 1, 2, 3),
+      )
+   }
+
+   @Test
+   fun `Use details packet that was prebuilt when the notification was posted`() = scope.runTest {
+      val fakeDrawable = createFakeDrawable()
+      iconEncoder.registerOutput(fakeDrawable, width = 32, height = 32, colorWatch = false, output = byteArrayOf(1, 2, 3))
+
+      setup()
+
+      val notification = ProcessedNotification(
+         ParsedNotification("", "", "", "", "Hello", Instant.MIN, icon = fakeDrawable),
+         bucketId = 13
+      )
+
+      // Details of the first notification teach the builder about the watch parameters
+      notificationDetailsPusher.pushNotificationDetails(bucketId = 12, maxPacketSize = 100, colorWatch = false)
+      runCurrent()
+
+      notificationRepository.putNotification(13, notification)
+      packetBuilder.prebuild(notification)
+      runCurrent()
+      iconEncoder.drawableConversions shouldBe 1
+
+      notificationDetailsPusher.pushNotificationDetails(bucketId = 13, maxPacketSize = 100, colorWatch = false)
+      runCurrent()
+
+      iconEncoder.drawableConversions shouldBe 1
+      sender.sentData.last().requireBytes(1u).toList().shouldContainExactly(
+         listOf<Byte>(13, 0, 0, 3, 1, 2, 3, 72, 101, 108, 108, 111)
+      )
+   }
+
+   @Test
+   fun `Rebuild prebuilt details packet when action order changes`() = scope.runTest {
+      setup()
+
+      val notification = ProcessedNotification(
+         ParsedNotification("", "", "", "", "Hello", Instant.MIN),
+         bucketId = 13,
+         actions = listOf(
+            Action.Dismiss("A1", 0u),
+            Action.Dismiss("A2", 1u),
+         )
+      )
+
+      notificationDetailsPusher.pushNotificationDetails(bucketId = 12, maxPacketSize = 100, colorWatch = false)
+      runCurrent()
+
+      notificationRepository.putNotification(13, notification)
+      packetBuilder.prebuild(notification)
+      runCurrent()
+
+      actionOrderRepository.moveOrder("A1", 2)
+
+      notificationDetailsPusher.pushNotificationDetails(bucketId = 13, maxPacketSize = 100, colorWatch = false)
+      runCurrent()
+
+      sender.sentData.last().requireBytes(1u).copyOfRange(0, 10).toList().shouldContainExactly(
+         listOf<Byte>(13, 2, 1, 65, 50, 0, 0, 65, 49, 0)
+      )
+   }
+
+   @Test
+   fun `Rebuild invalidated details packet`() = scope.runTest {
+      val fakeDrawable = createFakeDrawable()
+      iconEncoder.registerOutput(fakeDrawable, width = 32, height = 32, colorWatch = false, output = byteArrayOf(1, 2, 3))
+
+      setup()
+
+      val notification = ProcessedNotification(
+         ParsedNotification("", "", "", "", "Hello", Instant.MIN, icon = fakeDrawable),
+         bucketId = 13
+      )
+
+      notificationDetailsPusher.pushNotificationDetails(bucketId = 12, maxPacketSize = 100, colorWatch = false)
+      runCurrent()
+
+      notificationRepository.putNotification(13, notification)
+      packetBuilder.prebuild(notification)
+      runCurrent()
+      packetBuilder.invalidate(13)
+
+      notificationDetailsPusher.pushNotificationDetails(bucketId = 13, maxPacketSize = 100, colorWatch = false)
+      runCurrent()
+
+      iconEncoder.drawableConversions shouldBe 2
+   }
+
    @Test
    fun `Reset vibration pattern when sending fails`() = scope.runTest {
       val watchSenderJob = setup()
@@ -782,6 +938,27 @@ class NotificationDetailsPusherImplTest {
       notificationRepository.nextVibration shouldBe intArrayOf(10, 10, 10, 10)
    }
 
+   private fun createFakeDrawable(): Drawable {
+      return object : Drawable() {
+         override fun draw(canvas: Canvas) {
+            throw UnsupportedOperationException()
+         }
+
+         @Deprecated("Deprecated in Java")
+         override fun getOpacity(): Int {
+            throw UnsupportedOperationException()
+         }
+
+         override fun setAlpha(alpha: Int) {
+            throw UnsupportedOperationException()
+         }
+
+         override fun setColorFilter(colorFilter: ColorFilter?) {
+            throw UnsupportedOperationException()
+         }
+      }
+   }
+
    private fun TestScope.setup(): Job {
       return backgroundScope.launch {
          packetQueue.runQueue()
@@ -0,0 +1,159 @@
+package com.matejdro.pebblenotificationcenter.bluetooth
+
+import com.matejdro.pebble.bluetooth.WatchMetadata
+import com.matejdro.pebble.bluetooth.common.PacketQueue
+import com.matejdro.pebble.bluetooth.common.test.FakePebbleSender
+import com.matejdro.pebble.bluetooth.common.test.sentData
+import com.matejdro.pebblenotificationcenter.bluetooth.api.WATCHAPP_UUID
+import com.matejdro.pebblenotificationcenter.bluetooth.compression.PacketCompressor
+import io.kotest.matchers.collections.shouldContainExactly
+import io.kotest.matchers.shouldBe
+import io.rebble.pebblekit2.common.model.PebbleDictionaryItem
+import io.rebble.pebblekit2.common.model.WatchIdentifier
+import kotlinx.coroutines.async
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.test.TestScope
+import kotlinx.coroutines.test.runCurrent
+import kotlinx.coroutines.test.runTest
+import org.junit.jupiter.api.Test
+import si.inova.kotlinova.core.test.TestScopeWithDispatcherProvider
+import si.inova.kotlinova.core.test.time.virtualTimeProvider
+
+class SupersedingPacketSenderTest {
+   private val scope = TestScopeWithDispatcherProvider()
+   private val sender = FakePebbleSender(scope.virtualTimeProvider())
+   private val packetQueue = PacketQueue(sender, WatchIdentifier("watch"), WATCHAPP_UUID)
+
+   private val packetSender = SupersedingPacketSender(packetQueue, PacketCompressor(WatchMetadata()))
+
+   @Test
+   fun `Drop queued packet when a newer packet with the same key is sent`() = scope.runTest {
+      setup()
+      sender.pauseSending = true
+
+      backgroundScope.launch { packetSender.sendPacket(PacketSupersessionKey.Vibration, packet(1), priority = 0) }
+      runCurrent()
+
+      val first = backgroundScope.async {
+         packetSender.sendPacket(PacketSupersessionKey.NotificationDetails(2), packet(2), priority = 0)
+      }
+      runCurrent()
+      val second = backgroundScope.async {
+         packetSender.sendPacket(PacketSupersessionKey.NotificationDetails(2), packet(3), priority = 0)
+      }
+      runCurrent()
+
+      sender.pauseSending = false
+      runCurrent()
+
+      sender.sentData.map { it.getValue(0u) }.shouldContainExactly(
+         PebbleDictionaryItem.UInt8(1u),
+         PebbleDictionaryItem.UInt8(3u),
+      )
+      first.await() shouldBe false
+      second.await() shouldBe true
+      packetSender.metrics.value shouldBe PacketSupersessionMetrics(supersededPackets = 1, droppedPackets = 0)
+   }
+
+   @Test
+   fun `Do not drop packets with different keys`() = scope.runTest {
+      setup()
+      sender.pauseSending = true
+
+      backgroundScope.launch { packetSender.sendPacket(PacketSupersessionKey.Vibration, packet(1), priority = 0) }
+      runCurrent()
+      backgroundScope.launch { packetSender.sendPacket(PacketSupersessionKey.NotificationDetails(2), packet(2), priority = 0) }
+      runCurrent()
+      backgroundScope.launch { packetSender.sendPacket(PacketSupersessionKey.Image(2), packet(3), priority = 0) }
+      runCurrent()
+
+      sender.pauseSending = false
+      runCurrent()
+
+      sender.sentData.map { it.getValue(0u) }.shouldContainExactly(
+         PebbleDictionaryItem.UInt8(1u),
+         PebbleDictionaryItem.UInt8(2u),
+         PebbleDictionaryItem.UInt8(3u),
+      )
+      packetSender.metrics.value shouldBe PacketSupersessionMetrics()
+   }
+
+   @Test
+   fun `Drop cancelled packets`() = scope.runTest {
+      setup()
+      sender.pauseSending = true
+
+      backgroundScope.launch { packetSender.sendPacket(PacketSupersessionKey.Vibration, packet(1), priority = 0) }
+      runCurrent()
+      val image = backgroundScope.async {
+         packetSender.sendPacket(PacketSupersessionKey.Image(2), packet(2), priority = 0)
+      }
+      runCurrent()
+
+      packetSender.cancel(PacketSupersessionKey.Image(2))
+      sender.pauseSending = false
+      runCurrent()
+
+      sender.sentData.map { it.getValue(0u) }.shouldContainExactly(
+         PebbleDictionaryItem.UInt8(1u),
+      )
+      image.await() shouldBe false
+      packetSender.metrics.value shouldBe PacketSupersessionMetrics(supersededPackets = 0, droppedPackets = 1)
+   }
+
+   @Test
+   fun `Do not drop details of other notifications`() = scope.runTest {
+      setup()
+      sender.pauseSending = true
+
+      backgroundScope.launch { packetSender.sendPacket(PacketSupersessionKey.Vibration, packet(1), priority = 0) }
+      runCurrent()
+      backgroundScope.launch { packetSender.sendPacket(PacketSupersessionKey.NotificationDetails(2), packet(2), priority = 0) }
+      runCurrent()
+      backgroundScope.launch { packetSender.sendPacket(PacketSupersessionKey.NotificationDetails(3), packet(3), priority = 0) }
+      runCurrent()
+
+      sender.pauseSending = false
+      runCurrent()
+
+      sender.sentData.map { it.getValue(0u) }.shouldContainExactly(
+         PebbleDictionaryItem.UInt8(1u),
+         PebbleDictionaryItem.UInt8(2u),
+         PebbleDictionaryItem.UInt8(3u),
+      )
+      packetSender.metrics.value shouldBe PacketSupersessionMetrics()
+   }
+
+   @Test
+   fun `Drop all cancelled packets that match the filter`() = scope.runTest {
+      setup()
+      sender.pauseSending = true
+
+      backgroundScope.launch { packetSender.sendPacket(PacketSupersessionKey.Vibration, packet(1), priority = 0) }
+      runCurrent()
+      backgroundScope.launch { packetSender.sendPacket(PacketSupersessionKey.Image(2), packet(2), priority = 0) }
+      runCurrent()
+      backgroundScope.launch { packetSender.sendPacket(PacketSupersessionKey.Image(3), packet(3), priority = 0) }
+      runCurrent()
+      backgroundScope.launch { packetSender.sendPacket(PacketSupersessionKey.NotificationDetails(4), packet(4), priority = 0) }
+      runCurrent()
+
+      packetSender.cancelAll { it is PacketSupersessionKey.Image }
+      sender.pauseSending = false
+      runCurrent()
+
+      sender.sentData.map { it.getValue(0u) }.shouldContainExactly(
+         PebbleDictionaryItem.UInt8(1u),
+         PebbleDictionaryItem.UInt8(4u),
+      )
+      packetSender.metrics.value shouldBe PacketSupersessionMetrics(supersededPackets = 0, droppedPackets = 2)
+   }
+
+   private fun packet(id: Int) = mapOf(0u to PebbleDictionaryItem.UInt8(id.toUByte()))
+
+   private fun TestScope.setup() {
+      backgroundScope.launch {
+         packetQueue.runQueue()
+      }
+   }
+}
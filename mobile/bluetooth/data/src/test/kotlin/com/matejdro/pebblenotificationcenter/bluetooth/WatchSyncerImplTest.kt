@@ -19,8 +19,11 @@ import com.matejdro.pebblenotificationcenter.rules.keys.set
 import dispatch.core.DefaultCoroutineScope
 import io.kotest.matchers.collections.shouldBeEmpty
 import io.kotest.matchers.collections.shouldContainExactly
+import io.kotest.matchers.collections.shouldContainOnly
 import io.kotest.matchers.nulls.shouldBeNull
+import io.kotest.matchers.nulls.shouldNotBeNull
 import io.kotest.matchers.shouldBe
+import io.kotest.matchers.shouldNotBe
 import kotlinx.coroutines.delay
 import kotlinx.coroutines.test.runTest
 import org.junit.jupiter.api.Test
@@ -262,6 +265,145 @@ class WatchSyncerImplTest {
       bucketSyncRepository.awaitNextUpdate(0u, emptyList()).activeBuckets.shouldContainExactly(3u)
    }
 
+   @Test
+   fun `Write staged notifications and deletions when committing a batch`() = scope.runTest {
+      init()
+      watchSyncer.syncNotification(
+         ParsedNotification(
+            "1",
+            "com.app",
+            "Title",
+            "sTitle",
+            "Body",
+            // 19:18:25 GMT | Sunday, January 4, 2026
+            Instant.ofEpochSecond(1_767_554_305)
+         )
+      )
+      delay(1.seconds)
+
+      val batch = watchSyncer.startBatch()
+      batch.stageDeletion("1")
+      batch.stageNotification(
+         ProcessedNotification(
+            ParsedNotification(
+               "2",
+               "com.app",
+               "Title",
+               "sTitle",
+               "Body",
+               // 19:18:26 GMT | Sunday, January 4, 2026
+               Instant.ofEpochSecond(1_767_554_306)
+            )
+         ),
+         emptyPreferences()
+      )
+      batch.stageNotification(
+         ProcessedNotification(
+            ParsedNotification(
+               "3",
+               "com.app",
+               "Title",
+               "sTitle",
+               "Body",
+               // 19:18:27 GMT | Sunday, January 4, 2026
+               Instant.ofEpochSecond(1_767_554_307)
+            )
+         ),
+         emptyPreferences()
+      )
+      val bucketIds = batch.commit()
+      delay(1.seconds)
+
+      bucketIds.keys.shouldContainExactly("2", "3")
+      bucketSyncRepository.awaitNextUpdate(0u, emptyList()).activeBuckets.shouldContainExactly(
+         bucketIds.getValue("3").toUShort(),
+         bucketIds.getValue("2").toUShort(),
+      )
+   }
+
+   @Test
+   fun `Write vibrating and unread notifications of a batch first`() = scope.runTest {
+      init()
+
+      val batch = watchSyncer.startBatch()
+      val notifications = listOf(
+         Triple("read", false, false),
+         Triple("unread", true, false),
+         Triple("vibrated", true, true),
+      )
+      for ((key, unread, vibrated) in notifications) {
+         batch.stageNotification(
+            ProcessedNotification(
+               ParsedNotification(
+                  key,
+                  "com.app",
+                  "Title",
+                  "sTitle",
+                  "Body",
+                  // 19:18:25 GMT | Sunday, January 4, 2026
+                  Instant.ofEpochSecond(1_767_554_305)
+               ),
+               unread = unread,
+               vibrated = vibrated,
+            ),
+            emptyPreferences()
+         )
+      }
+      val bucketIds = batch.commit()
+
+      bucketIds shouldBe mapOf("vibrated" to 2, "unread" to 3, "read" to 4)
+   }
+
+   @Test
+   fun `Write the notification that vibrated first when notifications are reloaded`() = scope.runTest {
+      init()
+
+      val trigger = ParsedNotification(
+         "trigger",
+         "com.app",
+         "Title",
+         "sTitle",
+         "Body",
+         // 19:18:25 GMT | Sunday, January 4, 2026
+         Instant.ofEpochSecond(1_767_554_305)
+      )
+      watchSyncer.syncNotification(ProcessedNotification(trigger, vibrated = true), emptyPreferences())
+      watchSyncer.clearAllNotifications()
+
+      val batch = watchSyncer.startBatch()
+      for (key in listOf("a", "b")) {
+         batch.stageNotification(ProcessedNotification(trigger.copy(key = key), unread = true), emptyPreferences())
+      }
+      batch.stageNotification(ProcessedNotification(trigger), emptyPreferences())
+      val bucketIds = batch.commit()
+
+      bucketIds shouldBe mapOf("trigger" to 2, "a" to 3, "b" to 4)
+   }
+
+   @Test
+   fun `Do not write staged notifications before the batch is committed`() = scope.runTest {
+      init()
+
+      val batch = watchSyncer.startBatch()
+      batch.stageNotification(
+         ProcessedNotification(
+            ParsedNotification(
+               "1",
+               "com.app",
+               "Title",
+               "sTitle",
+               "Body",
+               // 19:18:25 GMT | Sunday, January 4, 2026
+               Instant.ofEpochSecond(1_767_554_305)
+            )
+         ),
+         emptyPreferences()
+      )
+      delay(1.seconds)
+
+      bucketSyncRepository.checkForNextUpdate(0u, emptyList()).shouldBeNull()
+   }
+
    @Test
    fun `Delete all delete all notifications`() = scope.runTest {
       init()
@@ -500,6 +642,8 @@ class WatchSyncerImplTest {
                   0b00000000, // Both mutes by default
                   0,
                   0,
+                  0, // Number of notifications
+                  0, // Notification window start
                )
             )
          )
@@ -526,6 +670,8 @@ class WatchSyncerImplTest {
                   0b00000001, // Only mute watch enabled
                   0,
                   0,
+                  0, // Number of notifications
+                  0, // Notification window start
                )
             )
          )
@@ -552,6 +698,8 @@ class WatchSyncerImplTest {
                   0b00000010, // Only mute phone enabled
                   0,
                   0,
+                  0, // Number of notifications
+                  0, // Notification window start
                )
             )
          )
@@ -578,6 +726,8 @@ class WatchSyncerImplTest {
                   0b00010000, // Only large status bar font enabled
                   0,
                   0,
+                  0, // Number of notifications
+                  0, // Notification window start
                )
             )
          )
@@ -604,6 +754,8 @@ class WatchSyncerImplTest {
                   0b00000000, // Both mutes disabled by default
                   0x01,
                   0x04,
+                  0, // Number of notifications
+                  0, // Notification window start
                )
             )
          )
@@ -630,6 +782,8 @@ class WatchSyncerImplTest {
                   0b00000100, // Flag enabled
                   0,
                   0,
+                  0, // Number of notifications
+                  0, // Notification window start
                )
             )
          )
@@ -656,6 +810,8 @@ class WatchSyncerImplTest {
                   0b00001000, // Flag enabled
                   0,
                   0,
+                  0, // Number of notifications
+                  0, // Notification window start
                )
             )
          )
@@ -947,6 +1103,113 @@ class WatchSyncerImplTest {
       bucketSyncRepository.awaitNextUpdate(0u, emptyList()).activeBuckets shouldBe listOf<UShort>(2u, 3u)
    }
 
+   @Test
+   fun `Only store a window of latest notifications on the watch`() = scope.runTest {
+      init()
+      val bucketIds = syncNumberedNotifications(20)
+
+      bucketSyncRepository.awaitNextUpdate(0u, emptyList()).activeBuckets.size shouldBe 14
+      bucketIds.take(6).shouldContainOnly(0)
+      watchSyncer.getBucketId("5").shouldBeNull()
+      watchSyncer.getBucketId("6").shouldNotBeNull()
+      watchSyncer.getNotificationKey(watchSyncer.getBucketId("19").shouldNotBeNull()) shouldBe "19"
+   }
+
+   @Test
+   fun `Move the window of notifications around the selected notification`() = scope.runTest {
+      init()
+      syncNumberedNotifications(20)
+
+      // Notifications are sorted from the latest to the oldest, so index 19 is the notification 0
+      watchSyncer.moveWindow(selectedIndex = 19)
+
+      bucketSyncRepository.awaitNextUpdate(0u, emptyList()).activeBuckets.size shouldBe 14
+      watchSyncer.getBucketId("0").shouldNotBeNull()
+      watchSyncer.getBucketId("13").shouldNotBeNull()
+      watchSyncer.getBucketId("14").shouldBeNull()
+   }
+
+   @Test
+   fun `Move next notification into the window when a notification in the window is deleted`() = scope.runTest {
+      init()
+      syncNumberedNotifications(20)
+
+      watchSyncer.clearNotification("19")
+
+      bucketSyncRepository.awaitNextUpdate(0u, emptyList()).activeBuckets.size shouldBe 14
+      watchSyncer.getBucketId("5").shouldNotBeNull()
+   }
+
+   @Test
+   fun `Move the window to the new vibrating notification`() = scope.runTest {
+      init()
+      syncNumberedNotifications(20)
+      watchSyncer.moveWindow(selectedIndex = 19)
+
+      val bucketId = watchSyncer.syncNotification(
+         ProcessedNotification(
+            ParsedNotification(
+               "new",
+               "com.app",
+               "Title",
+               "sTitle",
+               "Body",
+               Instant.ofEpochSecond(1_767_554_405)
+            ),
+            vibrated = true
+         ),
+         emptyPreferences()
+      )
+
+      bucketId shouldNotBe 0
+      watchSyncer.getBucketId("new") shouldBe bucketId
+   }
+
+   @Test
+   fun `Write the window position in the same update as the moved window`() = scope.runTest {
+      init(enablePreferences = true)
+      delay(2.seconds)
+      syncNumberedNotifications(20)
+      val (version) = bucketSyncRepository.awaitNextUpdate(0u, emptyList())
+
+      watchSyncer.moveWindow(selectedIndex = 19)
+
+      val (_, _, updatedBuckets) = bucketSyncRepository.checkForNextUpdate(version, emptyList()).shouldNotBeNull()
+      val settingsBucket = updatedBuckets.associate { (id, data) -> id.toInt() to data }[1].shouldNotBeNull()
+      settingsBucket[3] shouldBe 20.toByte()
+      settingsBucket[4] shouldBe 6.toByte()
+   }
+
+   @Test
+   fun `Do not rewrite the window position when the window does not move`() = scope.runTest {
+      init(enablePreferences = true)
+      delay(2.seconds)
+      syncNumberedNotifications(20)
+      delay(2.seconds)
+      val (version) = bucketSyncRepository.awaitNextUpdate(0u, emptyList())
+
+      watchSyncer.moveWindow(selectedIndex = 2)
+      delay(2.seconds)
+
+      bucketSyncRepository.checkForNextUpdate(version, emptyList()).shouldBeNull()
+   }
+
+   private suspend fun syncNumberedNotifications(count: Int): List<Int> {
+      return (0 until count).map {
+         watchSyncer.syncNotification(
+            ParsedNotification(
+               it.toString(),
+               "com.app",
+               "Title",
+               "sTitle",
+               "Body",
+               // Every next notification is one second later
+               Instant.ofEpochSecond(1_767_554_305L + it)
+            )
+         )
+      }
+   }
+
    private suspend fun init(enablePreferences: Boolean = false) {
       bucketSyncRepository.init(1, 2..BucketSyncRepository.MAX_BUCKET_ID)
       watchSyncer.init(enablePreferences)
@@ -11,11 +11,13 @@ import com.matejdro.pebble.bluetooth.common.test.FakePebbleSender
 import com.matejdro.pebble.bluetooth.common.test.sentData
 import com.matejdro.pebblenotificationcenter.FakeNotificationServiceController
 import com.matejdro.pebblenotificationcenter.bluetooth.api.WATCHAPP_UUID
+import com.matejdro.pebblenotificationcenter.bluetooth.compression.PacketCompressor
 import com.matejdro.pebblenotificationcenter.bluetooth.images.FakeImageSender
 import com.matejdro.pebblenotificationcenter.common.test.InMemoryDataStore
 import com.matejdro.pebblenotificationcenter.notification.FakeActionHandler
 import com.matejdro.pebblenotificationcenter.notification.FakeNotificationRepository
 import com.matejdro.pebblenotificationcenter.notification.FakeSubmenuActionHandler
+import com.matejdro.pebblenotificationcenter.notification.model.LazyImage
 import com.matejdro.pebblenotificationcenter.notification.model.ParsedNotification
 import com.matejdro.pebblenotificationcenter.notification.model.ProcessedNotification
 import com.matejdro.pebblenotificationcenter.rules.GlobalPreferenceKeys
@@ -65,6 +67,7 @@ class WatchappConnectionImplTest {
 
    private val imageSender = FakeImageSender()
    private val watchMetadata = WatchMetadata()
+   private val watchSyncer = FakeWatchSyncer()
 
    private val bucketSyncWatchLoop = BucketSyncWatchLoopImpl(
       scope.backgroundScope,
@@ -89,6 +92,8 @@ class WatchappConnectionImplTest {
       watchMetadata,
       serviceController,
       imageSender,
+      SupersedingPacketSender(packetQueue, PacketCompressor(watchMetadata)),
+      watchSyncer,
    )
 
    @Test
@@ -470,6 +475,14 @@ class WatchappConnectionImplTest {
       watchMetadata.screenHeight shouldBe 400
    }
 
+   @Test
+   fun `Save compression support into watch metadata`() = scope.runTest {
+      receiveStandardHelloPacket(bufferSize = 123u, flags = 2u)
+
+      watchMetadata.supportsCompression shouldBe true
+      watchMetadata.colorWatch shouldBe false
+   }
+
    @Test
    fun `Send re-init request packet if watch does not send hello in few seconds`() = scope.runTest {
       delay(6.seconds)
@@ -532,6 +545,22 @@ class WatchappConnectionImplTest {
       result shouldBe ReceiveResult.Ack
    }
 
+   @Test
+   fun `Move notification window upon receiving that command`() = scope.runTest {
+      receiveStandardHelloPacket(bufferSize = 123u)
+
+      val result = connection.onPacketReceived(
+         mapOf(
+            0u to PebbleDictionaryItem.UInt32(16u),
+            1u to PebbleDictionaryItem.UInt32(20u),
+         )
+      )
+      runCurrent()
+
+      watchSyncer.windowMoves.shouldContainExactly(20)
+      result shouldBe ReceiveResult.Ack
+   }
+
    @Test
    fun `Suppress close to last app when not needed`() = scope.runTest {
       watchappOpenController.shouldCloseToLastApp = false
@@ -546,7 +575,7 @@ class WatchappConnectionImplTest {
 
    @Test
    fun `Send cropped image when requested`() = scope.runTest {
-      val icon = Icon.createWithContentUri("content://image")
+      val icon = LazyImage { Icon.createWithContentUri("content://image") }
 
       notificationsRepository.putNotification(
          2,
@@ -583,7 +612,7 @@ class WatchappConnectionImplTest {
 
    @Test
    fun `Send non-cropped image when requested`() = scope.runTest {
-      val icon = Icon.createWithContentUri("content://image")
+      val icon = LazyImage { Icon.createWithContentUri("content://image") }
 
       notificationsRepository.putNotification(
          2,
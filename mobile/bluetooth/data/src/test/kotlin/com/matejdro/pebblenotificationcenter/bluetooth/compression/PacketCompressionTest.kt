@@ -0,0 +1,54 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.compression
+
+import io.kotest.matchers.comparables.shouldBeLessThan
+import io.kotest.matchers.shouldBe
+import org.junit.jupiter.api.Test
+import kotlin.random.Random
+
+class PacketCompressionTest {
+   @Test
+   fun `Compress repetitive text`() {
+      val text = "Alice: Are we still meeting tomorrow? Bob: Yes, the meeting is tomorrow at 10. ".repeat(5)
+         .encodeToByteArray()
+
+      val compressed = compressPacketData(text)
+
+      compressed.size shouldBeLessThan text.size / 2
+      decompressPacketData(compressed) shouldBe text
+   }
+
+   @Test
+   fun `Decompress overlapping matches`() {
+      val data = ByteArray(1000) { 'a'.code.toByte() }
+
+      decompressPacketData(compressPacketData(data)) shouldBe data
+   }
+
+   @Test
+   fun `Decompress random data`() {
+      val random = Random(RANDOM_SEED)
+
+      repeat(100) {
+         val data = random.nextBytes(random.nextInt(3000))
+         decompressPacketData(compressPacketData(data)) shouldBe data
+      }
+   }
+
+   @Test
+   fun `Decompress random text`() {
+      val random = Random(RANDOM_SEED)
+      val words = listOf("hello", "the", "message", "group chat", "Alice: ", "\n", "ok", " ")
+
+      repeat(100) {
+         val data = List(random.nextInt(1000)) { words.random(random) }.joinToString("").encodeToByteArray()
+         decompressPacketData(compressPacketData(data)) shouldBe data
+      }
+   }
+
+   @Test
+   fun `Compress empty data`() {
+      decompressPacketData(compressPacketData(ByteArray(0))) shouldBe ByteArray(0)
+   }
+}
+
+private const val RANDOM_SEED = 1337
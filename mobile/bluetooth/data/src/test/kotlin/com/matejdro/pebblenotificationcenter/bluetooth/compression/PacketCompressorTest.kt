@@ -0,0 +1,74 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.compression
+
+import com.matejdro.pebble.bluetooth.WatchMetadata
+import io.kotest.matchers.doubles.shouldBeLessThan
+import io.kotest.matchers.nulls.shouldNotBeNull
+import io.kotest.matchers.shouldBe
+import io.kotest.matchers.types.shouldBeSameInstanceAs
+import io.rebble.pebblekit2.common.model.PebbleDictionaryItem
+import org.junit.jupiter.api.Test
+import kotlin.random.Random
+
+class PacketCompressorTest {
+   private val watchMetadata = WatchMetadata(supportsCompression = true)
+   private val compressor = PacketCompressor(watchMetadata)
+
+   @Test
+   fun `Move compressed data into the compressed data key`() {
+      val data = "Notification text, notification text, notification text".encodeToByteArray()
+
+      val packet = compressor.compress(packet(5u, data))
+
+      packet.keys shouldBe setOf(0u, 100u)
+      packet[0u] shouldBe PebbleDictionaryItem.UInt8(5u)
+      decompressPacketData((packet[100u] as PebbleDictionaryItem.Bytes).value) shouldBe data
+   }
+
+   @Test
+   fun `Do not compress when the watch does not support it`() {
+      watchMetadata.supportsCompression = false
+      val packet = packet(5u, ByteArray(100))
+
+      compressor.compress(packet) shouldBeSameInstanceAs packet
+   }
+
+   @Test
+   fun `Do not compress packets that are not bulk packets`() {
+      val packet = packet(7u, ByteArray(100))
+
+      compressor.compress(packet) shouldBeSameInstanceAs packet
+   }
+
+   @Test
+   fun `Send uncompressed data when compression does not make it smaller`() {
+      val packet = packet(11u, Random(RANDOM_SEED).nextBytes(100))
+
+      compressor.compress(packet) shouldBeSameInstanceAs packet
+   }
+
+   @Test
+   fun `Report compression metrics per packet type`() {
+      compressor.compress(packet(5u, ByteArray(100)))
+      compressor.compress(packet(11u, Random(RANDOM_SEED).nextBytes(100)))
+      compressor.compress(packet(5u, ByteArray(100)))
+
+      val detailsMetrics = compressor.metrics.value[5u].shouldNotBeNull()
+      detailsMetrics.packets shouldBe 2
+      detailsMetrics.compressedPackets shouldBe 2
+      detailsMetrics.originalBytes shouldBe 200L
+      detailsMetrics.compressionRatio shouldBeLessThan 0.5
+
+      val imageMetrics = compressor.metrics.value[11u].shouldNotBeNull()
+      imageMetrics.packets shouldBe 1
+      imageMetrics.compressedPackets shouldBe 0
+      imageMetrics.sentBytes shouldBe 100L
+      imageMetrics.compressionRatio shouldBe 1.0
+   }
+
+   private fun packet(id: UByte, data: ByteArray) = mapOf(
+      0u to PebbleDictionaryItem.UInt8(id),
+      1u to PebbleDictionaryItem.Bytes(data),
+   )
+}
+
+private const val RANDOM_SEED = 1337
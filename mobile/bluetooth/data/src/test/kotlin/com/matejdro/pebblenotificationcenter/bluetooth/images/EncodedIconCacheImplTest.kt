@@ -0,0 +1,118 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.images
+
+import io.kotest.matchers.shouldBe
+import org.junit.jupiter.api.Test
+import org.junit.jupiter.api.io.TempDir
+import java.io.File
+
+class EncodedIconCacheImplTest {
+   @TempDir
+   lateinit var cacheFolder: File
+
+   private var currentTime = 0L
+
+   @Test
+   fun `Only encode icon once`() {
+      val cache = EncodedIconCacheImpl(diskCacheFolder = null)
+      var encodes = 0
+
+      repeat(3) {
+         cache.getOrPut(KEY) {
+            encodes++
+            byteArrayOf(1, 2, 3)
+         } shouldBe byteArrayOf(1, 2, 3)
+      }
+
+      encodes shouldBe 1
+   }
+
+   @Test
+   fun `Encode icons separately for color and monochrome watches`() {
+      val cache = EncodedIconCacheImpl(diskCacheFolder = null)
+
+      cache.getOrPut(KEY) { byteArrayOf(1) }
+      cache.getOrPut(KEY.copy(colorWatch = false)) { byteArrayOf(2) } shouldBe byteArrayOf(2)
+   }
+
+   @Test
+   fun `Load persisted icons after process restart`() {
+      createCache().getOrPut(KEY) { byteArrayOf(1, 2, 3) }
+
+      createCache().getOrPut(KEY) { error("Icon should not be encoded again") } shouldBe byteArrayOf(1, 2, 3)
+   }
+
+   @Test
+   fun `Re-encode expired persisted icons`() {
+      createCache().getOrPut(KEY) { byteArrayOf(1, 2, 3) }
+
+      currentTime = File(cacheFolder, cacheFolder.list()!!.single()).lastModified() + 2
+      createCache().getOrPut(KEY) { byteArrayOf(4) } shouldBe byteArrayOf(4)
+   }
+
+   @Test
+   fun `Only cache icons that failed to load in memory`() {
+      val cache = createCache()
+      cache.getOrPut(KEY) { byteArrayOf() }
+
+      cache.getOrPut(KEY) { error("Icon should not be encoded again") } shouldBe byteArrayOf()
+      createCache().getOrPut(KEY) { byteArrayOf(1, 2, 3) } shouldBe byteArrayOf(1, 2, 3)
+   }
+
+   @Test
+   fun `Do not leave temporary files behind`() {
+      val cache = createCache()
+      cache.getOrPut(KEY) { byteArrayOf(1) }
+      cache.getOrPut(KEY.copy(iconId = "com.app:11:1000")) { byteArrayOf(2) }
+
+      cacheFolder.list()!!.filter { it.endsWith(".tmp") } shouldBe emptyList()
+      cacheFolder.list()!!.size shouldBe 2
+   }
+
+   @Test
+   fun `Delete expired icons that are not read anymore`() {
+      createCache().getOrPut(KEY) { byteArrayOf(1, 2, 3) }
+      val expiredFile = File(cacheFolder, cacheFolder.list()!!.single())
+
+      currentTime = expiredFile.lastModified() + 2
+      createCache().getOrPut(KEY.copy(iconId = "com.app:10:2000")) { byteArrayOf(4) }
+
+      expiredFile.exists() shouldBe false
+   }
+
+   @Test
+   fun `Delete oldest icons when the cache is too large`() {
+      val cache = createCache()
+      cache.getOrPut(KEY) { byteArrayOf(1, 2, 3) }
+      cache.getOrPut(KEY.copy(iconId = "com.app:11:1000")) { byteArrayOf(4, 5, 6) }
+
+      val (olderFile, newerFile) = cacheFolder.listFiles()!!.toList()
+      olderFile.setLastModified(newerFile.lastModified() - 1000)
+
+      createCache(maxDiskBytes = 4).getOrPut(KEY.copy(iconId = "com.app:12:1000")) { byteArrayOf(7) }
+
+      olderFile.exists() shouldBe false
+      newerFile.exists() shouldBe true
+   }
+
+   @Test
+   fun `Delete temporary files left behind by a process death`() {
+      val temporaryFile = File(cacheFolder, "icon.png123.tmp")
+      temporaryFile.writeBytes(byteArrayOf(1))
+
+      currentTime = temporaryFile.lastModified() + 2 * 60 * 1000
+      createCache().getOrPut(KEY) { byteArrayOf(1, 2, 3) }
+
+      temporaryFile.exists() shouldBe false
+   }
+
+   private fun createCache(maxDiskBytes: Long = 1024): EncodedIconCacheImpl {
+      return EncodedIconCacheImpl(
+         diskCacheFolder = cacheFolder,
+         diskCacheExpiryMillis = 1,
+         maxDiskBytes = maxDiskBytes,
+         currentTimeMillis = { currentTime }
+      )
+   }
+}
+
+private val KEY = EncodedIconKey("com.app", "com.app:10:1000", 32, colorWatch = true)
@@ -0,0 +1,125 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.images
+
+import ar.com.hjg.pngj.PngReaderByte
+import io.kotest.assertions.throwables.shouldThrow
+import io.kotest.matchers.collections.shouldContainExactly
+import io.kotest.matchers.comparables.shouldBeLessThanOrEqualTo
+import io.kotest.matchers.shouldBe
+import org.junit.jupiter.api.Test
+import java.io.ByteArrayInputStream
+import kotlin.time.Duration
+
+class EncodingTest {
+   @Test
+   fun `Encode color images into palette indexes`() {
+      val image = ImagePixels(
+         3,
+         2,
+         intArrayOf(
+            0xFF000000.toInt(), 0xFFFFFFFF.toInt(), 0xFF55AAFF.toInt(),
+            0xFFFF0000.toInt(), 0xFF00FF00.toInt(), 0xFF0000FF.toInt(),
+         )
+      )
+
+      val reader = PngReaderByte(ByteArrayInputStream(image.encodeColorImageIntoBytes()))
+
+      reader.imgInfo.indexed shouldBe true
+      reader.imgInfo.bitDepth shouldBe 4
+      val palette = reader.metadata.plte
+      palette.nentries shouldBe 6
+      reader.readRowByte().getScanline().take(3).map { palette.getEntry(it.toInt()) }
+         .shouldContainExactly(0x000000, 0xFFFFFF, 0x55AAFF)
+      reader.readRowByte().getScanline().take(3).map { palette.getEntry(it.toInt()) }
+         .shouldContainExactly(0xFF0000, 0x00FF00, 0x0000FF)
+      reader.end()
+   }
+
+   @Test
+   fun `Use the smallest bit depth that fits all used colors`() {
+      for ((colorCount, expectedBitDepth) in listOf(1 to 1, 2 to 1, 3 to 2, 4 to 2, 5 to 4, 16 to 4, 17 to 8, 64 to 8)) {
+         val image = ImagePixels(64, 1, IntArray(64) { 0xFF000000.toInt() or PEBBLE_TIME_PALETTE[it % colorCount] })
+
+         val reader = PngReaderByte(ByteArrayInputStream(image.encodeColorImageIntoBytes()))
+
+         reader.imgInfo.bitDepth shouldBe expectedBitDepth
+         reader.metadata.plte.nentries shouldBe colorCount
+         reader.readRowByte().getScanline().take(64).map { reader.metadata.plte.getEntry(it.toInt()) } shouldBe
+            List(64) { PEBBLE_TIME_PALETTE[it % colorCount] }
+         reader.end()
+      }
+   }
+
+   @Test
+   fun `Throw when encoding colors that are not in the Pebble palette`() {
+      val image = ImagePixels(1, 1, intArrayOf(0xFF123456.toInt()))
+
+      shouldThrow<IllegalArgumentException> {
+         image.encodeColorImageIntoBytes()
+      }
+   }
+
+   @Test
+   fun `Encode monochrome images into 1-bit grayscale`() {
+      val image = ImagePixels(2, 1, intArrayOf(0xFF000000.toInt(), 0xFFFFFFFF.toInt()))
+
+      val reader = PngReaderByte(ByteArrayInputStream(image.encodeMonochromeImageIntoBytes()))
+
+      reader.imgInfo.greyscale shouldBe true
+      reader.imgInfo.bitDepth shouldBe 1
+      reader.imgInfo.cols shouldBe 2
+      reader.end()
+   }
+
+   @Test
+   fun `Stream encoded image into packet chunks`() {
+      val image = ImagePixels(16, 16, IntArray(256) { if (it % 3 == 0) 0xFFFFFFFF.toInt() else 0xFF000000.toInt() })
+      val expectedBytes = image.encodeColorImageIntoBytes()
+
+      val chunkingStream = PacketChunkingOutputStream(headerSize = 4, maxPayloadSize = 10)
+      image.encodeColorImage(chunkingStream)
+      val chunks = chunkingStream.finish()
+
+      chunkingStream.totalBytes shouldBe expectedBytes.size
+      chunks.flatMap { it.drop(4) }.toByteArray() shouldBe expectedBytes
+   }
+
+   @Test
+   fun `Smallest color image should decode into the same pixels as the default one`() {
+      val image = ImagePixels(32, 32, IntArray(1024) { if ((it / 32 + it) % 3 == 0) 0xFFFFFFFF.toInt() else 0xFF55AAFF.toInt() })
+
+      val optimized = image.encodeSmallestColorImage(Duration.INFINITE)
+
+      optimized.bytes.size shouldBeLessThanOrEqualTo optimized.defaultSize
+      optimized.bytesSaved shouldBe optimized.defaultSize - optimized.bytes.size
+      optimized.defaultSize shouldBe image.encodeColorImageIntoBytes().size
+      decodeRows(optimized.bytes) shouldBe decodeRows(image.encodeColorImageIntoBytes())
+   }
+
+   @Test
+   fun `Smallest monochrome image should decode into the same pixels as the default one`() {
+      val image = ImagePixels(32, 32, IntArray(1024) { if (it % 5 == 0) 0xFFFFFFFF.toInt() else 0xFF000000.toInt() })
+
+      val optimized = image.encodeSmallestMonochromeImage(Duration.INFINITE)
+
+      optimized.bytes.size shouldBeLessThanOrEqualTo optimized.defaultSize
+      decodeRows(optimized.bytes) shouldBe decodeRows(image.encodeMonochromeImageIntoBytes())
+   }
+
+   @Test
+   fun `Only use default settings when there is no time budget`() {
+      val image = ImagePixels(16, 16, IntArray(256) { if (it % 3 == 0) 0xFFFFFFFF.toInt() else 0xFF000000.toInt() })
+
+      val optimized = image.encodeSmallestColorImage(Duration.ZERO)
+
+      optimized.settings shouldBe PngSettings.DEFAULT
+      optimized.bytesSaved shouldBe 0
+      optimized.bytes shouldBe image.encodeColorImageIntoBytes()
+   }
+
+   private fun decodeRows(png: ByteArray): List<List<Byte>> {
+      val reader = PngReaderByte(ByteArrayInputStream(png))
+      val rows = List(reader.imgInfo.rows) { reader.readRowByte().getScanline().toList() }
+      reader.end()
+      return rows
+   }
+}
@@ -1,42 +1,19 @@
 package com.matejdro.pebblenotificationcenter.bluetooth.images
 
-import android.graphics.drawable.Drawable
 import android.graphics.drawable.Icon
+import java.io.OutputStream
 
 class FakeDrawableExtractor : DrawableExtractor {
    private val outputMap = mutableMapOf<Any, ByteArray>()
    var wasFilled: Boolean? = null
 
-   fun registerOutput(drawable: Drawable, width: Int, height: Int, colorWatch: Boolean, output: ByteArray) {
-      outputMap[DrawableExtractorRequest(drawable, width, height, colorWatch)] = output
-   }
-
    fun registerOutput(icon: Any, output: ByteArray) {
       outputMap[icon] = output
    }
 
-   override fun convertIconDrawableToBitmapBytes(
-      drawable: Drawable,
-      width: Int,
-      height: Int,
-      colorWatch: Boolean,
-   ): ByteArray {
-      return outputMap[DrawableExtractorRequest(drawable, width, height, colorWatch)]
-         ?: error(
-            "Output of drawable=$drawable, width=$width, height=$height, colorWatch=$colorWatch does not exist." +
-               " Existing fakes: ${outputMap.keys}"
-         )
-   }
-
-   override fun convertIconToBitmapBytes(icon: Icon, fill: Boolean): ByteArray {
+   override fun convertIconToBitmapBytes(icon: Icon, fill: Boolean, output: OutputStream) {
       wasFilled = fill
-      return outputMap[icon] ?: error("Icon $icon does not exist. Existing fakes: ${outputMap.keys}")
+      val bytes = outputMap[icon] ?: error("Icon $icon does not exist. Existing fakes: ${outputMap.keys}")
+      output.write(bytes)
    }
-
-   private data class DrawableExtractorRequest(
-      val drawable: Drawable,
-      val width: Int,
-      val height: Int,
-      val colorWatch: Boolean,
-   )
 }
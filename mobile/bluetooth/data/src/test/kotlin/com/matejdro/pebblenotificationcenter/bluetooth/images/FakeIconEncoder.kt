@@ -0,0 +1,31 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.images
+
+class FakeIconEncoder : IconEncoder {
+   private val outputMap = mutableMapOf<Any, ByteArray>()
+   var drawableConversions = 0
+
+   fun registerOutput(icon: Any, width: Int, height: Int, colorWatch: Boolean, output: ByteArray) {
+      outputMap[IconEncoderRequest(icon, width, height, colorWatch)] = output
+   }
+
+   override fun convertIconToBitmapBytes(
+      icon: Any,
+      width: Int,
+      height: Int,
+      colorWatch: Boolean,
+   ): ByteArray? {
+      drawableConversions++
+      return outputMap[IconEncoderRequest(icon, width, height, colorWatch)]
+         ?: error(
+            "Output of icon=$icon, width=$width, height=$height, colorWatch=$colorWatch does not exist." +
+               " Existing fakes: ${outputMap.keys}"
+         )
+   }
+
+   private data class IconEncoderRequest(
+      val icon: Any,
+      val width: Int,
+      val height: Int,
+      val colorWatch: Boolean,
+   )
+}
@@ -0,0 +1,71 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.images
+
+import io.kotest.matchers.shouldBe
+import org.junit.jupiter.api.Test
+
+class ImageLayoutTest {
+   @Test
+   fun `Fit large photo into the screen`() {
+      val layout = ImageLayout.calculate(4000, 3000, 144, 168, fill = false)
+
+      layout.targetWidth shouldBe 144
+      layout.targetHeight shouldBe 108
+      layout.isCropped shouldBe false
+      layout.calculateSampleSize() shouldBe 16
+   }
+
+   @Test
+   fun `Crop large photo to fill the screen`() {
+      val layout = ImageLayout.calculate(4000, 3000, 144, 168, fill = true)
+
+      layout.targetWidth shouldBe 144
+      layout.targetHeight shouldBe 168
+      layout.isCropped shouldBe true
+
+      layout.destinationLeft shouldBe -40
+      layout.destinationTop shouldBe 0
+      layout.destinationRight shouldBe 184
+      layout.destinationBottom shouldBe 168
+
+      layout.cropLeft shouldBe 714
+      layout.cropTop shouldBe 0
+      layout.cropRight shouldBe 3286
+      layout.cropBottom shouldBe 3000
+
+      layout.calculateSampleSize() shouldBe 16
+   }
+
+   @Test
+   fun `Do not crop images with the same aspect ratio as the screen`() {
+      val layout = ImageLayout.calculate(288, 336, 144, 168, fill = true)
+
+      layout.isCropped shouldBe false
+      layout.calculateSampleSize() shouldBe 2
+   }
+
+   @Test
+   fun `Do not subsample images smaller than the screen`() {
+      val layout = ImageLayout.calculate(100, 50, 200, 228, fill = false)
+
+      layout.targetWidth shouldBe 200
+      layout.targetHeight shouldBe 100
+      layout.calculateSampleSize() shouldBe 1
+   }
+
+   @Test
+   fun `Keep subsampled visible region at least as large as the screen`() {
+      for (sourceWidth in listOf(1000, 3024, 4032, 8000)) {
+         for (sourceHeight in listOf(1000, 3024, 4032, 8000)) {
+            for (fill in listOf(true, false)) {
+               val layout = ImageLayout.calculate(sourceWidth, sourceHeight, 200, 228, fill)
+               val sampleSize = layout.calculateSampleSize()
+
+               ((layout.cropRight - layout.cropLeft) / sampleSize >= layout.targetWidth) shouldBe true
+               ((layout.cropBottom - layout.cropTop) / sampleSize >= layout.targetHeight) shouldBe true
+               ((layout.cropRight - layout.cropLeft) / (sampleSize * 2) >= layout.targetWidth &&
+                  (layout.cropBottom - layout.cropTop) / (sampleSize * 2) >= layout.targetHeight) shouldBe false
+            }
+         }
+      }
+   }
+}
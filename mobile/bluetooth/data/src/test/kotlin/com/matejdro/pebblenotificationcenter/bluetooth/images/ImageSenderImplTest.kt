@@ -5,7 +5,12 @@ import com.matejdro.pebble.bluetooth.WatchMetadata
 import com.matejdro.pebble.bluetooth.common.PacketQueue
 import com.matejdro.pebble.bluetooth.common.test.FakePebbleSender
 import com.matejdro.pebble.bluetooth.common.test.sentData
+import com.matejdro.pebblenotificationcenter.bluetooth.SupersedingPacketSender
 import com.matejdro.pebblenotificationcenter.bluetooth.api.WATCHAPP_UUID
+import com.matejdro.pebblenotificationcenter.bluetooth.compression.PacketCompressor
+import com.matejdro.pebblenotificationcenter.notification.model.LazyImage
+import io.kotest.assertions.throwables.shouldThrow
+import io.kotest.matchers.collections.shouldBeEmpty
 import io.kotest.matchers.collections.shouldContainExactly
 import io.kotest.matchers.shouldBe
 import io.rebble.pebblekit2.common.model.PebbleDictionaryItem
@@ -25,7 +30,11 @@ class ImageSenderImplTest {
 
    private val watchMetadata = WatchMetadata(watchBufferSize = 10000)
 
-   private val imageSender = ImageSenderImpl(drawableExtractor, packetQueue, watchMetadata)
+   private val imageSender = ImageSenderImpl(
+      drawableExtractor,
+      SupersedingPacketSender(packetQueue, PacketCompressor(watchMetadata)),
+      watchMetadata
+   )
 
    @Test
    fun `Send bitmap to the watch when triggering show image action`() = scope.runTest {
@@ -34,7 +43,7 @@ class ImageSenderImplTest {
       val icon = Icon.createWithContentUri("content://image")
       drawableExtractor.registerOutput(icon, byteArrayOf(74))
 
-      imageSender.showImageOnTheWatch(2u, icon, false)
+      imageSender.showImageOnTheWatch(2u, LazyImage { icon }, false)
 
       pebbleSender.sentData.shouldContainExactly(
          listOf(
@@ -57,7 +66,7 @@ class ImageSenderImplTest {
       watchMetadata.watchBufferSize = 150
       drawableExtractor.registerOutput(icon, ByteArray(300))
 
-      imageSender.showImageOnTheWatch(2u, icon, false)
+      imageSender.showImageOnTheWatch(2u, LazyImage { icon }, false)
 
       pebbleSender.sentData.shouldContainExactly(
          listOf(
@@ -77,6 +86,29 @@ class ImageSenderImplTest {
       )
    }
 
+   @Test
+   fun `Refuse to send images that are too large for the watch`() = scope.runTest {
+      initWatchSender()
+
+      val icon = Icon.createWithContentUri("content://image")
+      drawableExtractor.registerOutput(icon, ByteArray(30_000))
+
+      shouldThrow<IllegalStateException> {
+         imageSender.showImageOnTheWatch(2u, LazyImage { icon }, false)
+      }
+
+      pebbleSender.sentData.shouldBeEmpty()
+   }
+
+   @Test
+   fun `Do not send anything when the image is no longer available`() = scope.runTest {
+      initWatchSender()
+
+      imageSender.showImageOnTheWatch(2u, LazyImage { null }, false)
+
+      pebbleSender.sentData.shouldBeEmpty()
+   }
+
    private fun TestScope.initWatchSender() {
       backgroundScope.launch {
          packetQueue.runQueue()
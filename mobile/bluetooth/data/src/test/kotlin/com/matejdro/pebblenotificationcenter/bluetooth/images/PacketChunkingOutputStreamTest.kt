@@ -0,0 +1,43 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.images
+
+import io.kotest.matchers.collections.shouldContainExactly
+import io.kotest.matchers.shouldBe
+import org.junit.jupiter.api.Test
+
+class PacketChunkingOutputStreamTest {
+   @Test
+   fun `Split written bytes into chunks with reserved header space`() {
+      val stream = PacketChunkingOutputStream(headerSize = 2, maxPayloadSize = 3)
+
+      stream.write(byteArrayOf(1, 2, 3, 4, 5))
+      stream.write(6)
+
+      stream.finish().map { it.toList() }.shouldContainExactly(
+         listOf<Byte>(0, 0, 1, 2, 3),
+         listOf<Byte>(0, 0, 4, 5, 6),
+      )
+      stream.totalBytes shouldBe 6
+   }
+
+   @Test
+   fun `Trim the last chunk`() {
+      val stream = PacketChunkingOutputStream(headerSize = 1, maxPayloadSize = 4)
+
+      stream.write(byteArrayOf(1, 2, 3, 4, 5))
+
+      stream.finish().map { it.toList() }.shouldContainExactly(
+         listOf<Byte>(0, 1, 2, 3, 4),
+         listOf<Byte>(0, 5),
+      )
+   }
+
+   @Test
+   fun `Report filled chunks while writing`() {
+      val filledChunks = ArrayList<List<Byte>>()
+      val stream = PacketChunkingOutputStream(headerSize = 0, maxPayloadSize = 2) { filledChunks += it.toList() }
+
+      stream.write(byteArrayOf(1, 2, 3))
+
+      filledChunks.shouldContainExactly(listOf<Byte>(1, 2))
+   }
+}
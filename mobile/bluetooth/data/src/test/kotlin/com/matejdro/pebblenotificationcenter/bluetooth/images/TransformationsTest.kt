@@ -0,0 +1,101 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.images
+
+import io.kotest.matchers.shouldBe
+import org.junit.jupiter.api.Test
+import kotlin.math.roundToInt
+import kotlin.random.Random
+
+class TransformationsTest {
+   @Test
+   fun `Dither solid palette colors into themselves`() {
+      val image = ImagePixels(2, 1, intArrayOf(0xFF55AAFF.toInt(), 0xFF000000.toInt()))
+
+      image.dither(toColorScreen = true)
+
+      image.pixels() shouldBe listOf(0xFF55AAFF.toInt(), 0xFF000000.toInt())
+   }
+
+   @Test
+   fun `Dither gray into black and white checkerboard`() {
+      val image = ImagePixels(2, 2, IntArray(4) { 0xFF808080.toInt() })
+
+      image.dither(toColorScreen = false)
+
+      image.pixels() shouldBe listOf(
+         0xFFFFFFFF.toInt(),
+         0xFF000000.toInt(),
+         0xFF000000.toInt(),
+         0xFFFFFFFF.toInt(),
+      )
+   }
+
+   @Test
+   fun `Color dithering should match the reference Floyd Steinberg implementation`() {
+      val random = Random(RANDOM_SEED)
+      val pixels = IntArray(TEST_WIDTH * TEST_HEIGHT) { random.nextInt() }
+
+      val image = ImagePixels(TEST_WIDTH, TEST_HEIGHT, pixels.copyOf())
+      image.dither(toColorScreen = true)
+
+      image.pixels() shouldBe referenceDither(TEST_WIDTH, TEST_HEIGHT, pixels, toColorScreen = true).toList()
+   }
+
+   @Test
+   fun `Black and white dithering should match the reference Floyd Steinberg implementation`() {
+      val random = Random(RANDOM_SEED)
+      val pixels = IntArray(TEST_WIDTH * TEST_HEIGHT) { random.nextInt() }
+
+      val image = ImagePixels(TEST_WIDTH, TEST_HEIGHT, pixels.copyOf())
+      image.dither(toColorScreen = false)
+
+      image.pixels() shouldBe referenceDither(TEST_WIDTH, TEST_HEIGHT, pixels, toColorScreen = false).toList()
+   }
+
+   private fun ImagePixels.pixels(): List<Int> {
+      return (0 until height).flatMap { y -> (0 until width).map { x -> this[x, y] } }
+   }
+
+   /**
+    * Straightforward per-pixel implementation of the dithering, used to verify the optimized one
+    */
+   @Suppress("MagicNumber")
+   private fun referenceDither(width: Int, height: Int, input: IntArray, toColorScreen: Boolean): IntArray {
+      val colors = Array(width * height) {
+         intArrayOf((input[it] shr 16) and 0xFF, (input[it] shr 8) and 0xFF, input[it] and 0xFF)
+      }
+      val output = IntArray(width * height)
+
+      for (y in 0 until height) {
+         for (x in 0 until width) {
+            val old = colors[y * width + x]
+            val new = if (toColorScreen) {
+               IntArray(3) { (old[it] / 85f).roundToInt() * 85 }
+            } else {
+               val luma = (old[0] + old[0] + old[2] + old[1] + old[1] + old[1]) / 6
+               IntArray(3) { if (luma > 255 / 2) 255 else 0 }
+            }
+            output[y * width + x] = (0xFF shl 24) or (new[0] shl 16) or (new[1] shl 8) or new[2]
+
+            val error = IntArray(3) { old[it] - new[it] }
+            fun spread(targetX: Int, targetY: Int, scalar: Int) {
+               if (targetX !in 0 until width || targetY >= height) return
+               val target = colors[targetY * width + targetX]
+               for (channel in 0 until 3) {
+                  target[channel] += error[channel] * scalar / 16
+               }
+            }
+
+            spread(x + 1, y, 7)
+            spread(x - 1, y + 1, 3)
+            spread(x, y + 1, 5)
+            spread(x + 1, y + 1, 1)
+         }
+      }
+
+      return output
+   }
+}
+
+private const val TEST_WIDTH = 37
+private const val TEST_HEIGHT = 23
+private const val RANDOM_SEED = 1234
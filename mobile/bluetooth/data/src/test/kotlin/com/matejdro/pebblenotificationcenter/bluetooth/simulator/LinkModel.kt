@@ -0,0 +1,28 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.simulator
+
+import kotlin.random.Random
+import kotlin.time.Duration
+import kotlin.time.Duration.Companion.milliseconds
+import kotlin.time.Duration.Companion.seconds
+
+/**
+ * Model of the Bluetooth link between the phone and the simulated watch.
+ *
+ * Every packet takes [latency] plus its size divided by the [bytesPerSecond] to arrive. Packets are dropped with the
+ * [dropProbability], in which case the sender only finds out after the [timeout].
+ */
+data class LinkModel(
+   val latency: Duration = 30.milliseconds,
+   val bytesPerSecond: Int = 4_000,
+   val dropProbability: Double = 0.0,
+   val timeout: Duration = 5.seconds,
+   val random: Random = Random(0),
+) {
+   fun transmissionTime(bytes: Int): Duration {
+      return latency + (bytes.toDouble() / bytesPerSecond).seconds
+   }
+
+   fun shouldDrop(): Boolean {
+      return dropProbability > 0 && random.nextDouble() < dropProbability
+   }
+}
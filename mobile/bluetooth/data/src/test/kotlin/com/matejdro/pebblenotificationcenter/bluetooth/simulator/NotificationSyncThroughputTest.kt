@@ -0,0 +1,181 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.simulator
+
+import androidx.datastore.preferences.core.emptyPreferences
+import com.matejdro.bucketsync.BucketSyncRepository
+import com.matejdro.bucketsync.BucketSyncWatchLoopImpl
+import com.matejdro.bucketsync.FakeBucketSyncRepository
+import com.matejdro.bucketsync.background.FakeBackgroundSyncNotifier
+import com.matejdro.pebble.bluetooth.WatchMetadata
+import com.matejdro.pebble.bluetooth.common.PacketQueue
+import com.matejdro.pebble.bluetooth.common.WatchAppConnection
+import com.matejdro.pebblenotificationcenter.FakeNotificationServiceController
+import com.matejdro.pebblenotificationcenter.bluetooth.FakeNotificationDetailsPusher
+import com.matejdro.pebblenotificationcenter.bluetooth.FakeWatchappOpenController
+import com.matejdro.pebblenotificationcenter.bluetooth.PROTOCOL_VERSION
+import com.matejdro.pebblenotificationcenter.bluetooth.SupersedingPacketSender
+import com.matejdro.pebblenotificationcenter.bluetooth.WatchSyncerImpl
+import com.matejdro.pebblenotificationcenter.bluetooth.WatchappConnectionImpl
+import com.matejdro.pebblenotificationcenter.bluetooth.api.WATCHAPP_UUID
+import com.matejdro.pebblenotificationcenter.bluetooth.compression.PacketCompressor
+import com.matejdro.pebblenotificationcenter.bluetooth.images.FakeImageSender
+import com.matejdro.pebblenotificationcenter.common.test.InMemoryDataStore
+import com.matejdro.pebblenotificationcenter.notification.FakeActionHandler
+import com.matejdro.pebblenotificationcenter.notification.FakeNotificationRepository
+import com.matejdro.pebblenotificationcenter.notification.FakeSubmenuActionHandler
+import com.matejdro.pebblenotificationcenter.notification.model.ParsedNotification
+import com.matejdro.pebblenotificationcenter.notification.model.ProcessedNotification
+import dispatch.core.DefaultCoroutineScope
+import io.kotest.matchers.collections.shouldBeEmpty
+import io.kotest.matchers.collections.shouldContainExactlyInAnyOrder
+import io.kotest.matchers.collections.shouldNotBeEmpty
+import io.kotest.matchers.comparables.shouldBeGreaterThan
+import io.kotest.matchers.comparables.shouldBeLessThan
+import io.kotest.matchers.nulls.shouldNotBeNull
+import io.kotest.matchers.shouldBe
+import io.kotest.matchers.shouldNotBe
+import io.rebble.pebblekit2.common.model.WatchIdentifier
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.test.runTest
+import org.junit.jupiter.api.Test
+import si.inova.kotlinova.core.test.TestScopeWithDispatcherProvider
+import java.time.Instant
+import kotlin.time.Duration.Companion.milliseconds
+import kotlin.time.Duration.Companion.seconds
+
+/**
+ * End-to-end tests of the notification sync, running the real phone protocol stack against the [WatchSimulator]
+ */
+class NotificationSyncThroughputTest {
+   private val scope = TestScopeWithDispatcherProvider()
+
+   private val bucketSyncRepository = FakeBucketSyncRepository(PROTOCOL_VERSION.toInt())
+   private val watchSyncer = WatchSyncerImpl(
+      bucketSyncRepository,
+      InMemoryDataStore(emptyPreferences()),
+      DefaultCoroutineScope(scope.backgroundScope.coroutineContext),
+   )
+
+   private val simulator = WatchSimulator(
+      scope.backgroundScope,
+      currentTime = { scope.testScheduler.currentTime.milliseconds },
+   )
+
+   @Test
+   fun `Sync a notification storm to the watch`() = scope.runTest {
+      init()
+      simulator.open(connectionFactory(), backgroundScope)
+      delay(1.seconds)
+
+      repeat(NOTIFICATION_STORM_SIZE) {
+         watchSyncer.syncNotification(notification(it), emptyPreferences())
+         delay(100.milliseconds)
+      }
+      delay(30.seconds)
+
+      simulator.violations.shouldBeEmpty()
+      simulator.assertWatchMatchesThePhone()
+
+      // Bucket 1 contains the total number of notifications
+      simulator.buckets.value[1].shouldNotBeNull().data[3].toInt() shouldBe NOTIFICATION_STORM_SIZE
+
+      val completedSyncs = simulator.completedSyncs.value
+      completedSyncs.shouldNotBeEmpty()
+      completedSyncs.forEach { it.latency shouldBeLessThan 5.seconds }
+
+      val stats = simulator.stats.value
+      stats.bytesToWatch shouldBeGreaterThan 0L
+      stats.droppedPackets shouldBe 0
+      stats.nackedPackets shouldBe 0
+      stats.maxQueueDepth shouldBeGreaterThan 0
+   }
+
+   @Test
+   fun `Resync notifications that were posted while the watch was disconnected`() = scope.runTest {
+      init()
+      simulator.open(connectionFactory(), backgroundScope)
+      watchSyncer.syncNotification(notification(0), emptyPreferences())
+      delay(5.seconds)
+
+      simulator.disconnect()
+      repeat(5) {
+         watchSyncer.syncNotification(notification(it + 1), emptyPreferences())
+      }
+      delay(30.seconds)
+
+      simulator.bucketSyncVersion shouldNotBe bucketSyncRepository.checkForNextUpdate(0u, emptyList())?.component1()
+
+      simulator.reconnect()
+      delay(30.seconds)
+
+      simulator.violations.shouldBeEmpty()
+      simulator.assertWatchMatchesThePhone()
+      simulator.buckets.value.keys.shouldContainExactlyInAnyOrder(1, 2, 3, 4, 5, 6, 7)
+   }
+
+   private suspend fun init() {
+      bucketSyncRepository.init(1, 2..BucketSyncRepository.MAX_BUCKET_ID)
+      watchSyncer.init(enablePreferences = true)
+   }
+
+   private suspend fun WatchSimulator.assertWatchMatchesThePhone() {
+      val (latestVersion, activeBuckets, phoneBuckets) = bucketSyncRepository.checkForNextUpdate(0u, emptyList())
+         .shouldNotBeNull()
+
+      bucketSyncVersion shouldBe latestVersion
+      buckets.value.keys.shouldContainExactlyInAnyOrder(activeBuckets.map { it.toInt() })
+      buckets.value.mapValues { it.value.data.toList() } shouldBe
+         phoneBuckets.associate { (id, data) -> id.toInt() to data.toList() }
+   }
+
+   private fun connectionFactory(): WatchAppConnection.Factory {
+      return object : WatchAppConnection.Factory {
+         override fun create(watch: WatchIdentifier, scope: CoroutineScope): WatchAppConnection {
+            val packetQueue = PacketQueue(simulator, watch, WATCHAPP_UUID)
+            val watchMetadata = WatchMetadata()
+            val watchappOpenController = FakeWatchappOpenController()
+
+            return WatchappConnectionImpl(
+               scope,
+               watchappOpenController,
+               packetQueue,
+               BucketSyncWatchLoopImpl(
+                  scope,
+                  packetQueue,
+                  bucketSyncRepository,
+                  watchappOpenController,
+                  FakeBackgroundSyncNotifier(),
+                  watch,
+               ),
+               FakeNotificationDetailsPusher(),
+               FakeActionHandler(),
+               FakeSubmenuActionHandler(),
+               FakeNotificationRepository(),
+               watch,
+               InMemoryDataStore(emptyPreferences()),
+               watchMetadata,
+               FakeNotificationServiceController(),
+               FakeImageSender(),
+               SupersedingPacketSender(packetQueue, PacketCompressor(watchMetadata)),
+               watchSyncer,
+            )
+         }
+      }
+   }
+
+   private fun notification(index: Int): ProcessedNotification {
+      return ProcessedNotification(
+         ParsedNotification(
+            "key$index",
+            "com.app${index % 10}",
+            "Group chat $index",
+            "Sender $index",
+            "Message number $index in a very busy group chat",
+            // 19:18:25 GMT | Sunday, January 4, 2026
+            Instant.ofEpochSecond(1_767_554_305L + index)
+         )
+      )
+   }
+}
+
+private const val NOTIFICATION_STORM_SIZE = 30
@@ -0,0 +1,32 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.simulator
+
+import kotlin.time.Duration
+
+/**
+ * Traffic counters of the [WatchSimulator]. Byte counts are sizes of the serialized AppMessage dictionaries.
+ */
+data class SimulatorStats(
+   val packetsToWatch: Int = 0,
+   val bytesToWatch: Long = 0,
+   val packetsToPhone: Int = 0,
+   val bytesToPhone: Long = 0,
+   val droppedPackets: Int = 0,
+   val nackedPackets: Int = 0,
+   /**
+    * Maximum number of phone packets that were in the air at the same time
+    */
+   val maxQueueDepth: Int = 0,
+)
+
+/**
+ * Bucketsync transfer that completed on the watch
+ *
+ * @param latency time between the first packet of this sync and the completion of the sync
+ */
+data class CompletedSync(
+   val version: UShort,
+   val completedAt: Duration,
+   val latency: Duration,
+   val packets: Int,
+   val bytes: Long,
+)
@@ -0,0 +1,427 @@
+package com.matejdro.pebblenotificationcenter.bluetooth.simulator
+
+import com.matejdro.pebble.bluetooth.common.WatchAppConnection
+import com.matejdro.pebblenotificationcenter.bluetooth.PROTOCOL_VERSION
+import com.matejdro.pebblenotificationcenter.bluetooth.api.WATCHAPP_UUID
+import io.rebble.pebblekit2.client.PebbleSender
+import io.rebble.pebblekit2.common.model.PebbleDictionary
+import io.rebble.pebblekit2.common.model.PebbleDictionaryItem
+import io.rebble.pebblekit2.common.model.TransmissionResult
+import io.rebble.pebblekit2.common.model.WatchIdentifier
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.MutableStateFlow
+import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.update
+import kotlinx.coroutines.launch
+import okio.Buffer
+import java.util.UUID
+import kotlin.time.Duration
+
+/**
+ * In-process simulation of the watch half of the protocol (see protocol.md), connected to the phone half
+ * through a [LinkModel].
+ *
+ * Phone side sends packets to the simulator by using it as its [PebbleSender]. Simulator sends packets back by calling
+ * the [WatchAppConnection] created with [open].
+ *
+ * Simulator keeps bucket storage with the same limits as the real watch (15 buckets, 255 bytes each) and records
+ * every breach of the protocol into the [violations] instead of throwing, so a test can report all of them at once.
+ */
+@Suppress("MagicNumber") // Packet processing involves a lot of numbers, it would be less readable to make consts
+class WatchSimulator(
+   private val scope: CoroutineScope,
+   private val currentTime: () -> Duration,
+   val link: LinkModel = LinkModel(),
+   private val watch: WatchIdentifier = WatchIdentifier("Simulator"),
+   private val bufferSize: Int = DEFAULT_BUFFER_SIZE,
+   private val colorScreen: Boolean = true,
+   private val screenWidth: Int = 144,
+   private val screenHeight: Int = 168,
+   private val protocolVersion: UShort = PROTOCOL_VERSION,
+) : PebbleSender {
+   private var connection: WatchAppConnection? = null
+   private var connected = true
+
+   private val _buckets = MutableStateFlow<Map<Int, StoredBucket>>(emptyMap())
+
+   /**
+    * Buckets that are currently stored on the watch, by their ID
+    */
+   val buckets: StateFlow<Map<Int, StoredBucket>> = _buckets
+
+   var bucketSyncVersion: UShort = 0u
+      private set
+
+   private var pendingSync: PendingSync? = null
+
+   private val _completedSyncs = MutableStateFlow<List<CompletedSync>>(emptyList())
+   val completedSyncs: StateFlow<List<CompletedSync>> = _completedSyncs
+
+   private val _stats = MutableStateFlow(SimulatorStats())
+   val stats: StateFlow<SimulatorStats> = _stats
+
+   private var packetsInTheAir = 0
+
+   val violations = ArrayList<String>()
+   val receivedVibrations = ArrayList<List<Int>>()
+   val receivedNotificationDetails = ArrayList<Int>()
+   val receivedSubmenus = ArrayList<Int>()
+   val receivedImages = ArrayList<ReceivedImage>()
+   var phoneProtocolMismatch = false
+      private set
+
+   private var incomingImage: Buffer? = null
+
+   /**
+    * Open the watchapp: create the phone-side connection with the [factory] and send the welcome packet
+    */
+   fun open(factory: WatchAppConnection.Factory, connectionScope: CoroutineScope) {
+      connection = factory.create(watch, connectionScope)
+      sendWelcome()
+   }
+
+   /**
+    * Drop the connection. Until [reconnect] is called, all packets in both directions are lost.
+    */
+   fun disconnect() {
+      connected = false
+   }
+
+   /**
+    * Re-establish the connection. Like the real watchapp, simulator re-sends the welcome packet to resume the sync.
+    */
+   fun reconnect() {
+      connected = true
+      sendWelcome()
+   }
+
+   /**
+    * Simulate user opening the notification in the [bucketId], which requests its details
+    */
+   fun openNotification(bucketId: Int) {
+      sendToPhone(
+         mapOf(
+            0u to PebbleDictionaryItem.UInt32(4u),
+            1u to PebbleDictionaryItem.UInt32(bucketId.toUInt()),
+         )
+      )
+   }
+
+   /**
+    * Simulate user scrolling to the notification with the [index] outside the notification window
+    */
+   fun moveWindow(index: Int) {
+      sendToPhone(
+         mapOf(
+            0u to PebbleDictionaryItem.UInt32(16u),
+            1u to PebbleDictionaryItem.UInt32(index.toUInt()),
+         )
+      )
+   }
+
+   override suspend fun sendDataToPebble(
+      watchappUUID: UUID,
+      data: PebbleDictionary,
+      watches: List<WatchIdentifier>?,
+   ): Map<WatchIdentifier, TransmissionResult> {
+      val size = data.encodedSize()
+      val sentAt = currentTime()
+
+      packetsInTheAir++
+      _stats.update { it.copy(maxQueueDepth = maxOf(it.maxQueueDepth, packetsInTheAir)) }
+      try {
+         if (!connected || link.shouldDrop()) {
+            delay(link.timeout)
+            _stats.update { it.copy(droppedPackets = it.droppedPackets + 1) }
+            return mapOf(watch to TransmissionResult.FailedTimeout)
+         }
+
+         delay(link.transmissionTime(size))
+         _stats.update { it.copy(packetsToWatch = it.packetsToWatch + 1, bytesToWatch = it.bytesToWatch + size) }
+         pendingSync?.let {
+            it.packets++
+            it.bytes += size
+         }
+
+         if (watchappUUID != WATCHAPP_UUID) {
+            violations += "Packet sent to the unknown app $watchappUUID"
+            return mapOf(watch to TransmissionResult.FailedWatchNack)
+         }
+
+         if (size > bufferSize) {
+            violations += "Packet ${data.packetId()} has $size bytes, but the watch buffer only has $bufferSize bytes"
+            _stats.update { it.copy(nackedPackets = it.nackedPackets + 1) }
+            return mapOf(watch to TransmissionResult.FailedWatchNack)
+         }
+
+         receivePacket(data, size, sentAt)
+      } finally {
+         packetsInTheAir--
+      }
+
+      return mapOf(watch to TransmissionResult.Success)
+   }
+
+   override suspend fun startAppOnTheWatch(
+      watchappUUID: UUID,
+      watches: List<WatchIdentifier>?,
+   ): Map<WatchIdentifier, TransmissionResult> {
+      return mapOf(watch to TransmissionResult.Success)
+   }
+
+   override suspend fun stopAppOnTheWatch(
+      watchappUUID: UUID,
+      watches: List<WatchIdentifier>?,
+   ): Map<WatchIdentifier, TransmissionResult> {
+      return mapOf(watch to TransmissionResult.Success)
+   }
+
+   override fun close() {}
+
+   private fun receivePacket(data: PebbleDictionary, size: Int, sentAt: Duration) {
+      when (val id = data.packetId()) {
+         1 -> receivePhoneWelcome(data, size, sentAt)
+         2 -> receiveSyncStart(data.requireBuffer(1u), size, sentAt)
+         3 -> receiveSyncContinuation(data.requireBuffer(1u))
+         5 -> receivedNotificationDetails += data.requireBuffer(1u).readUByte().toInt()
+         7 -> receiveVibration(data.requireBuffer(1u))
+         9 -> receivedSubmenus += data.requireBuffer(1u).readUByte().toInt()
+         11 -> receiveImagePart(data.requireBuffer(1u))
+         12 -> sendWelcome()
+         else -> violations += "Unknown packet $id"
+      }
+   }
+
+   private fun receivePhoneWelcome(data: PebbleDictionary, size: Int, sentAt: Duration) {
+      val phoneVersion = (data[1u] as? PebbleDictionaryItem.UInt16)?.value
+      if (phoneVersion != protocolVersion) {
+         phoneProtocolMismatch = true
+         return
+      }
+
+      val syncData = data.requireBuffer(2u)
+      val status = syncData.readUByte().toInt()
+      if (status == SYNC_STATUS_UP_TO_DATE) {
+         return
+      }
+
+      startSync(syncData, complete = status == SYNC_STATUS_LAST_PACKET, size, sentAt)
+   }
+
+   private fun receiveSyncStart(syncData: Buffer, size: Int, sentAt: Duration) {
+      val complete = syncData.readUByte().toInt() == 1
+      startSync(syncData, complete, size, sentAt)
+   }
+
+   private fun startSync(syncData: Buffer, complete: Boolean, size: Int, sentAt: Duration) {
+      if (pendingSync != null) {
+         violations += "New sync started before the previous one was completed"
+      }
+
+      val version = syncData.readShort().toUShort()
+      val activeBucketCount = syncData.readUByte().toInt()
+      if (activeBucketCount > MAX_BUCKETS) {
+         violations += "Phone sent $activeBucketCount active buckets, watch can only store $MAX_BUCKETS"
+      }
+
+      val activeBuckets = List(activeBucketCount) {
+         syncData.readUByte().toInt() to syncData.readUByte()
+      }
+
+      pendingSync = PendingSync(version, startedAt = sentAt, packets = 1, bytes = size.toLong())
+
+      _buckets.update { oldBuckets ->
+         activeBuckets.associate { (id, flags) ->
+            val data = oldBuckets[id]?.data ?: ByteArray(0)
+            id to StoredBucket(data, flags)
+         }
+      }
+
+      receiveBucketData(syncData)
+      if (complete) {
+         completeSync()
+      }
+   }
+
+   private fun receiveSyncContinuation(syncData: Buffer) {
+      if (pendingSync == null) {
+         violations += "Received follow-up bucket data without a sync start"
+      }
+
+      val complete = syncData.readUByte().toInt() == 1
+      receiveBucketData(syncData)
+      if (complete) {
+         completeSync()
+      }
+   }
+
+   private fun receiveBucketData(syncData: Buffer) {
+      while (!syncData.exhausted()) {
+         val id = syncData.readUByte().toInt()
+         val size = syncData.readUByte().toInt()
+         if (syncData.size < size) {
+            violations += "Bucket $id declares $size bytes, but the packet only has ${syncData.size} bytes left"
+            return
+         }
+
+         val data = syncData.readByteArray(size.toLong())
+         if (id !in 1..MAX_BUCKETS) {
+            violations += "Bucket id $id is outside of the watch storage"
+            continue
+         }
+
+         _buckets.update { buckets ->
+            val existing = buckets[id]
+            if (existing == null) {
+               violations += "Received data for bucket $id that is not in the active bucket list"
+               buckets
+            } else {
+               buckets + (id to existing.copy(data = data))
+            }
+         }
+      }
+   }
+
+   private fun completeSync() {
+      val sync = pendingSync ?: return
+      pendingSync = null
+
+      bucketSyncVersion = sync.version
+      val now = currentTime()
+      _completedSyncs.update {
+         it + CompletedSync(sync.version, now, latency = now - sync.startedAt, sync.packets, sync.bytes)
+      }
+   }
+
+   private fun receiveVibration(data: Buffer) {
+      val pattern = ArrayList<Int>()
+      while (!data.exhausted()) {
+         pattern += data.readShort().toUShort().toInt()
+      }
+      receivedVibrations += pattern
+   }
+
+   private fun receiveImagePart(data: Buffer) {
+      val notificationId = data.readUByte().toInt()
+      val totalSize = data.readShort().toUShort().toInt()
+      val flags = data.readUByte().toInt()
+
+      if (flags and IMAGE_FLAG_FIRST != 0) {
+         incomingImage = Buffer()
+      }
+
+      val image = incomingImage
+      if (image == null) {
+         violations += "Received image data without the first image packet"
+         return
+      }
+      image.writeAll(data)
+
+      if (flags and IMAGE_FLAG_LAST != 0) {
+         if (image.size != totalSize.toLong()) {
+            violations += "Image declares $totalSize bytes, but ${image.size} bytes were received"
+         }
+         receivedImages += ReceivedImage(notificationId, image.readByteArray())
+         incomingImage = null
+      }
+   }
+
+   private fun sendWelcome() {
+      pendingSync = null
+
+      val flags = if (colorScreen) 1u else 0u
+      sendToPhone(
+         mapOf(
+            0u to PebbleDictionaryItem.UInt32(0u),
+            1u to PebbleDictionaryItem.UInt32(protocolVersion.toUInt()),
+            2u to PebbleDictionaryItem.UInt32(bucketSyncVersion.toUInt()),
+            3u to PebbleDictionaryItem.UInt32(bufferSize.toUInt()),
+            4u to PebbleDictionaryItem.UInt32(flags),
+            5u to PebbleDictionaryItem.UInt32(screenWidth.toUInt()),
+            6u to PebbleDictionaryItem.UInt32(screenHeight.toUInt()),
+            7u to PebbleDictionaryItem.Bytes(_buckets.value.keys.map { it.toByte() }.toByteArray()),
+         )
+      )
+   }
+
+   private fun sendToPhone(data: PebbleDictionary) {
+      val connection = connection ?: error("Watchapp is not open")
+      val size = data.encodedSize()
+
+      scope.launch {
+         delay(link.transmissionTime(size))
+         if (!connected || link.shouldDrop()) {
+            _stats.update { it.copy(droppedPackets = it.droppedPackets + 1) }
+            return@launch
+         }
+
+         _stats.update { it.copy(packetsToPhone = it.packetsToPhone + 1, bytesToPhone = it.bytesToPhone + size) }
+         connection.onPacketReceived(data)
+      }
+   }
+
+   data class StoredBucket(val data: ByteArray, val flags: UByte) {
+      override fun equals(other: Any?): Boolean {
+         if (this === other) return true
+         if (other !is StoredBucket) return false
+
+         return data.contentEquals(other.data) && flags == other.flags
+      }
+
+      override fun hashCode(): Int {
+         return 31 * data.contentHashCode() + flags.hashCode()
+      }
+   }
+
+   class ReceivedImage(val notificationId: Int, val data: ByteArray)
+
+   private class PendingSync(
+      val version: UShort,
+      val startedAt: Duration,
+      var packets: Int,
+      var bytes: Long,
+   )
+}
+
+/**
+ * Size of the dictionary when serialized into an AppMessage: one byte for the number of entries and, for every entry,
+ * 4 bytes for the key, 1 byte for the type and 2 bytes for the length, followed by the value.
+ */
+@Suppress("MagicNumber") // AppMessage format constants
+internal fun PebbleDictionary.encodedSize(): Int {
+   return 1 + entries.sumOf { (_, item) ->
+      val valueSize = when (item) {
+         is PebbleDictionaryItem.UInt8 -> 1
+         is PebbleDictionaryItem.UInt16 -> 2
+         is PebbleDictionaryItem.UInt32 -> 4
+         is PebbleDictionaryItem.Bytes -> item.value.size
+         is PebbleDictionaryItem.Text -> item.value.encodeToByteArray().size + 1
+         else -> error("Unsupported dictionary item $item")
+      }
+
+      7 + valueSize
+   }
+}
+
+private fun PebbleDictionary.packetId(): Int {
+   return when (val id = get(0u)) {
+      is PebbleDictionaryItem.UInt8 -> id.value.toInt()
+      is PebbleDictionaryItem.UInt32 -> id.value.toInt()
+      else -> -1
+   }
+}
+
+private fun PebbleDictionary.requireBuffer(key: UInt): Buffer {
+   val bytes = (get(key) as? PebbleDictionaryItem.Bytes)?.value ?: error("Missing byte array $key")
+   return Buffer().write(bytes)
+}
+
+private fun Buffer.readUByte(): UByte = readByte().toUByte()
+
+private const val DEFAULT_BUFFER_SIZE = 1_000
+private const val MAX_BUCKETS = 15
+private const val SYNC_STATUS_UP_TO_DATE = 2
+private const val SYNC_STATUS_LAST_PACKET = 1
+private const val IMAGE_FLAG_FIRST = 0x01
+private const val IMAGE_FLAG_LAST = 0x02
@@ -9,4 +9,8 @@ data class HistoryEntry(
    val affectedRules: List<String> = emptyList(),
    val muteReason: String? = null,
    val hideReason: String? = null,
+   /**
+    * Database ID of the entry, used to page through entries with the same [time]. 0 for entries that were not stored yet.
+    */
+   val id: Long = 0,
 )
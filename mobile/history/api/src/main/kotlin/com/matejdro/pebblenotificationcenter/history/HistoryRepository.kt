@@ -4,6 +4,32 @@ import kotlinx.coroutines.flow.Flow
 import si.inova.kotlinova.core.outcome.Outcome
 
 interface HistoryRepository {
-   fun getHistory(): Flow<Outcome<List<HistoryEntry>>>
+   /**
+    * Get up to [limit] latest history entries, newest first
+    */
+   fun getHistory(limit: Int): Flow<Outcome<List<HistoryEntry>>>
+
+   /**
+    * Get up to [limit] latest history entries that contain all words of the [query], newest first.
+    * Words are matched by their prefix.
+    */
+   fun search(query: String, limit: Int): Flow<Outcome<List<HistoryEntry>>>
+
+   /**
+    * Get the [oldestEntry] and all newer history entries that match the [query], newest first. Blank query matches all entries.
+    * Used to keep the already loaded pages of the history up to date.
+    */
+   fun getHistoryNewerThan(oldestEntry: HistoryEntry, query: String): Flow<Outcome<List<HistoryEntry>>>
+
+   /**
+    * Load up to [limit] history entries that are older than the [newestEntry] and match the [query], newest first.
+    * Blank query matches all entries.
+    */
+   suspend fun loadHistoryOlderThan(newestEntry: HistoryEntry, query: String, limit: Int): List<HistoryEntry>
+
+   /**
+    * Queue the [entry] to be written into the history. Entries are written in batches, so they might not appear
+    * in the [getHistory] immediately.
+    */
    suspend fun addHistoryEntry(entry: HistoryEntry)
 }
@@ -8,11 +8,53 @@ import si.inova.kotlinova.core.outcome.Outcome
 
 class FakeHistoryRepository : HistoryRepository {
    private val historyStore = MutableStateFlow<List<HistoryEntry>>(emptyList())
-   override fun getHistory(): Flow<Outcome<List<HistoryEntry>>> {
-      return historyStore.map { Outcome.Success(it) }
+   override fun getHistory(limit: Int): Flow<Outcome<List<HistoryEntry>>> {
+      return historyStore.map { Outcome.Success(it.take(limit)) }
+   }
+
+   override fun search(query: String, limit: Int): Flow<Outcome<List<HistoryEntry>>> {
+      return historyStore.map { entries -> Outcome.Success(entries.filterMatching(query).take(limit)) }
+   }
+
+   override fun getHistoryNewerThan(oldestEntry: HistoryEntry, query: String): Flow<Outcome<List<HistoryEntry>>> {
+      return historyStore.map { entries ->
+         val newerEntries = entries.take(entries.indexOf(oldestEntry) + 1)
+         Outcome.Success(newerEntries.filterMatching(query))
+      }
+   }
+
+   override suspend fun loadHistoryOlderThan(newestEntry: HistoryEntry, query: String, limit: Int): List<HistoryEntry> {
+      val entries = historyStore.value
+      val olderEntries = entries.drop(entries.indexOf(newestEntry) + 1)
+      return olderEntries.filterMatching(query).take(limit)
    }
 
    override suspend fun addHistoryEntry(entry: HistoryEntry) {
       historyStore.update { it + entry }
    }
 }
+
+/**
+ * Mimics the full-text search of the real repository: every query word has to be a prefix of a word in the entry
+ */
+private fun List<HistoryEntry>.filterMatching(query: String): List<HistoryEntry> {
+   val queryWords = query.splitIntoWords()
+   return filter { entry ->
+      val entryWords = (
+         listOfNotNull(
+            entry.notificationTitle,
+            entry.notificationSubtitle,
+            entry.muteReason,
+            entry.hideReason
+         ) + entry.affectedRules
+         ).flatMap { it.splitIntoWords() }
+
+      queryWords.all { queryWord -> entryWords.any { it.startsWith(queryWord, ignoreCase = true) } }
+   }
+}
+
+private fun String.splitIntoWords(): List<String> {
+   return split(NON_WORD_CHARACTERS).filter { it.isNotEmpty() }
+}
+
+private val NON_WORD_CHARACTERS = Regex("[^\\p{L}\\p{N}]+")
@@ -17,9 +17,10 @@ sqldelight {
 dependencies {
    api(projects.history.api)
    api(libs.kotlin.coroutines)
+   api(libs.dispatch)
    api(libs.kotlinova.core)
 
-   implementation(libs.dispatch)
+   implementation(libs.logcat)
 
    testImplementation(libs.kotlinova.core.test)
    testImplementation(libs.turbine)
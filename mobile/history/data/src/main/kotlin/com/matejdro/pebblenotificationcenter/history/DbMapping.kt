@@ -20,4 +20,5 @@ internal fun DbHistory.toHistoryEntry() = HistoryEntry(
    affectedRules = affectedRules?.split("\n")?.filter { it.isNotBlank() }.orEmpty(),
    muteReason = muteReason,
    hideReason = hideReason,
+   id = id,
 )
@@ -5,25 +5,133 @@ import com.matejdro.pebblenotificationcenter.history.sqldelight.generated.DbHist
 import dev.zacsweers.metro.AppScope
 import dev.zacsweers.metro.ContributesBinding
 import dev.zacsweers.metro.Inject
+import dev.zacsweers.metro.SingleIn
+import dispatch.core.DefaultCoroutineScope
 import dispatch.core.flowOnDefault
 import dispatch.core.withDefault
+import kotlinx.coroutines.CancellationException
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.delay
 import kotlinx.coroutines.flow.Flow
 import kotlinx.coroutines.flow.map
+import kotlinx.coroutines.launch
+import logcat.logcat
 import si.inova.kotlinova.core.outcome.Outcome
+import si.inova.kotlinova.core.time.TimeProvider
+import kotlin.time.Duration.Companion.milliseconds
+import kotlin.time.toJavaDuration
 
 @Inject
+@SingleIn(AppScope::class)
 @ContributesBinding(AppScope::class)
 class HistoryRepositoryImpl(
    private val db: DbHistoryQueries,
+   private val retention: HistoryRetention,
+   private val timeProvider: TimeProvider,
+   scope: DefaultCoroutineScope,
 ) : HistoryRepository {
-   override fun getHistory(): Flow<Outcome<List<HistoryEntry>>> {
-      return db.selectAll().asFlow().map { query ->
+   private val pendingEntries = Channel<HistoryEntry>(Channel.UNLIMITED)
+
+   init {
+      scope.launch {
+         writePendingEntries()
+      }
+   }
+
+   override fun getHistory(limit: Int): Flow<Outcome<List<HistoryEntry>>> {
+      return db.selectLatest(limit.toLong()).asFlow().map { query ->
          Outcome.Success(query.executeAsList().map { item -> item.toHistoryEntry() })
       }.flowOnDefault()
    }
 
-   override suspend fun addHistoryEntry(entry: HistoryEntry) = withDefault<Unit> {
-      db.insert(entry.toDb())
-      db.deleteOldItems()
+   override fun search(query: String, limit: Int): Flow<Outcome<List<HistoryEntry>>> {
+      val matchQuery = query.toMatchQuery() ?: return getHistory(limit)
+
+      return db.search(matchQuery, limit.toLong()).asFlow().map { dbQuery ->
+         Outcome.Success(dbQuery.executeAsList().map { item -> item.toHistoryEntry() })
+      }.flowOnDefault()
+   }
+
+   override fun getHistoryNewerThan(oldestEntry: HistoryEntry, query: String): Flow<Outcome<List<HistoryEntry>>> {
+      val time = oldestEntry.time.toEpochMilli()
+      val matchQuery = query.toMatchQuery()
+      val dbQuery = if (matchQuery == null) {
+         db.selectNewerOrEqual(time, oldestEntry.id)
+      } else {
+         db.searchNewerOrEqual(matchQuery, time, oldestEntry.id)
+      }
+
+      return dbQuery.asFlow().map { result ->
+         Outcome.Success(result.executeAsList().map { item -> item.toHistoryEntry() })
+      }.flowOnDefault()
+   }
+
+   override suspend fun loadHistoryOlderThan(newestEntry: HistoryEntry, query: String, limit: Int): List<HistoryEntry> {
+      val time = newestEntry.time.toEpochMilli()
+      val matchQuery = query.toMatchQuery()
+
+      return withDefault {
+         val dbQuery = if (matchQuery == null) {
+            db.selectOlder(time, newestEntry.id, limit.toLong())
+         } else {
+            db.searchOlder(matchQuery, time, newestEntry.id, limit.toLong())
+         }
+
+         dbQuery.executeAsList().map { item -> item.toHistoryEntry() }
+      }
+   }
+
+   override suspend fun addHistoryEntry(entry: HistoryEntry) {
+      pendingEntries.send(entry)
+   }
+
+   private suspend fun writePendingEntries() {
+      while (true) {
+         val batch = mutableListOf(pendingEntries.receive())
+         delay(WRITE_BATCH_DELAY)
+
+         while (true) {
+            batch += pendingEntries.tryReceive().getOrNull() ?: break
+         }
+
+         try {
+            writeBatch(batch)
+         } catch (e: CancellationException) {
+            throw e
+         } catch (e: Exception) {
+            logcat { "Failed to write ${batch.size} history entries: ${e.message}" }
+         }
+      }
+   }
+
+   private suspend fun writeBatch(entries: List<HistoryEntry>) = withDefault {
+      val oldestAllowedTime = timeProvider.currentInstant() - retention.maxAge.toJavaDuration()
+
+      db.transaction {
+         for (entry in entries) {
+            db.insert(entry.toDb())
+         }
+
+         db.deleteOlderThan(oldestAllowedTime.toEpochMilli())
+         db.deleteAllButLatest(retention.maxEntries.toLong())
+      }
    }
 }
+
+/**
+ * Convert user's query into the FTS query that matches entries containing all words of the query as prefixes.
+ * All special characters are stripped, so user cannot produce an invalid query.
+ *
+ * @return FTS query or *null* if the query contains no searchable words
+ */
+internal fun String.toMatchQuery(): String? {
+   val words = split(NON_WORD_CHARACTERS).filter { it.isNotEmpty() }
+   if (words.isEmpty()) {
+      return null
+   }
+
+   return words.joinToString(" ") { "\"$it*\"" }
+}
+
+private val WRITE_BATCH_DELAY = 300.milliseconds
+private val NON_WORD_CHARACTERS = Regex("[^\\p{L}\\p{N}]+")
@@ -0,0 +1,12 @@
+package com.matejdro.pebblenotificationcenter.history
+
+import kotlin.time.Duration
+import kotlin.time.Duration.Companion.days
+
+/**
+ * Limits of the stored notification history. Entries over the [maxEntries] or older than the [maxAge] are deleted.
+ */
+data class HistoryRetention(
+   val maxEntries: Int = 2000,
+   val maxAge: Duration = 7.days,
+)
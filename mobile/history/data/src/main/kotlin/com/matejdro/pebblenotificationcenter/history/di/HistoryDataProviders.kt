@@ -1,6 +1,7 @@
 package com.matejdro.pebblenotificationcenter.history.di
 
 import app.cash.sqldelight.db.SqlDriver
+import com.matejdro.pebblenotificationcenter.history.HistoryRetention
 import com.matejdro.pebblenotificationcenter.history.sqldelight.generated.Database
 import com.matejdro.pebblenotificationcenter.history.sqldelight.generated.DbHistoryQueries
 import dev.zacsweers.metro.AppScope
@@ -20,4 +21,9 @@ interface HistoryDataProviders {
    fun provideHistoryQueries(database: Database): DbHistoryQueries {
       return database.dbHistoryQueries
    }
+
+   @Provides
+   fun provideHistoryRetention(): HistoryRetention {
+      return HistoryRetention()
+   }
 }
@@ -5,18 +5,31 @@ import app.cash.sqldelight.driver.jdbc.sqlite.JdbcSqliteDriver
 import app.cash.turbine.test
 import com.matejdro.pebblenotificationcenter.history.sqldelight.generated.Database
 import com.matejdro.pebblenotificationcenter.history.sqldelight.generated.DbHistoryQueries
+import dispatch.core.DefaultCoroutineScope
+import io.kotest.matchers.shouldBe
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.first
 import kotlinx.coroutines.test.runCurrent
 import kotlinx.coroutines.test.runTest
 import org.junit.jupiter.api.Test
 import si.inova.kotlinova.core.outcome.mapData
 import si.inova.kotlinova.core.test.TestScopeWithDispatcherProvider
 import si.inova.kotlinova.core.test.outcomes.shouldBeSuccessWithData
+import si.inova.kotlinova.core.test.time.virtualTimeProvider
 import java.time.Instant
+import kotlin.time.Duration.Companion.days
+import kotlin.time.Duration.Companion.milliseconds
+import kotlin.time.Duration.Companion.seconds
 
 class HistoryRepositoryImplTest {
    private val scope = TestScopeWithDispatcherProvider()
 
-   private val repo = HistoryRepositoryImpl(createTestRuleQueries())
+   private val repo = HistoryRepositoryImpl(
+      createTestRuleQueries(),
+      HistoryRetention(maxEntries = 100, maxAge = 7.days),
+      scope.virtualTimeProvider(),
+      DefaultCoroutineScope(scope.backgroundScope.coroutineContext)
+   )
 
    @Test
    fun `Insert entries into the repository`() = scope.runTest {
@@ -40,7 +53,9 @@ class HistoryRepositoryImplTest {
          ),
       )
 
-      repo.getHistory().test {
+      delay(1.seconds)
+
+      repo.getHistory(limit = 100).test {
          runCurrent()
 
          expectMostRecentItem() shouldBeSuccessWithData listOf(
@@ -49,6 +64,7 @@ class HistoryRepositoryImplTest {
                "Subtitle B",
                Instant.ofEpochMilli(2000),
                emptyList(),
+               id = 2,
             ),
             HistoryEntry(
                "Title A",
@@ -56,7 +72,8 @@ class HistoryRepositoryImplTest {
                Instant.ofEpochMilli(1000),
                listOf("R1", "R2"),
                "mute A",
-               "hide A"
+               "hide A",
+               id = 1,
             )
          )
       }
@@ -79,12 +96,230 @@ class HistoryRepositoryImplTest {
          (199 - it).toLong()
       }
 
-      repo.getHistory().test {
+      delay(1.seconds)
+
+      repo.getHistory(limit = 200).test {
          runCurrent()
 
          expectMostRecentItem().mapData { list -> list.map { it.time.toEpochMilli() } } shouldBeSuccessWithData expectedTimes
       }
    }
+
+   @Test
+   fun `Write entries in a batch after a delay`() = scope.runTest {
+      repo.getHistory(limit = 100).test {
+         runCurrent()
+         expectMostRecentItem() shouldBeSuccessWithData emptyList()
+
+         repo.addHistoryEntry(entryAt(1))
+         delay(100.milliseconds)
+         repo.addHistoryEntry(entryAt(2))
+         runCurrent()
+         expectNoEvents()
+
+         delay(1.seconds)
+         awaitItem().mapData { list -> list.map { it.time.toEpochMilli() } } shouldBeSuccessWithData listOf(2L, 1L)
+         expectNoEvents()
+      }
+   }
+
+   @Test
+   fun `Delete entries older than the retention age`() = scope.runTest {
+      delay(10.days)
+
+      repo.addHistoryEntry(entryAt(1.days.inWholeMilliseconds))
+      repo.addHistoryEntry(entryAt(5.days.inWholeMilliseconds))
+      delay(1.seconds)
+
+      repo.getHistory(limit = 100).test {
+         runCurrent()
+
+         expectMostRecentItem().mapData { list -> list.map { it.time.toEpochMilli() } } shouldBeSuccessWithData listOf(
+            5.days.inWholeMilliseconds
+         )
+      }
+   }
+
+   @Test
+   fun `Only return the requested number of latest entries`() = scope.runTest {
+      repeat(10) { index ->
+         repo.addHistoryEntry(entryAt(index.toLong()))
+      }
+      delay(1.seconds)
+
+      repo.getHistory(limit = 3).test {
+         runCurrent()
+
+         expectMostRecentItem().mapData { list -> list.map { it.time.toEpochMilli() } } shouldBeSuccessWithData listOf(
+            9L,
+            8L,
+            7L,
+         )
+      }
+   }
+
+   @Test
+   fun `Search entries by all words of the query`() = scope.runTest {
+      repo.addHistoryEntry(entryAt(1, title = "Message from Alice"))
+      repo.addHistoryEntry(entryAt(2, title = "Message from Bob"))
+      repo.addHistoryEntry(entryAt(3, title = "Call from Alice", muteReason = "Screen on"))
+      delay(1.seconds)
+
+      repo.search("alice", limit = 100).test {
+         runCurrent()
+
+         expectMostRecentItem().mapData { list -> list.map { it.notificationTitle } } shouldBeSuccessWithData listOf(
+            "Call from Alice",
+            "Message from Alice",
+         )
+      }
+
+      repo.search("ali scre", limit = 100).test {
+         runCurrent()
+
+         expectMostRecentItem().mapData { list -> list.map { it.notificationTitle } } shouldBeSuccessWithData listOf(
+            "Call from Alice",
+         )
+      }
+   }
+
+   @Test
+   fun `Search non-ASCII words regardless of case and diacritics`() = scope.runTest {
+      repo.addHistoryEntry(entryAt(1, title = "Čestitke od Žige"))
+      repo.addHistoryEntry(entryAt(2, title = "Message from Bob"))
+      delay(1.seconds)
+
+      repo.search("ČEST zig", limit = 100).test {
+         runCurrent()
+
+         expectMostRecentItem().mapData { list -> list.map { it.notificationTitle } } shouldBeSuccessWithData listOf(
+            "Čestitke od Žige",
+         )
+      }
+   }
+
+   @Test
+   fun `Do not return deleted entries in the search`() = scope.runTest {
+      val trimmingRepo = HistoryRepositoryImpl(
+         createTestRuleQueries(),
+         HistoryRetention(maxEntries = 1, maxAge = 7.days),
+         scope.virtualTimeProvider(),
+         DefaultCoroutineScope(scope.backgroundScope.coroutineContext)
+      )
+
+      trimmingRepo.addHistoryEntry(entryAt(1, title = "Message from Alice"))
+      trimmingRepo.addHistoryEntry(entryAt(2, title = "Message from Bob"))
+      delay(1.seconds)
+
+      trimmingRepo.search("message", limit = 100).test {
+         runCurrent()
+
+         expectMostRecentItem().mapData { list -> list.map { it.notificationTitle } } shouldBeSuccessWithData listOf(
+            "Message from Bob",
+         )
+      }
+   }
+
+   @Test
+   fun `Load older entries page by page`() = scope.runTest {
+      repo.addHistoryEntry(entryAt(1, title = "A"))
+      repo.addHistoryEntry(entryAt(2, title = "B"))
+      repo.addHistoryEntry(entryAt(2, title = "C"))
+      repo.addHistoryEntry(entryAt(2, title = "D"))
+      repo.addHistoryEntry(entryAt(3, title = "E"))
+      delay(1.seconds)
+
+      val firstPage = repo.getHistory(limit = 2).first().data!!
+      val secondPage = repo.loadHistoryOlderThan(firstPage.last(), query = "", limit = 2)
+      val thirdPage = repo.loadHistoryOlderThan(secondPage.last(), query = "", limit = 2)
+
+      firstPage.map { it.notificationTitle } shouldBe listOf("E", "D")
+      secondPage.map { it.notificationTitle } shouldBe listOf("C", "B")
+      thirdPage.map { it.notificationTitle } shouldBe listOf("A")
+   }
+
+   @Test
+   fun `Load older search results page by page`() = scope.runTest {
+      repo.addHistoryEntry(entryAt(1, title = "Message from Alice"))
+      repo.addHistoryEntry(entryAt(2, title = "Message from Bob"))
+      repo.addHistoryEntry(entryAt(3, title = "Call from Alice"))
+      repo.addHistoryEntry(entryAt(4, title = "Text from Alice"))
+      delay(1.seconds)
+
+      val firstPage = repo.search("alice", limit = 1).first().data!!
+      val secondPage = repo.loadHistoryOlderThan(firstPage.last(), query = "alice", limit = 2)
+
+      secondPage.map { it.notificationTitle } shouldBe listOf("Call from Alice", "Message from Alice")
+   }
+
+   @Test
+   fun `Keep entries newer than the loaded page up to date`() = scope.runTest {
+      repo.addHistoryEntry(entryAt(1, title = "A"))
+      repo.addHistoryEntry(entryAt(2, title = "B"))
+      repo.addHistoryEntry(entryAt(2, title = "C"))
+      delay(1.seconds)
+
+      val pageEnd = repo.getHistory(limit = 2).first().data!!.last()
+
+      repo.getHistoryNewerThan(pageEnd, query = "").test {
+         runCurrent()
+         expectMostRecentItem().mapData { list -> list.map { it.notificationTitle } } shouldBeSuccessWithData listOf("C", "B")
+
+         repo.addHistoryEntry(entryAt(3, title = "D"))
+         delay(1.seconds)
+         expectMostRecentItem().mapData { list -> list.map { it.notificationTitle } } shouldBeSuccessWithData listOf(
+            "D",
+            "C",
+            "B",
+         )
+      }
+   }
+
+   @Test
+   fun `Keep writing entries after a batch fails to write`() = scope.runTest {
+      val driver = JdbcSqliteDriver(JdbcSqliteDriver.IN_MEMORY)
+      Database.Schema.create(driver)
+      driver.execute(
+         null,
+         "CREATE TRIGGER failingInsert BEFORE INSERT ON dbHistory WHEN new.title = 'Broken' " +
+            "BEGIN SELECT RAISE(ABORT, 'Broken entry'); END;",
+         0
+      )
+
+      val failingRepo = HistoryRepositoryImpl(
+         createTestRuleQueries(driver),
+         HistoryRetention(maxEntries = 100, maxAge = 7.days),
+         scope.virtualTimeProvider(),
+         DefaultCoroutineScope(scope.backgroundScope.coroutineContext)
+      )
+
+      failingRepo.addHistoryEntry(entryAt(1, title = "Broken"))
+      delay(1.seconds)
+      failingRepo.addHistoryEntry(entryAt(2, title = "Working"))
+      delay(1.seconds)
+
+      failingRepo.getHistory(limit = 100).test {
+         runCurrent()
+
+         expectMostRecentItem().mapData { list -> list.map { it.notificationTitle } } shouldBeSuccessWithData listOf(
+            "Working",
+         )
+      }
+   }
+
+   @Test
+   fun `Strip special characters from the search query`() {
+      "\"Alice\" OR -bob*".toMatchQuery() shouldBe "\"Alice*\" \"OR*\" \"bob*\""
+      " ()* ".toMatchQuery() shouldBe null
+   }
+
+   private fun entryAt(timeMillis: Long, title: String = "Title", muteReason: String? = null) = HistoryEntry(
+      title,
+      "Subtitle",
+      Instant.ofEpochMilli(timeMillis),
+      emptyList(),
+      muteReason = muteReason,
+   )
 }
 
 internal fun createTestRuleQueries(
@@ -2,14 +2,25 @@ package com.matejdro.pebblenotificationcenter.history.ui
 
 import androidx.compose.foundation.layout.Column
 import androidx.compose.foundation.layout.WindowInsets
+import androidx.compose.foundation.layout.WindowInsetsSides
 import androidx.compose.foundation.layout.asPaddingValues
+import androidx.compose.foundation.layout.fillMaxSize
+import androidx.compose.foundation.layout.fillMaxWidth
+import androidx.compose.foundation.layout.only
 import androidx.compose.foundation.layout.padding
 import androidx.compose.foundation.layout.safeDrawing
 import androidx.compose.foundation.layout.safeDrawingPadding
+import androidx.compose.foundation.layout.windowInsetsPadding
 import androidx.compose.foundation.lazy.LazyColumn
+import androidx.compose.foundation.lazy.LazyListState
+import androidx.compose.foundation.lazy.rememberLazyListState
 import androidx.compose.material3.Text
+import androidx.compose.material3.TextField
 import androidx.compose.runtime.Composable
 import androidx.compose.runtime.CompositionLocalProvider
+import androidx.compose.runtime.LaunchedEffect
+import androidx.compose.runtime.collectAsState
+import androidx.compose.runtime.snapshotFlow
 import androidx.compose.ui.Modifier
 import androidx.compose.ui.res.stringResource
 import androidx.compose.ui.text.font.FontWeight
@@ -40,20 +51,42 @@ class HistoryScreen(
    @Composable
    override fun Content(key: HistoryScreenKey) {
       val state = viewModel.uiState.collectAsStateWithLifecycleAndBlinkingPrevention()
+      val searchQuery = viewModel.searchQuery.collectAsState()
 
-      ProgressErrorSuccessScaffold(
-         state::value,
-         errorProgressModifier = Modifier.safeDrawingPadding(),
-      ) {
-         HistoryScreenContent(it, timeProvider)
+      Column(Modifier.fillMaxSize()) {
+         HistorySearchBox(searchQuery.value, viewModel::search)
+
+         ProgressErrorSuccessScaffold(
+            state::value,
+            errorProgressModifier = Modifier.safeDrawingPadding(),
+         ) {
+            HistoryScreenContent(it, timeProvider, viewModel::loadMore)
+         }
       }
    }
 }
 
 @Composable
-private fun HistoryScreenContent(history: List<HistoryEntry>, timeProvider: TimeProvider) {
+private fun HistorySearchBox(query: String, search: (String) -> Unit) {
+   TextField(
+      value = query,
+      onValueChange = search,
+      Modifier
+         .windowInsetsPadding(WindowInsets.safeDrawing.only(WindowInsetsSides.Top + WindowInsetsSides.Horizontal))
+         .fillMaxWidth(),
+      singleLine = true,
+      label = { Text(stringResource(R.string.search)) }
+   )
+}
+
+@Composable
+private fun HistoryScreenContent(history: List<HistoryEntry>, timeProvider: TimeProvider, loadMore: () -> Unit) {
+   val listState = rememberLazyListState()
+   LoadMoreAtTheEnd(listState, loadMore)
+
    LazyColumn(
-      contentPadding = WindowInsets.safeDrawing.asPaddingValues(),
+      state = listState,
+      contentPadding = WindowInsets.safeDrawing.only(WindowInsetsSides.Bottom + WindowInsetsSides.Horizontal).asPaddingValues(),
    ) {
       itemsWithDivider(history) { historyEntry ->
          HistoryItem(historyEntry, timeProvider)
@@ -61,6 +94,22 @@ private fun HistoryScreenContent(history: List<HistoryEntry>, timeProvider: Time
    }
 }
 
+@Composable
+private fun LoadMoreAtTheEnd(listState: LazyListState, loadMore: () -> Unit) {
+   LaunchedEffect(listState) {
+      // Emit the item count, so that the list is re-checked after every loaded page
+      snapshotFlow {
+         val layoutInfo = listState.layoutInfo
+         val lastVisibleItem = layoutInfo.visibleItemsInfo.lastOrNull()?.index ?: return@snapshotFlow null
+         layoutInfo.totalItemsCount.takeIf { lastVisibleItem >= it - LOAD_MORE_THRESHOLD }
+      }.collect { itemCountAtTheEnd ->
+         if (itemCountAtTheEnd != null) {
+            loadMore()
+         }
+      }
+   }
+}
+
 @Composable
 private fun HistoryItem(
    historyEntry: HistoryEntry,
@@ -123,8 +172,11 @@ internal fun HistoryScreenPreview() {
             ),
             FakeAndroidTimeProvider(
                currentTimezone = { ZoneId.of("Europe/Berlin") }
-            )
+            ),
+            loadMore = {},
          )
       }
    }
 }
+
+private const val LOAD_MORE_THRESHOLD = 5
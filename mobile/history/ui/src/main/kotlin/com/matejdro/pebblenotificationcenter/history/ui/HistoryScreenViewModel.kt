@@ -8,10 +8,18 @@ import com.matejdro.pebblenotificationcenter.navigation.keys.HistoryScreenKey
 import dev.zacsweers.metro.Inject
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
+import kotlinx.coroutines.flow.combine
+import kotlinx.coroutines.flow.debounce
+import kotlinx.coroutines.flow.flatMapLatest
+import kotlinx.coroutines.flow.map
+import kotlinx.coroutines.flow.update
 import si.inova.kotlinova.core.outcome.CoroutineResourceManager
 import si.inova.kotlinova.core.outcome.Outcome
+import si.inova.kotlinova.core.outcome.mapData
 import si.inova.kotlinova.navigation.services.ContributesScopedService
 import si.inova.kotlinova.navigation.services.SingleScreenViewModel
+import kotlin.time.Duration
+import kotlin.time.Duration.Companion.milliseconds
 
 @Stable
 @Inject
@@ -24,10 +32,86 @@ class HistoryScreenViewModel(
    private val _uiState = MutableStateFlow<Outcome<List<HistoryEntry>>>(Outcome.Progress())
    val uiState: StateFlow<Outcome<List<HistoryEntry>>> = _uiState
 
+   private val _searchQuery = MutableStateFlow("")
+   val searchQuery: StateFlow<String> = _searchQuery
+
+   private val olderPages = MutableStateFlow<OlderPages?>(null)
+   private var displayedQuery = ""
+   private var loadingMore = false
+
    override fun onServiceRegistered() {
       actionLogger.logAction { "HistoryScreenViewModel.onServiceRegistered()" }
       resources.launchResourceControlTask(_uiState) {
-         emitAll(repository.getHistory())
+         val debouncedQuery = _searchQuery.debounce { if (it.isBlank()) Duration.ZERO else SEARCH_DEBOUNCE }
+
+         emitAll(
+            combine(debouncedQuery, olderPages, ::Pair).flatMapLatest { (query, pages) ->
+               displayedQuery = query
+
+               if (pages == null || pages.query != query) {
+                  if (query.isBlank()) {
+                     repository.getHistory(PAGE_SIZE)
+                  } else {
+                     repository.search(query, PAGE_SIZE)
+                  }
+               } else {
+                  // Keep the first page live, so new entries appear on top, and append the older pages that were loaded once
+                  repository.getHistoryNewerThan(pages.firstPageEnd, query).map { outcome ->
+                     outcome.mapData { it + pages.entries }
+                  }
+               }
+            }
+         )
+      }
+   }
+
+   fun search(query: String) {
+      actionLogger.logAction { "HistoryScreenViewModel.search(query = $query)" }
+      _searchQuery.value = query
+      olderPages.value = null
+   }
+
+   /**
+    * Load the next page of the history, if the last loaded page was full
+    */
+   fun loadMore() {
+      val loadedEntries = _uiState.value.data ?: return
+      val lastEntry = loadedEntries.lastOrNull() ?: return
+      val query = displayedQuery
+      val pages = olderPages.value?.takeIf { it.query == query }
+
+      val lastPageFull = if (pages == null) loadedEntries.size >= PAGE_SIZE else !pages.endReached
+      if (!lastPageFull || loadingMore) {
+         return
+      }
+
+      actionLogger.logAction { "HistoryScreenViewModel.loadMore()" }
+      loadingMore = true
+      resources.launchWithExceptionReporting {
+         try {
+            val nextPage = repository.loadHistoryOlderThan(lastEntry, query, PAGE_SIZE)
+            olderPages.update { current ->
+               val currentPages = current?.takeIf { it.query == query }
+               OlderPages(
+                  query = query,
+                  firstPageEnd = currentPages?.firstPageEnd ?: lastEntry,
+                  entries = currentPages?.entries.orEmpty() + nextPage,
+                  endReached = nextPage.size < PAGE_SIZE
+               )
+            }
+         } finally {
+            loadingMore = false
+         }
       }
    }
+
+   private data class OlderPages(
+      val query: String,
+      val firstPageEnd: HistoryEntry,
+      val entries: List<HistoryEntry>,
+      val endReached: Boolean,
+   )
 }
+
+private const val PAGE_SIZE = 30
+private val SEARCH_DEBOUNCE = 300.milliseconds
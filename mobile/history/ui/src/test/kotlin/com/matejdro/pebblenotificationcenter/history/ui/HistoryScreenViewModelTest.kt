@@ -3,13 +3,16 @@ package com.matejdro.pebblenotificationcenter.history.ui
 import app.cash.turbine.test
 import com.matejdro.pebblenotificationcenter.history.FakeHistoryRepository
 import com.matejdro.pebblenotificationcenter.history.HistoryEntry
+import kotlinx.coroutines.delay
 import kotlinx.coroutines.test.TestScope
 import kotlinx.coroutines.test.runCurrent
 import kotlinx.coroutines.test.runTest
 import org.junit.jupiter.api.Test
+import si.inova.kotlinova.core.outcome.mapData
 import si.inova.kotlinova.core.test.outcomes.shouldBeSuccessWithData
 import si.inova.kotlinova.core.test.outcomes.testCoroutineResourceManager
 import java.time.Instant
+import kotlin.time.Duration.Companion.seconds
 
 class HistoryScreenViewModelTest {
    private val scope = TestScope()
@@ -62,4 +65,115 @@ class HistoryScreenViewModelTest {
          )
       }
    }
+
+   @Test
+   fun `Load next page when requested`() = scope.runTest {
+      repeat(50) { index ->
+         repository.addHistoryEntry(HistoryEntry("Title $index", "", Instant.ofEpochMilli(index.toLong()), emptyList()))
+      }
+
+      viewModel.onServiceRegistered()
+
+      viewModel.uiState.test {
+         runCurrent()
+         expectMostRecentItem().mapData { it.size } shouldBeSuccessWithData 30
+
+         viewModel.loadMore()
+         runCurrent()
+         expectMostRecentItem().mapData { it.size } shouldBeSuccessWithData 50
+      }
+   }
+
+   @Test
+   fun `Load pages until the last page is not full`() = scope.runTest {
+      repeat(70) { index ->
+         repository.addHistoryEntry(HistoryEntry("Title $index", "", Instant.ofEpochMilli(index.toLong()), emptyList()))
+      }
+
+      viewModel.onServiceRegistered()
+
+      viewModel.uiState.test {
+         runCurrent()
+         expectMostRecentItem().mapData { it.size } shouldBeSuccessWithData 30
+
+         viewModel.loadMore()
+         runCurrent()
+         expectMostRecentItem().mapData { it.size } shouldBeSuccessWithData 60
+
+         viewModel.loadMore()
+         runCurrent()
+         expectMostRecentItem().mapData { list -> list.map { it.notificationTitle } } shouldBeSuccessWithData List(70) {
+            "Title $it"
+         }
+
+         viewModel.loadMore()
+         runCurrent()
+         expectNoEvents()
+      }
+   }
+
+   @Test
+   fun `Load next page of the search results`() = scope.runTest {
+      repeat(50) { index ->
+         repository.addHistoryEntry(HistoryEntry("Message $index", "", Instant.ofEpochMilli(index.toLong()), emptyList()))
+         repository.addHistoryEntry(HistoryEntry("Call $index", "", Instant.ofEpochMilli(index.toLong()), emptyList()))
+      }
+
+      viewModel.onServiceRegistered()
+      viewModel.search("Call")
+      delay(1.seconds)
+
+      viewModel.uiState.test {
+         runCurrent()
+         expectMostRecentItem().mapData { it.size } shouldBeSuccessWithData 30
+
+         viewModel.loadMore()
+         runCurrent()
+         expectMostRecentItem().mapData { list -> list.map { it.notificationTitle } } shouldBeSuccessWithData List(50) {
+            "Call $it"
+         }
+      }
+   }
+
+   @Test
+   fun `Show search results after the user stops typing`() = scope.runTest {
+      repository.addHistoryEntry(HistoryEntry("Message from Alice", "", Instant.ofEpochMilli(1), emptyList()))
+      repository.addHistoryEntry(HistoryEntry("Message from Bob", "", Instant.ofEpochMilli(2), emptyList()))
+
+      viewModel.onServiceRegistered()
+
+      viewModel.uiState.test {
+         runCurrent()
+         expectMostRecentItem().mapData { it.size } shouldBeSuccessWithData 2
+
+         viewModel.search("Al")
+         runCurrent()
+         viewModel.search("Alice")
+         runCurrent()
+         expectNoEvents()
+
+         delay(1.seconds)
+         expectMostRecentItem().mapData { list -> list.map { it.notificationTitle } } shouldBeSuccessWithData listOf(
+            "Message from Alice"
+         )
+      }
+   }
+
+   @Test
+   fun `Do not request more entries when the last page was not full`() = scope.runTest {
+      repeat(10) { index ->
+         repository.addHistoryEntry(HistoryEntry("Title $index", "", Instant.ofEpochMilli(index.toLong()), emptyList()))
+      }
+
+      viewModel.onServiceRegistered()
+
+      viewModel.uiState.test {
+         runCurrent()
+         expectMostRecentItem().mapData { it.size } shouldBeSuccessWithData 10
+
+         viewModel.loadMore()
+         runCurrent()
+         expectNoEvents()
+      }
+   }
 }
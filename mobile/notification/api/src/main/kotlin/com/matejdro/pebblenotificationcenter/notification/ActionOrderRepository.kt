@@ -15,8 +15,17 @@ interface ActionOrderRepository {
     */
    suspend fun moveOrder(value: String, toIndex: Int)
 
+   /**
+    * Number that changes every time the order of the actions changes. Anything that caches sorted actions
+    * can compare it to detect stale data.
+    */
+   val orderVersion: Int
+
    /**
     * Sort the provided list with the order of the actions in this repository
+    *
+    * @param rememberNewActions when *true*, actions that are not known yet are added to the list of all known actions.
+    * Otherwise, they are sorted where they would be added, without changing the order or the [orderVersion].
     */
-   suspend fun sort(list: List<Action>): List<Action>
+   suspend fun sort(list: List<Action>, rememberNewActions: Boolean = true): List<Action>
 }
@@ -4,6 +4,7 @@ import com.matejdro.pebblenotificationcenter.notification.model.ProcessedNotific
 
 interface NotificationRepository {
    fun getAllActiveNotifications(): Collection<ProcessedNotification>
+   fun getActiveNotificationsFromPackage(pkg: String): Collection<ProcessedNotification>
    fun getNotification(bucketId: Int): ProcessedNotification?
    fun pollNextVibration(): IntArray?
 
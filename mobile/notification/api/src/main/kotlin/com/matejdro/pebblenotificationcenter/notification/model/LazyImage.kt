@@ -0,0 +1,14 @@
+package com.matejdro.pebblenotificationcenter.notification.model
+
+/**
+ * Image of a notification that is only materialised when its pixels are actually needed.
+ *
+ * This is pure kotlin module, so we cannot reference Icon directly. Android type of the [load] result
+ * is android.graphics.drawable.Icon.
+ */
+fun interface LazyImage {
+   /**
+    * @return loaded image or *null* if the image is no longer available
+    */
+   fun load(): Any?
+}
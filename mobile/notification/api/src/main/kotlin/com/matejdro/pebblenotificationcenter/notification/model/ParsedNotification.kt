@@ -29,12 +29,19 @@ data class ParsedNotification(
     */
    val forceVibrate: Boolean = false,
    val overrideVibrationPattern: List<Short>? = null,
-   // This is pure kotlin module, so we cannot reference Drawable directly.
-   // I don't want to change it, so for now we can just use Any and upcast it
-   val iconDrawable: Any? = null,
-
-   // Android type of this is android.graphics.drawable.Icon
-   val largeImage: Any? = null,
+   /**
+    * Small icon of the notification. It is only loaded into a drawable when the icon is sent to the watch.
+    *
+    * This is pure kotlin module, so we cannot reference Icon directly. Android type of this is
+    * android.graphics.drawable.Icon.
+    */
+   val icon: Any? = null,
+   /**
+    * Identity of the [icon] that stays the same across notifications (such as its resource ID and the version of
+    * the app), or null if the icon has no such identity.
+    */
+   val iconId: String? = null,
+   val largeImage: LazyImage? = null,
    val id: Int = 0,
    val tag: String? = null,
    /**
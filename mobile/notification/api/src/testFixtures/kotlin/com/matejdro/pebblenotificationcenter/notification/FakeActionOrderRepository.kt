@@ -6,10 +6,13 @@ import kotlinx.coroutines.flow.Flow
 class FakeActionOrderRepository : ActionOrderRepository {
    private val orderOverrides = HashMap<String, Int>()
 
+   override var orderVersion: Int = 0
+      private set
+
    /**
     * Sort the provided list with the order of the actions in this repository
     */
-   override suspend fun sort(list: List<Action>): List<Action> {
+   override suspend fun sort(list: List<Action>, rememberNewActions: Boolean): List<Action> {
       return list.sortedWith { first, second ->
          (orderOverrides[first.title] ?: 0).compareTo((orderOverrides[second.title] ?: 0))
       }
@@ -20,6 +23,7 @@ class FakeActionOrderRepository : ActionOrderRepository {
     */
    override suspend fun moveOrder(value: String, toIndex: Int) {
       orderOverrides[value] = toIndex
+      orderVersion++
    }
 
    /**
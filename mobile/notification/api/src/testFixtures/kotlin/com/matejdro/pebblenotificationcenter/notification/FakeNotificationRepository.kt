@@ -17,6 +17,10 @@ class FakeNotificationRepository : NotificationRepository {
       return notifications.values.filterNotNull()
    }
 
+   override fun getActiveNotificationsFromPackage(pkg: String): Collection<ProcessedNotification> {
+      return getAllActiveNotifications().filter { it.systemData.pkg == pkg }
+   }
+
    override fun pollNextVibration(): IntArray? {
       val nextVibrationLocal = nextVibration
       nextVibration = null
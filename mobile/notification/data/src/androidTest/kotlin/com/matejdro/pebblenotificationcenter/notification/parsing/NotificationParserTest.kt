@@ -22,6 +22,7 @@ import androidx.test.core.app.ApplicationProvider
 import com.matejdro.pebblenotificationcenter.notification.NotificationConstants
 import com.matejdro.pebblenotificationcenter.notification.model.ParsedNotification
 import io.kotest.matchers.collections.shouldContainExactly
+import io.kotest.matchers.nulls.shouldBeNull
 import io.kotest.matchers.nulls.shouldNotBeNull
 import io.kotest.matchers.shouldBe
 import io.kotest.matchers.types.shouldBeInstanceOf
@@ -970,6 +971,7 @@ class NotificationParserTest {
          .apply {
             largeImage
                .shouldNotBeNull()
+               .load()
                .shouldBeInstanceOf<Icon>()
                .uri shouldBe Uri.parse("content://image/2")
 
@@ -997,6 +999,7 @@ class NotificationParserTest {
          .apply {
             largeImage
                .shouldNotBeNull()
+               .load()
                .shouldBeInstanceOf<Icon>()
                .type shouldBe Icon.TYPE_BITMAP
 
@@ -1004,6 +1007,27 @@ class NotificationParserTest {
          }
    }
 
+   @Test
+   fun doNotLoadImageFromBigPictureWithoutPicture() {
+      val notification = NotificationCompat.Builder(context, "TEST_CHANNEL")
+         .setContentTitle("Title")
+         .setContentText("Description")
+         .setStyle(
+            NotificationCompat.BigPictureStyle()
+               .bigPicture(null as Bitmap?)
+         )
+         .setSmallIcon(0)
+         .setShowWhen(false)
+         .build()
+
+      notificationParser.parse(notification.toSbn(), createDefaultSilentChannel())
+         .shouldNotBeNull()
+         .largeImage
+         .shouldNotBeNull()
+         .load()
+         .shouldBeNull()
+   }
+
    @Test
    fun doNotAddCameraEmojiIfTitleAlreadyContainsIt() {
       val notification = NotificationCompat.Builder(context, "TEST_CHANNEL")
@@ -1032,6 +1056,7 @@ class NotificationParserTest {
          .apply {
             largeImage
                .shouldNotBeNull()
+               .load()
                .shouldBeInstanceOf<Icon>()
                .uri shouldBe Uri.parse("content://image/2")
 
@@ -11,18 +11,29 @@ import com.matejdro.pebblenotificationcenter.rules.keys.set
 import dev.zacsweers.metro.AppScope
 import dev.zacsweers.metro.ContributesBinding
 import dev.zacsweers.metro.SingleIn
+import dispatch.core.DefaultCoroutineScope
+import kotlinx.coroutines.CancellationException
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.delay
 import kotlinx.coroutines.flow.Flow
+import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.distinctUntilChanged
 import kotlinx.coroutines.flow.filter
+import kotlinx.coroutines.flow.filterNotNull
 import kotlinx.coroutines.flow.first
 import kotlinx.coroutines.flow.map
 import kotlinx.coroutines.flow.onEach
+import kotlinx.coroutines.launch
+import logcat.logcat
+import java.util.concurrent.atomic.AtomicInteger
+import kotlin.time.Duration.Companion.seconds
 
 @ContributesBinding(AppScope::class)
 @SingleIn(AppScope::class)
 class ActionOrderRepositoryImpl(
    context: Context,
    private val preferenceStore: DataStore<Preferences>,
+   private val scope: DefaultCoroutineScope,
 ) : ActionOrderRepository {
    private val otherActionsEntry = context.getString(R.string.other_actions)
 
@@ -40,6 +51,26 @@ class ActionOrderRepositoryImpl(
 
    private var checkedForDefaultItems: Boolean = false
 
+   private val orderVersionCounter = AtomicInteger(0)
+   override val orderVersion: Int
+      get() = orderVersionCounter.get()
+
+   /**
+    * In-memory copy of the stored order, with the not yet persisted titles included. *null* until the stored
+    * order is loaded.
+    */
+   private val ranks = MutableStateFlow<ActionRanks?>(null)
+   private val storedOrderLock = Any()
+   private var storedOrder: List<String> = emptyList()
+   private val pendingTitles = LinkedHashSet<String>()
+   private var persistJob: Job? = null
+
+   init {
+      scope.launch {
+         getList().collect { updateStoredOrder(it) }
+      }
+   }
+
    override fun getList(): Flow<List<String>> {
       return preferenceStore.data.map { it[GlobalPreferenceKeys.actionOrder] }
          .distinctUntilChanged()
@@ -57,7 +88,7 @@ class ActionOrderRepositoryImpl(
    }
 
    private suspend fun insertDefaultItems() {
-      preferenceStore.edit { prefs ->
+      val newPreferences = preferenceStore.edit { prefs ->
          val existing = prefs[GlobalPreferenceKeys.actionOrder]
          val newList = existing.toMutableList().apply {
             for (item in defaultOrder) {
@@ -68,10 +99,11 @@ class ActionOrderRepositoryImpl(
          }
          prefs[GlobalPreferenceKeys.actionOrder] = newList.distinct()
       }
+      updateStoredOrder(newPreferences[GlobalPreferenceKeys.actionOrder])
    }
 
    override suspend fun moveOrder(value: String, toIndex: Int) {
-      preferenceStore.edit { prefs ->
+      val newPreferences = preferenceStore.edit { prefs ->
          val existing = prefs[GlobalPreferenceKeys.actionOrder]
          val newList = existing.toMutableList().apply {
             remove(value)
@@ -79,29 +111,116 @@ class ActionOrderRepositoryImpl(
          }
          prefs[GlobalPreferenceKeys.actionOrder] = newList.toList().distinct()
       }
+      updateStoredOrder(newPreferences[GlobalPreferenceKeys.actionOrder])
    }
 
-   override suspend fun sort(list: List<Action>): List<Action> {
-      val orderList = getList().first()
-      val unknownIndexOrder = orderList.indexOf(otherActionsEntry) + 1
-
-      val unknownElements = list.map { it.title } - orderList
-      val updatedOrderList = if (unknownElements.isNotEmpty()) {
-         preferenceStore.edit { prefs ->
-            val existing = prefs[GlobalPreferenceKeys.actionOrder]
-            val newList = existing.toMutableList().apply {
-               for (element in unknownElements) {
-                  add(unknownIndexOrder, element)
-               }
+   override suspend fun sort(list: List<Action>, rememberNewActions: Boolean): List<Action> {
+      var currentRanks = ranks.filterNotNull().first()
+
+      val unknownTitles = list.map { it.title }.filter { !currentRanks.contains(it) }
+      if (unknownTitles.isNotEmpty()) {
+         currentRanks = if (rememberNewActions) {
+            addPendingTitles(unknownTitles)
+         } else {
+            synchronized(storedOrderLock) { ActionRanks(storedOrder.withTitles(pendingTitles + unknownTitles)) }
+         }
+      }
+
+      return list.sortedBy { currentRanks.rankOf(it.title) }
+   }
+
+   private fun updateStoredOrder(newOrder: List<String>) {
+      synchronized(storedOrderLock) {
+         storedOrder = newOrder
+         pendingTitles.removeAll(newOrder.toSet())
+         updateRanks()
+      }
+   }
+
+   /**
+    * Update ranks from the stored order and the pending titles. [orderVersion] is only bumped when the ranks
+    * actually change (persisting already ranked titles does not change them), so prebuilt packets stay valid.
+    *
+    * Must be called while holding the [storedOrderLock].
+    */
+   private fun updateRanks(): ActionRanks {
+      val newOrder = storedOrder.withPendingTitles()
+      val previousRanks = ranks.value
+      if (previousRanks != null && previousRanks.order == newOrder) {
+         return previousRanks
+      }
+
+      val newRanks = ActionRanks(newOrder)
+      ranks.value = newRanks
+      orderVersionCounter.incrementAndGet()
+      return newRanks
+   }
+
+   /**
+    * Rank new titles immediately and write them to the disk later, in a batch with other new titles
+    */
+   private fun addPendingTitles(titles: List<String>): ActionRanks {
+      return synchronized(storedOrderLock) {
+         pendingTitles.addAll(titles)
+         val newRanks = updateRanks()
+
+         if (persistJob?.isActive != true) {
+            persistJob = scope.launch {
+               delay(PERSIST_BATCH_DELAY)
+               persistPendingTitles()
+            }
+         }
+
+         newRanks
+      }
+   }
+
+   private suspend fun persistPendingTitles() {
+      // Titles can be added while the previous batch is being written. Keep writing until there is nothing left.
+      while (true) {
+         val titles = synchronized(storedOrderLock) { pendingTitles.toList() }
+         if (titles.isEmpty()) {
+            return
+         }
+         logcat { "Persisting new actions $titles" }
+
+         val newPreferences = try {
+            preferenceStore.edit { prefs ->
+               prefs[GlobalPreferenceKeys.actionOrder] = prefs[GlobalPreferenceKeys.actionOrder].withTitles(titles)
             }
-            prefs[GlobalPreferenceKeys.actionOrder] = newList.distinct()
-         }[GlobalPreferenceKeys.actionOrder]
-      } else {
-         orderList
+         } catch (e: CancellationException) {
+            throw e
+         } catch (e: Exception) {
+            // Keep the titles pending, so they are written again with the next batch
+            logcat { "Persisting new actions failed: ${e.message}" }
+            synchronized(storedOrderLock) { pendingTitles.addAll(titles) }
+            return
+         }
+         updateStoredOrder(newPreferences[GlobalPreferenceKeys.actionOrder])
       }
+   }
 
-      return list.sortedWith { first, second ->
-         updatedOrderList.indexOf(first.title).compareTo(updatedOrderList.indexOf(second.title))
+   private fun List<String>.withPendingTitles(): List<String> {
+      return if (pendingTitles.isEmpty()) this else withTitles(pendingTitles)
+   }
+
+   /**
+    * Insert [titles] that are not in the list yet after the 'Other actions' entry
+    */
+   private fun List<String>.withTitles(titles: Collection<String>): List<String> {
+      val newTitles = titles.filter { !contains(it) }
+      return toMutableList().apply {
+         addAll(indexOf(otherActionsEntry) + 1, newTitles)
       }
    }
 }
+
+private class ActionRanks(val order: List<String>) {
+   private val rankByTitle = order.withIndex().associate { it.value to it.index }
+
+   fun contains(title: String): Boolean = rankByTitle.containsKey(title)
+
+   fun rankOf(title: String): Int = rankByTitle[title] ?: -1
+}
+
+private val PERSIST_BATCH_DELAY = 1.seconds
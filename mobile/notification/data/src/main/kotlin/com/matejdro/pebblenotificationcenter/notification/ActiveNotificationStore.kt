@@ -0,0 +1,86 @@
+package com.matejdro.pebblenotificationcenter.notification
+
+import com.matejdro.pebblenotificationcenter.notification.model.ProcessedNotification
+
+/**
+ * Thread-safe store of all active notifications, indexed by their key and by their package.
+ *
+ * Both indices are always updated together, so readers never see a notification in one index, but not in the other.
+ */
+class ActiveNotificationStore {
+   private val lock = Any()
+   private val notificationsByKey = HashMap<String, ProcessedNotification>()
+   private val keysByPackage = HashMap<String, MutableSet<String>>()
+
+   operator fun get(key: String): ProcessedNotification? {
+      return synchronized(lock) { notificationsByKey[key] }
+   }
+
+   operator fun contains(key: String): Boolean {
+      return synchronized(lock) { notificationsByKey.containsKey(key) }
+   }
+
+   fun put(notification: ProcessedNotification) {
+      synchronized(lock) {
+         val key = notification.systemData.key
+         val previous = notificationsByKey.put(key, notification)
+         if (previous != null && previous.systemData.pkg != notification.systemData.pkg) {
+            removeFromPackageIndex(previous)
+         }
+
+         keysByPackage.getOrPut(notification.systemData.pkg) { LinkedHashSet() }.add(key)
+      }
+   }
+
+   fun remove(key: String): ProcessedNotification? {
+      return synchronized(lock) {
+         notificationsByKey.remove(key)?.also { removeFromPackageIndex(it) }
+      }
+   }
+
+   /**
+    * Atomically replace the notification with the [key] with the result of the [transform].
+    *
+    * @return new notification or *null* if there is no notification with that key
+    */
+   fun update(key: String, transform: (ProcessedNotification) -> ProcessedNotification): ProcessedNotification? {
+      return synchronized(lock) {
+         val existing = notificationsByKey[key] ?: return null
+         val updated = transform(existing)
+         require(updated.systemData.key == key) { "Notification key cannot change" }
+
+         put(updated)
+         updated
+      }
+   }
+
+   fun getAll(): List<ProcessedNotification> {
+      return synchronized(lock) { notificationsByKey.values.toList() }
+   }
+
+   fun getAllKeys(): List<String> {
+      return synchronized(lock) { notificationsByKey.keys.toList() }
+   }
+
+   fun getFromPackage(pkg: String): List<ProcessedNotification> {
+      return synchronized(lock) {
+         keysByPackage[pkg].orEmpty().mapNotNull { notificationsByKey[it] }
+      }
+   }
+
+   fun clear() {
+      synchronized(lock) {
+         notificationsByKey.clear()
+         keysByPackage.clear()
+      }
+   }
+
+   private fun removeFromPackageIndex(notification: ProcessedNotification) {
+      val pkg = notification.systemData.pkg
+      val packageKeys = keysByPackage[pkg] ?: return
+      packageKeys.remove(notification.systemData.key)
+      if (packageKeys.isEmpty()) {
+         keysByPackage.remove(pkg)
+      }
+   }
+}
@@ -0,0 +1,81 @@
+package com.matejdro.pebblenotificationcenter.notification
+
+import kotlinx.coroutines.CoroutineDispatcher
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.joinAll
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.sync.Mutex
+import kotlinx.coroutines.sync.withLock
+
+/**
+ * Processes notification events in two stages:
+ *
+ * 1. Preparation (parsing, rule resolving), that runs concurrently for all events on the [prepareDispatcher]
+ * 2. Commit, that runs exclusively with other commits, after all previously submitted events with the same key
+ *    have been committed
+ */
+class NotificationPipeline(
+   private val scope: CoroutineScope,
+   private val prepareDispatcher: CoroutineDispatcher,
+) {
+   private val commitMutex = Mutex()
+   private val lastCommits = HashMap<String, Job>()
+
+   /**
+    * Submit an event for the notification with the [key]. Order of the commits is determined at the time of
+    * this call.
+    */
+   fun <T> submit(
+      key: String,
+      prepare: suspend () -> T,
+      commit: suspend (T) -> Unit,
+   ): Job {
+      return submit(listOf(key), prepare, commit)
+   }
+
+   /**
+    * Submit an event that affects notifications with all the [keys] (such as a bulk reload). It is committed after
+    * all previously submitted events of these keys.
+    */
+   fun <T> submit(
+      keys: Collection<String>,
+      prepare: suspend () -> T,
+      commit: suspend (T) -> Unit,
+   ): Job {
+      val commitJob = Job()
+      val previousCommits = synchronized(lastCommits) {
+         keys.mapNotNull { lastCommits.put(it, commitJob) }.distinct()
+      }
+
+      scope.launch(prepareDispatcher) {
+         try {
+            val prepared = prepare()
+
+            previousCommits.joinAll()
+            commitMutex.withLock {
+               commit(prepared)
+            }
+         } finally {
+            commitJob.complete()
+
+            synchronized(lastCommits) {
+               for (key in keys) {
+                  if (lastCommits[key] === commitJob) {
+                     lastCommits.remove(key)
+                  }
+               }
+            }
+         }
+      }
+
+      return commitJob
+   }
+
+   /**
+    * Run the [block] exclusively with all commits
+    */
+   suspend fun <T> withCommitLock(block: suspend () -> T): T {
+      return commitMutex.withLock { block() }
+   }
+}
@@ -4,6 +4,7 @@ import android.content.Context
 import android.os.Build
 import androidx.datastore.core.DataStore
 import androidx.datastore.preferences.core.Preferences
+import com.matejdro.pebblenotificationcenter.bluetooth.NotificationDetailsPrebuilder
 import com.matejdro.pebblenotificationcenter.bluetooth.WatchSyncer
 import com.matejdro.pebblenotificationcenter.bluetooth.WatchappOpenController
 import com.matejdro.pebblenotificationcenter.common.di.AndroidVersion
@@ -27,7 +28,6 @@ import dev.zacsweers.metro.Inject
 import dev.zacsweers.metro.SingleIn
 import kotlinx.coroutines.flow.first
 import logcat.logcat
-import java.util.concurrent.ConcurrentHashMap
 import java.util.concurrent.atomic.AtomicReference
 
 @Inject
@@ -36,6 +36,7 @@ import java.util.concurrent.atomic.AtomicReference
 class NotificationProcessor(
    private val context: Context,
    private val watchSyncer: WatchSyncer,
+   private val detailsPrebuilder: NotificationDetailsPrebuilder,
    private val openController: WatchappOpenController,
    private val ruleResolver: RuleResolver,
    private val globalPreferenceStore: DataStore<Preferences>,
@@ -45,12 +46,26 @@ class NotificationProcessor(
    @AndroidVersion
    private val androidVersion: Int,
 ) : NotificationRepository {
-   private val notifications = ConcurrentHashMap<Int, ProcessedNotification>()
-   private val notificationIdsByKeys = HashMap<String, Int>()
+   /**
+    * All active notifications. Bucket ids of the notifications are owned by the [watchSyncer], as they
+    * change when notifications move in and out of the window on the watch.
+    */
+   private val notifications = ActiveNotificationStore()
+   private val regexReplacementCache = RegexReplacementCache()
 
    private var nextVibration: AtomicReference<IntArray?> = AtomicReference(null)
 
    suspend fun onNotificationPosted(parsedNotification: ParsedNotification, suppressVibration: Boolean = false) {
+      onNotificationPosted(prepareNotification(parsedNotification), suppressVibration)
+   }
+
+   /**
+    * Resolve rules of the notification and apply them to its text.
+    *
+    * This does not touch any state of the processor, so it can run concurrently for multiple notifications,
+    * before their results are committed with [onNotificationPosted] one by one.
+    */
+   suspend fun prepareNotification(parsedNotification: ParsedNotification): PreparedNotification {
       val (affectedRules, settings) = ruleResolver.resolveRules(parsedNotification)
       logcat { "Notification ${parsedNotification.key} rules: $affectedRules" }
       for (setting in settings.asMap()) {
@@ -58,13 +73,72 @@ class NotificationProcessor(
       }
 
       val hideReason = shouldHide(parsedNotification, settings)
+      val textReplacedNotification = if (hideReason == null) {
+         applyTextRules(parsedNotification, settings)
+      } else {
+         parsedNotification
+      }
+
+      return PreparedNotification(parsedNotification, textReplacedNotification, affectedRules, settings, hideReason)
+   }
+
+   suspend fun onNotificationPosted(preparedNotification: PreparedNotification, suppressVibration: Boolean = false) {
+      val pendingNotification = processPostedNotification(preparedNotification, suppressVibration)
+      if (pendingNotification == null) {
+         watchSyncer.clearNotification(preparedNotification.parsedNotification.key)
+         return
+      }
+
+      val bucketId = watchSyncer.syncNotification(pendingNotification.notification, preparedNotification.settings)
+      commitPostedNotification(pendingNotification, bucketId)
+   }
+
+   /**
+    * Post multiple notifications at once. All of them are written to the watch in a single batch.
+    */
+   suspend fun onNotificationsPosted(
+      preparedNotifications: List<PreparedNotification>,
+      suppressVibration: Boolean = false,
+   ) {
+      val batch = watchSyncer.startBatch()
+
+      val pendingNotifications = preparedNotifications.mapNotNull { preparedNotification ->
+         val pendingNotification = processPostedNotification(preparedNotification, suppressVibration)
+         if (pendingNotification != null) {
+            batch.stageNotification(pendingNotification.notification, preparedNotification.settings)
+         } else {
+            batch.stageDeletion(preparedNotification.parsedNotification.key)
+         }
+
+         pendingNotification
+      }
+
+      val bucketIds = batch.commit()
+
+      for (pendingNotification in pendingNotifications) {
+         commitPostedNotification(pendingNotification, bucketIds.getValue(pendingNotification.notification.systemData.key))
+      }
+   }
+
+   /**
+    * @return notification that should be synced to the watch or *null* if the notification should be hidden
+    */
+   private suspend fun processPostedNotification(
+      preparedNotification: PreparedNotification,
+      suppressVibration: Boolean,
+   ): PendingNotification? {
+      val parsedNotification = preparedNotification.parsedNotification
+      val affectedRules = preparedNotification.affectedRules
+      val settings = preparedNotification.settings
+      val hideReason = preparedNotification.hideReason
+
       if (hideReason != null) {
          insertIntoHistory(settings, parsedNotification, affectedRules, hideReason, null)
-         onNotificationDismissed(parsedNotification.key)
-         return
+         forgetNotification(parsedNotification.key)
+         return null
       }
 
-      val isUpdate = notificationIdsByKeys.containsKey(parsedNotification.key)
+      val isUpdate = parsedNotification.key in notifications
       val pauseStatusBeforeInsert = pauseController.computePauseStatus(parsedNotification)
       if (!isUpdate) {
          pauseController.onNewNotification(parsedNotification, settings)
@@ -73,7 +147,7 @@ class NotificationProcessor(
 
       val actions = processActions(parsedNotification, pauseStatus, settings)
 
-      val previousNotification = notificationIdsByKeys[parsedNotification.key]?.let { notifications[it] }
+      val previousNotification = notifications[parsedNotification.key]
       val (muteReason, vibrationPattern) = getVibrationPattern(
          previousNotification,
          parsedNotification,
@@ -82,35 +156,47 @@ class NotificationProcessor(
          pauseStatusBeforeInsert
       )
 
-      val regexReplacedParsedNotification = applyTextRules(parsedNotification, settings)
+      logcat {
+         "Notification flags: " +
+            "suppress=$suppressVibration " +
+            "silent=${parsedNotification.isSilent} " +
+            "dnd=${parsedNotification.isFilteredByDoNotDisturb}"
+      }
 
-      val initialProcessedNotification = ProcessedNotification(
-         regexReplacedParsedNotification,
+      val notification = ProcessedNotification(
+         preparedNotification.textReplacedNotification,
          0,
          actions,
          unread = !suppressVibration,
          paused = pauseStatus,
          vibrated = vibrationPattern != null
       )
-      val bucketId = watchSyncer.syncNotification(initialProcessedNotification, settings)
 
-      val processedNotification = initialProcessedNotification.copy(bucketId = bucketId)
+      return PendingNotification(notification, preparedNotification, muteReason, vibrationPattern)
+   }
 
-      logcat {
-         "Notification flags: " +
-            "suppress=$suppressVibration " +
-            "silent=${parsedNotification.isSilent} " +
-            "dnd=${parsedNotification.isFilteredByDoNotDisturb}"
+   private suspend fun commitPostedNotification(pendingNotification: PendingNotification, bucketId: Int) {
+      val processedNotification = pendingNotification.notification.copy(bucketId = bucketId)
+      if (bucketId != 0) {
+         detailsPrebuilder.prebuild(processedNotification)
       }
+
+      val vibrationPattern = pendingNotification.vibrationPattern
       if (vibrationPattern != null) {
          logcat { "Vibrating with ${vibrationPattern.contentToString()}" }
          nextVibration.set(vibrationPattern)
          openController.openWatchapp()
       }
 
-      insertIntoHistory(settings, regexReplacedParsedNotification, affectedRules, hideReason, muteReason)
-      notifications[bucketId] = processedNotification
-      notificationIdsByKeys[parsedNotification.key] = bucketId
+      val preparedNotification = pendingNotification.preparedNotification
+      insertIntoHistory(
+         preparedNotification.settings,
+         processedNotification.systemData,
+         preparedNotification.affectedRules,
+         null,
+         pendingNotification.muteReason
+      )
+      notifications.put(processedNotification)
    }
 
    /**
@@ -118,7 +204,7 @@ class NotificationProcessor(
     * blanking the subtitle and stripping the conversation/group title that the parser merged into the body.
     */
    private fun applyTextRules(parsed: ParsedNotification, settings: Preferences): ParsedNotification {
-      val regexesToReplace = settings[RuleOption.regexReplacements]
+      val regexesToReplace = regexReplacementCache.get(settings[RuleOption.regexReplacements])
       val hideSubtitle = settings[RuleOption.hideSubtitle]
       val body = if (hideSubtitle) {
          removeConversationTitle(body = parsed.body, conversationTitle = parsed.conversationTitle)
@@ -126,9 +212,9 @@ class NotificationProcessor(
          parsed.body
       }
       return parsed.copy(
-         title = replaceRegexes(parsed.title, regexesToReplace),
-         subtitle = if (hideSubtitle) "" else replaceRegexes(parsed.subtitle, regexesToReplace),
-         body = replaceRegexes(body, regexesToReplace),
+         title = regexesToReplace.replace(parsed.title),
+         subtitle = if (hideSubtitle) "" else regexesToReplace.replace(parsed.subtitle),
+         body = regexesToReplace.replace(body),
       )
    }
 
@@ -326,12 +412,9 @@ class NotificationProcessor(
    }
 
    override suspend fun notifyPackagePauseStatusChanged(pkg: String) {
-      val activeMatchingNotifications = getAllActiveNotifications().filter { it.systemData.pkg == pkg }
-      for (notificationIterator in activeMatchingNotifications) {
-         val newNotification = notifications.compute(notificationIterator.bucketId) { _, oldNotification ->
-            if (oldNotification == null) {
-               return@compute null
-            }
+      for (notificationIterator in notifications.getFromPackage(pkg)) {
+         val key = notificationIterator.systemData.key
+         val newNotification = notifications.update(key) { oldNotification ->
             val newPaused = pauseController.computePauseStatus(oldNotification.systemData)
 
             if (newPaused != oldNotification.paused) {
@@ -343,46 +426,53 @@ class NotificationProcessor(
                oldNotification
             }
          }
-         if (newNotification != null) {
-            notifications[newNotification.bucketId] = newNotification
-
-            if (newNotification != notificationIterator) {
-               val preferences = ruleResolver.resolveRules(newNotification.systemData).preferences
-               watchSyncer.syncNotification(newNotification, preferences)
+         if (newNotification != null && newNotification.paused != notificationIterator.paused) {
+            val preferences = ruleResolver.resolveRules(newNotification.systemData).preferences
+            val bucketId = watchSyncer.syncNotification(newNotification.withCurrentBucketId(), preferences)
+            if (bucketId != 0) {
+               detailsPrebuilder.prebuild(newNotification.copy(bucketId = bucketId))
             }
          }
       }
    }
 
    override suspend fun onNotificationDismissed(key: String) {
-      val notificationId = notificationIdsByKeys.remove(key)
-      if (notificationId != null) {
-         val processedNotification = notifications.remove(notificationId)
-         if (processedNotification != null) {
-            pauseController.onNotificationDismissed(processedNotification.systemData)
-         }
-      }
-
+      forgetNotification(key)
       watchSyncer.clearNotification(key)
    }
 
+   private suspend fun forgetNotification(key: String) {
+      watchSyncer.getBucketId(key)?.let { detailsPrebuilder.invalidate(it) }
+      val processedNotification = notifications.remove(key)
+      if (processedNotification != null) {
+         pauseController.onNotificationDismissed(processedNotification.systemData)
+      }
+   }
+
    suspend fun onNotificationsCleared() {
+      for (key in notifications.getAllKeys()) {
+         watchSyncer.getBucketId(key)?.let { detailsPrebuilder.invalidate(it) }
+      }
       notifications.clear()
-      notificationIdsByKeys.clear()
 
       watchSyncer.clearAllNotifications()
    }
 
    override fun getNotification(bucketId: Int): ProcessedNotification? {
-      return notifications[bucketId]
+      val key = watchSyncer.getNotificationKey(bucketId) ?: return null
+      return notifications[key]?.copy(bucketId = bucketId)
    }
 
    override fun getAllActiveNotifications(): Collection<ProcessedNotification> {
-      return notifications.values.toList()
+      return notifications.getAll().map { it.withCurrentBucketId() }
+   }
+
+   override fun getActiveNotificationsFromPackage(pkg: String): Collection<ProcessedNotification> {
+      return notifications.getFromPackage(pkg).map { it.withCurrentBucketId() }
    }
 
    fun getNotificationByKey(key: String): ProcessedNotification? {
-      return notificationIdsByKeys[key]?.let { notifications[it] }
+      return notifications[key]?.withCurrentBucketId()
    }
 
    override fun pollNextVibration(): IntArray? {
@@ -399,13 +489,18 @@ class NotificationProcessor(
 
    override suspend fun markAsRead(bucketId: Int) {
       logcat { "Marking $bucketId as read" }
-      val notification = notifications.computeIfPresent(bucketId) { _, value ->
+      val key = watchSyncer.getNotificationKey(bucketId) ?: return
+      val notification = notifications.update(key) { value ->
          value.copy(unread = false)
       } ?: return
 
       val preferences = ruleResolver.resolveRules(notification.systemData).preferences
 
-      watchSyncer.prepareNotificationReadStatus(notification, preferences)
+      watchSyncer.prepareNotificationReadStatus(notification.copy(bucketId = bucketId), preferences)
+   }
+
+   private fun ProcessedNotification.withCurrentBucketId(): ProcessedNotification {
+      return copy(bucketId = watchSyncer.getBucketId(systemData.key) ?: 0)
    }
 
    private fun List<Action>.renamePauseActions(newPausedStatus: PauseStatus): List<Action> = map { action ->
@@ -448,3 +543,24 @@ class NotificationProcessor(
       }
    }
 }
+
+private class PendingNotification(
+   val notification: ProcessedNotification,
+   val preparedNotification: PreparedNotification,
+   val muteReason: MuteReason?,
+   val vibrationPattern: IntArray?,
+)
+
+/**
+ * Notification with its rules resolved, ready to be committed by the [NotificationProcessor].
+ */
+data class PreparedNotification(
+   val parsedNotification: ParsedNotification,
+   /**
+    * [parsedNotification] with the text rules (regex replacements, hidden subtitles) applied
+    */
+   val textReplacedNotification: ParsedNotification,
+   val affectedRules: List<String>,
+   val settings: Preferences,
+   val hideReason: HideReason?,
+)
@@ -1,5 +1,7 @@
 package com.matejdro.pebblenotificationcenter.notification
 
+import android.app.Notification
+import android.app.NotificationManager
 import android.os.Build
 import android.os.Process
 import android.service.notification.NotificationListenerService
@@ -16,6 +18,9 @@ import com.matejdro.pebblenotificationcenter.rules.keys.get
 import dev.zacsweers.metro.Inject
 import dispatch.core.DefaultCoroutineScope
 import io.rebble.pebblekit2.client.PebbleInfoRetriever
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.async
+import kotlinx.coroutines.awaitAll
 import kotlinx.coroutines.delay
 import kotlinx.coroutines.flow.Flow
 import kotlinx.coroutines.flow.distinctUntilChanged
@@ -24,8 +29,7 @@ import kotlinx.coroutines.flow.flatMapLatest
 import kotlinx.coroutines.flow.flowOf
 import kotlinx.coroutines.flow.map
 import kotlinx.coroutines.launch
-import kotlinx.coroutines.sync.Mutex
-import kotlinx.coroutines.sync.withLock
+import kotlinx.coroutines.supervisorScope
 import logcat.logcat
 import si.inova.kotlinova.core.reporting.ErrorReporter
 import kotlin.time.Duration.Companion.milliseconds
@@ -55,7 +59,9 @@ class NotificationService : NotificationListenerService() {
    @Inject
    private lateinit var watchOpenController: WatchappOpenController
 
-   private val mutex = Mutex()
+   private lateinit var pipeline: NotificationPipeline
+
+   private lateinit var updateCoalescer: NotificationUpdateCoalescer<StatusBarNotification>
 
    private var bound = false
 
@@ -66,6 +72,14 @@ class NotificationService : NotificationListenerService() {
          .let { it as NotificationInject }
          .inject(this)
 
+      pipeline = NotificationPipeline(coroutineScope, Dispatchers.Default.limitedParallelism(MAX_PARALLEL_PREPARATIONS))
+      updateCoalescer = NotificationUpdateCoalescer(
+         coroutineScope,
+         UPDATE_COALESCING_WINDOW,
+         isAlerting = ::isAlertingPost,
+         process = ::processPostedNotification
+      )
+
       instance = this
 
       super.onCreate()
@@ -88,8 +102,9 @@ class NotificationService : NotificationListenerService() {
       }
       bound = true
 
+      updateCoalescer.cancelAll()
       coroutineScope.launch {
-         mutex.withLock {
+         pipeline.withCommitLock {
             notificationProcessor.onNotificationsCleared()
          }
 
@@ -106,34 +121,68 @@ class NotificationService : NotificationListenerService() {
    }
 
    suspend fun reloadAllNotifications() {
-      mutex.withLock {
-         for (sbn in activeNotifications) {
-            if (notificationProcessor.getNotificationByKey(sbn.key) != null) {
-               continue
-            }
+      val missingNotifications = pipeline.withCommitLock {
+         activeNotifications.filter { notificationProcessor.getNotificationByKey(it.key) == null }
+      }
 
-            val parsed = parseNotification(sbn)
-            if (parsed != null) {
-               notificationProcessor.onNotificationPosted(parsed, suppressVibration = true)
-            } else {
-               logcat { "Notification ${sbn.key} has no text. Skipping..." }
-            }
+      // Notifications are prepared in parallel, but committed together, in the original order
+      pipeline.submit(
+         missingNotifications.map { it.key },
+         prepare = { prepareNotifications(missingNotifications) }
+      ) { preparedNotifications ->
+         val notificationsToPost = preparedNotifications.filter {
+            notificationProcessor.getNotificationByKey(it.parsedNotification.key) == null
          }
+
+         notificationProcessor.onNotificationsPosted(notificationsToPost, suppressVibration = true)
+      }.join()
+   }
+
+   private suspend fun prepareNotifications(notifications: List<StatusBarNotification>): List<PreparedNotification> {
+      val preparedNotifications = supervisorScope {
+         notifications.map { sbn -> async { prepareNotification(sbn) } }.awaitAll()
+      }
+
+      return notifications.zip(preparedNotifications).mapNotNull { (sbn, preparedNotification) ->
+         if (preparedNotification == null) {
+            logcat { "Notification ${sbn.key} has no text. Skipping..." }
+         }
+
+         preparedNotification
       }
    }
 
    override fun onNotificationPosted(sbn: StatusBarNotification) {
       logcat { "Notification ${sbn.key} posted" }
-      coroutineScope.launch {
-         mutex.withLock {
-            val parsed = parseNotification(sbn)
-            if (parsed == null) {
-               logcat { "Notification ${sbn.key} has no text. Skipping..." }
-               return@launch
-            }
-            notificationProcessor.onNotificationPosted(parsed)
-         }
+      updateCoalescer.submit(sbn.key, sbn)
+   }
+
+   /**
+    * Whether the system would alert the user for this post. Progress bars and typing indicators are usually either
+    * posted with the "only alert once" flag or on a low importance channel.
+    */
+   private fun isAlertingPost(sbn: StatusBarNotification): Boolean {
+      if ((sbn.notification.flags and Notification.FLAG_ONLY_ALERT_ONCE) != 0) {
+         return false
       }
+
+      val ranking = Ranking()
+      return currentRanking.getRanking(sbn.key, ranking) && ranking.importance >= NotificationManager.IMPORTANCE_DEFAULT
+   }
+
+   private suspend fun processPostedNotification(sbn: StatusBarNotification) {
+      pipeline.submit(sbn.key, prepare = { prepareNotification(sbn) }) { prepared ->
+         if (prepared == null) {
+            logcat { "Notification ${sbn.key} has no text. Skipping..." }
+            return@submit
+         }
+         notificationProcessor.onNotificationPosted(prepared)
+      }.join()
+   }
+
+   private suspend fun prepareNotification(sbn: StatusBarNotification): PreparedNotification? {
+      val parsed = parseNotification(sbn) ?: return null
+      return notificationProcessor.prepareNotification(parsed)
    }
 
    private suspend fun parseNotification(sbn: StatusBarNotification): ParsedNotification? {
@@ -151,10 +200,10 @@ class NotificationService : NotificationListenerService() {
    override fun onNotificationRemoved(sbn: StatusBarNotification) {
       logcat { "Notification ${sbn.key} removed" }
 
-      coroutineScope.launch {
-         mutex.withLock {
-            notificationProcessor.onNotificationDismissed(sbn.key)
-         }
+      updateCoalescer.cancel(sbn.key)
+      notificationParser.onNotificationRemoved(sbn.key)
+      pipeline.submit(sbn.key, prepare = {}) {
+         notificationProcessor.onNotificationDismissed(sbn.key)
       }
    }
 
@@ -259,3 +308,5 @@ class NotificationService : NotificationListenerService() {
 }
 
 private const val CDM_WAIT_ATTEMPTS = 10
+private const val MAX_PARALLEL_PREPARATIONS = 4
+private val UPDATE_COALESCING_WINDOW = 500.milliseconds
@@ -0,0 +1,104 @@
+package com.matejdro.pebblenotificationcenter.notification
+
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.CoroutineStart
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.launch
+import logcat.logcat
+import kotlin.time.Duration
+
+/**
+ * Collapses bursts of updates of the same notification (progress bars, typing indicators etc.) into the latest one.
+ *
+ * First update of every key is processed immediately. Updates that arrive within the [window] after that are not
+ * processed one by one - only the latest of them is processed when the window ends.
+ *
+ * Updates that should alert the user (see [isAlerting]) are never coalesced, since a later silent update would
+ * replace them and the alert would be lost. They are processed immediately and start a new window.
+ */
+class NotificationUpdateCoalescer<T>(
+   private val scope: CoroutineScope,
+   private val window: Duration,
+   private val isAlerting: (T) -> Boolean = { false },
+   private val process: suspend (T) -> Unit,
+) {
+   private val windows = HashMap<String, UpdateWindow<T>>()
+
+   fun submit(key: String, update: T) {
+      val newWindow = synchronized(windows) {
+         val existingWindow = windows[key]
+         if (existingWindow != null && isAlerting(update)) {
+            logcat { "Alerting update of $key, processing immediately" }
+            // Any pending update is older than this one, so it can be dropped
+            existingWindow.pendingUpdate = null
+         } else if (existingWindow != null) {
+            if (existingWindow.pendingUpdate != null) {
+               logcat { "Coalescing update of $key" }
+            }
+
+            existingWindow.pendingUpdate = update
+            return
+         }
+
+         UpdateWindow<T>().also { windows[key] = it }
+      }
+
+      // Start undispatched, so processing of the first update begins in the order the updates arrived
+      scope.launch(start = CoroutineStart.UNDISPATCHED) {
+         processUpdates(key, newWindow, update)
+      }
+   }
+
+   /**
+    * Drop any pending updates of the [key]. Update that is already being processed is not interrupted.
+    */
+   fun cancel(key: String) {
+      synchronized(windows) {
+         windows.remove(key)?.pendingUpdate = null
+      }
+   }
+
+   fun cancelAll() {
+      synchronized(windows) {
+         for (window in windows.values) {
+            window.pendingUpdate = null
+         }
+         windows.clear()
+      }
+   }
+
+   private suspend fun processUpdates(key: String, updateWindow: UpdateWindow<T>, firstUpdate: T) {
+      try {
+         var nextUpdate: T? = firstUpdate
+         while (nextUpdate != null) {
+            process(nextUpdate)
+            delay(window)
+
+            nextUpdate = synchronized(windows) {
+               if (windows[key] !== updateWindow) {
+                  // Window was cancelled or replaced by an alerting update
+                  return
+               }
+
+               val pendingUpdate = updateWindow.pendingUpdate
+               updateWindow.pendingUpdate = null
+               if (pendingUpdate == null) {
+                  windows.remove(key)
+               }
+
+               pendingUpdate
+            }
+         }
+      } finally {
+         synchronized(windows) {
+            if (windows[key] === updateWindow) {
+               windows.remove(key)
+            }
+         }
+      }
+   }
+
+   private class UpdateWindow<T> {
+      var pendingUpdate: T? = null
+   }
+}
@@ -34,7 +34,7 @@ class PauseControllerImpl(
    }
 
    override suspend fun onNotificationDismissed(notification: ParsedNotification) {
-      val existingNotificationsFromThisPkg = repo().getAllActiveNotifications().filter { it.systemData.pkg == notification.pkg }
+      val existingNotificationsFromThisPkg = repo().getActiveNotificationsFromPackage(notification.pkg)
       if (existingNotificationsFromThisPkg.isEmpty()) {
          mutedApps.remove(notification.pkg)
          repo().notifyPackagePauseStatusChanged(notification.pkg)
@@ -1,14 +1,124 @@
 package com.matejdro.pebblenotificationcenter.notification
 
+import java.util.regex.Matcher
+
 internal fun replaceRegexes(input: String, replacements: Collection<Pair<String, String>>): String {
    if (replacements.isEmpty()) {
       return input
    }
 
-   return replacements.fold(input) { text, (from, to) ->
-      Regex(from).replace(text, to)
+   return compileRegexReplacements(replacements).replace(input)
+}
+
+/**
+ * A regex replacement set with all patterns and templates compiled up front, so it can be applied to many strings
+ * without re-parsing anything.
+ */
+internal class CompiledRegexReplacements(private val replacements: List<Pair<Regex, String>>) {
+   fun replace(input: String): String {
+      return replacements.fold(input) { text, (from, to) ->
+         from.replace(text, to)
+      }
+   }
+}
+
+internal fun compileRegexReplacements(replacements: Collection<Pair<String, String>>): CompiledRegexReplacements {
+   return CompiledRegexReplacements(
+      replacements.map { (from, to) -> Regex(from) to compileReplacementTemplate(to) }
+   )
+}
+
+/**
+ * Small LRU cache of compiled replacement sets. Replacement sets only change when the user edits a rule, so a cache
+ * keyed by the set itself effectively compiles every rule version once.
+ */
+internal class RegexReplacementCache(private val maxSize: Int = DEFAULT_MAX_CACHED_REPLACEMENT_SETS) {
+   private val cache = object : LinkedHashMap<Collection<Pair<String, String>>, CompiledRegexReplacements>(
+      maxSize,
+      LOAD_FACTOR,
+      true
+   ) {
+      override fun removeEldestEntry(
+         eldest: MutableMap.MutableEntry<Collection<Pair<String, String>>, CompiledRegexReplacements>?,
+      ): Boolean {
+         return size > maxSize
+      }
    }
+
+   @Synchronized
+   fun get(replacements: Collection<Pair<String, String>>): CompiledRegexReplacements {
+      return cache.getOrPut(replacements) { compileRegexReplacements(replacements) }
+   }
+}
+
+/**
+ * Rewrites a replacement template so that the `\n`, `\t` and `\r` escapes the user typed are turned into the real
+ * characters at compile time, instead of with extra passes over the replaced text.
+ *
+ * Group references (and any malformed syntax) are kept verbatim, so errors are still reported by the [Matcher]
+ * when the template is applied.
+ */
+private fun compileReplacementTemplate(template: String): String {
+   val result = StringBuilder(template.length)
+   val literal = StringBuilder()
+
+   fun flushLiteral() {
+      if (literal.isNotEmpty()) {
+         result.append(Matcher.quoteReplacement(literal.unescapeWhitespace()))
+         literal.clear()
+      }
+   }
+
+   var index = 0
+   while (index < template.length) {
+      val char = template[index]
+      when {
+         char == '\\' && index + 1 < template.length -> {
+            literal.append(template[index + 1])
+            index += 2
+         }
+
+         char == '$' || char == '\\' -> {
+            flushLiteral()
+            val referenceEnd = findGroupReferenceEnd(template, index)
+            result.append(template, index, referenceEnd)
+            index = referenceEnd
+         }
+
+         else -> {
+            literal.append(char)
+            index++
+         }
+      }
+   }
+   flushLiteral()
+
+   return result.toString()
+}
+
+private fun findGroupReferenceEnd(template: String, start: Int): Int {
+   var end = start + 1
+   if (template[start] != '$' || end >= template.length) {
+      return end
+   }
+
+   if (template[end] == '{') {
+      val closing = template.indexOf('}', end)
+      return if (closing < 0) template.length else closing + 1
+   }
+
+   while (end < template.length && template[end].isDigit()) {
+      end++
+   }
+   return end
+}
+
+private fun CharSequence.unescapeWhitespace(): String {
+   return toString()
       .replace("\\n", "\n")
       .replace("\\t", "\t")
       .replace("\\r", "\r")
 }
+
+private const val DEFAULT_MAX_CACHED_REPLACEMENT_SETS = 32
+private const val LOAD_FACTOR = 0.75f
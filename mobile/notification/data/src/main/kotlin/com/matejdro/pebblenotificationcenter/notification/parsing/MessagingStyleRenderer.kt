@@ -0,0 +1,204 @@
+package com.matejdro.pebblenotificationcenter.notification.parsing
+
+import android.net.Uri
+
+/**
+ * Renders MessagingStyle conversations into the notification body text.
+ *
+ * Chat apps re-post the whole conversation (often with hundreds of historic messages) for every new message. To avoid
+ * re-sorting and re-joining the whole history on every update, the renderer remembers the last result for every
+ * notification key and, when the only change is a batch of messages newer than all of the previous ones, it only
+ * renders the new messages and merges them into the previous text. Any other change falls back to the full render.
+ *
+ * Output is always identical to rendering the whole conversation from scratch.
+ */
+class MessagingStyleRenderer(private val maxConversations: Int = DEFAULT_MAX_CONVERSATIONS) {
+   private val cache = object : LinkedHashMap<String, RenderedConversation>(maxConversations, LOAD_FACTOR, true) {
+      override fun removeEldestEntry(eldest: MutableMap.MutableEntry<String, RenderedConversation>?): Boolean {
+         return size > maxConversations
+      }
+   }
+
+   /**
+    * @param messages all messages of the conversation (including historic ones), in the order they appear in the
+    * notification
+    * @return rendered conversation or *null* if there are no messages
+    */
+   fun render(key: String, messages: List<ConversationMessage>, chronological: Boolean): RenderedConversation? {
+      if (messages.isEmpty()) {
+         forget(key)
+         return null
+      }
+
+      val previous = synchronized(cache) { cache[key] }
+      val rendered = previous?.let { mergeNewMessages(it, messages, chronological) } ?: renderAll(messages, chronological)
+
+      synchronized(cache) { cache[key] = rendered }
+      return rendered
+   }
+
+   fun forget(key: String) {
+      synchronized(cache) { cache.remove(key) }
+   }
+
+   private fun renderAll(messages: List<ConversationMessage>, chronological: Boolean): RenderedConversation {
+      val lines = renderLines(messages.sortedForDisplay(chronological), previousName = null)
+
+      return RenderedConversation(
+         text = lines.text,
+         firstImage = lines.firstImage,
+         newestTimestamp = messages.maxOf { it.timestamp },
+         chronological = chronological,
+         messages = messages,
+         firstName = lines.firstName,
+         firstPrefixLength = lines.firstPrefixLength,
+         lastName = lines.lastName,
+      )
+   }
+
+   /**
+    * @return merged conversation or *null* if the [messages] are not just the [previous] messages
+    * with some newer messages added
+    */
+   private fun mergeNewMessages(
+      previous: RenderedConversation,
+      messages: List<ConversationMessage>,
+      chronological: Boolean,
+   ): RenderedConversation? {
+      if (previous.chronological != chronological) {
+         return null
+      }
+
+      // Sorting is stable, so as long as the old messages keep their relative order, they stay in the same place
+      // and all new messages end up on the one end of the list.
+      val newMessages = ArrayList<ConversationMessage>()
+      var oldIndex = 0
+      for (message in messages) {
+         if (message.timestamp > previous.newestTimestamp) {
+            newMessages += message
+         } else if (oldIndex < previous.messages.size && message.isSameAs(previous.messages[oldIndex])) {
+            oldIndex++
+         } else {
+            return null
+         }
+      }
+
+      if (oldIndex != previous.messages.size) {
+         return null
+      }
+
+      if (newMessages.isEmpty()) {
+         return previous
+      }
+
+      val sortedNewMessages = newMessages.sortedForDisplay(chronological)
+      return if (chronological) {
+         val lines = renderLines(sortedNewMessages, previousName = previous.lastName)
+
+         previous.copy(
+            text = previous.text + "\n" + lines.text,
+            firstImage = previous.firstImage ?: lines.firstImage,
+            newestTimestamp = sortedNewMessages.last().timestamp,
+            messages = messages,
+            lastName = lines.lastName,
+         )
+      } else {
+         val lines = renderLines(sortedNewMessages, previousName = null)
+
+         // First previous line is no longer first, so it loses the name prefix if the new message above it
+         // is from the same person
+         val previousText = if (previous.firstName != null && lines.lastName == previous.firstName) {
+            previous.text.substring(previous.firstPrefixLength)
+         } else {
+            previous.text
+         }
+
+         previous.copy(
+            text = lines.text + "\n" + previousText,
+            firstImage = lines.firstImage ?: previous.firstImage,
+            newestTimestamp = sortedNewMessages.first().timestamp,
+            messages = messages,
+            firstName = lines.firstName,
+            firstPrefixLength = lines.firstPrefixLength,
+         )
+      }
+   }
+
+   private fun renderLines(messages: List<ConversationMessage>, previousName: CharSequence?): RenderedLines {
+      var lastName = previousName
+      var firstImage: Uri? = null
+      var firstPrefixLength = 0
+
+      val text = messages.withIndex().joinToString("\n") { (index, message) ->
+         if (firstImage == null) {
+            firstImage = message.imageUri
+         }
+
+         val personName = message.personName
+         val text = message.text?.toString().orEmpty()
+         if (personName != null && lastName != personName) {
+            if (index == 0) {
+               firstPrefixLength = personName.length + NAME_SEPARATOR.length
+            }
+            "$personName$NAME_SEPARATOR$text"
+         } else {
+            text
+         }.also {
+            lastName = personName
+         }
+      }
+
+      return RenderedLines(text, firstImage, messages.first().personName, firstPrefixLength, lastName)
+   }
+
+   private fun List<ConversationMessage>.sortedForDisplay(chronological: Boolean): List<ConversationMessage> {
+      return if (chronological) {
+         sortedBy { it.timestamp }
+      } else {
+         sortedByDescending { it.timestamp }
+      }
+   }
+
+   private class RenderedLines(
+      val text: String,
+      val firstImage: Uri?,
+      val firstName: CharSequence?,
+      val firstPrefixLength: Int,
+      val lastName: CharSequence?,
+   )
+}
+
+class ConversationMessage(
+   val timestamp: Long,
+   /**
+    * Name of the message sender, falling back to the name of the user when the sender is not set
+    */
+   val personName: CharSequence?,
+   val text: CharSequence?,
+   /**
+    * Uri of the image attached to the message, if any
+    */
+   val imageUri: Uri?,
+) {
+   fun isSameAs(other: ConversationMessage): Boolean {
+      return timestamp == other.timestamp &&
+         personName?.toString() == other.personName?.toString() &&
+         text?.toString() == other.text?.toString() &&
+         imageUri == other.imageUri
+   }
+}
+
+data class RenderedConversation(
+   val text: String,
+   val firstImage: Uri?,
+   val newestTimestamp: Long,
+   internal val chronological: Boolean,
+   internal val messages: List<ConversationMessage>,
+   internal val firstName: CharSequence?,
+   internal val firstPrefixLength: Int,
+   internal val lastName: CharSequence?,
+)
+
+private const val NAME_SEPARATOR = ": "
+private const val DEFAULT_MAX_CONVERSATIONS = 50
+private const val LOAD_FACTOR = 0.75f
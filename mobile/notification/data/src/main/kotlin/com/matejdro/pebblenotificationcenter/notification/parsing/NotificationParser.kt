@@ -4,9 +4,9 @@ import android.app.Notification
 import android.app.NotificationChannel
 import android.app.NotificationManager
 import android.content.Context
+import android.content.pm.PackageManager
 import android.graphics.Bitmap
 import android.graphics.drawable.Icon
-import android.net.Uri
 import android.os.Build
 import android.service.notification.NotificationListenerService
 import android.service.notification.StatusBarNotification
@@ -15,6 +15,7 @@ import androidx.core.os.BundleCompat
 import com.matejdro.pebblenotificationcenter.notification.NotificationConstants
 import com.matejdro.pebblenotificationcenter.notification.R
 import com.matejdro.pebblenotificationcenter.notification.api.AppNameProvider
+import com.matejdro.pebblenotificationcenter.notification.model.LazyImage
 import com.matejdro.pebblenotificationcenter.notification.model.NativeAction
 import com.matejdro.pebblenotificationcenter.notification.model.ParsedNotification
 import com.matejdro.pebblenotificationcenter.notification.utils.parseVibrationPattern
@@ -26,6 +27,8 @@ class NotificationParser(
    private val context: Context,
    private val appNameProvider: AppNameProvider,
 ) {
+   private val messagingStyleRenderer = MessagingStyleRenderer()
+
    fun parse(
       sbn: StatusBarNotification,
       channel: Any?,
@@ -35,8 +38,8 @@ class NotificationParser(
       val notification = sbn.notification
       val title = appNameProvider.getAppName(sbn.packageName)
 
-      val (imageUri, messagingStyleText) = notification.parseMessagingStyle(showMessagingStyleChronologically)
-      val (conversationTitle, subtitle, text) = parseSubtitleAndBody(notification, messagingStyleText)
+      val conversation = notification.parseMessagingStyle(sbn.key, showMessagingStyleChronologically)
+      val (conversationTitle, subtitle, text) = parseSubtitleAndBody(notification, conversation?.text)
 
       if (subtitle.isBlank() && text.isNullOrBlank()) {
          return null
@@ -50,10 +53,8 @@ class NotificationParser(
          sbn.postTime
       }
 
-      val largeImage = imageUri?.let { Icon.createWithContentUri(it) }
-         ?: BundleCompat.getParcelable<Bitmap>(notification.extras, NotificationCompat.EXTRA_PICTURE, Bitmap::class.java)
-            ?.let { Icon.createWithBitmap(it) }
-         ?: BundleCompat.getParcelable<Icon>(notification.extras, NotificationCompat.EXTRA_PICTURE_ICON, Icon::class.java)
+      val largeImage = conversation?.firstImage?.let { uri -> LazyImage { Icon.createWithContentUri(uri) } }
+         ?: notification.parseBigPicture()
 
       val subtitleWithCameraEmoji = if (!subtitle.contains("\uD83D\uDCF7") && largeImage != null) {
          "\uD83D\uDCF7 $subtitle"
@@ -70,7 +71,7 @@ class NotificationParser(
          subtitle = subtitleWithCameraEmoji,
          body = text.orEmpty(),
          conversationTitle = conversationTitle,
-         timestamp = Instant.ofEpochMilli(notification.parseMessagingStyleTimestamp() ?: timestampMillis),
+         timestamp = Instant.ofEpochMilli(conversation?.newestTimestamp ?: timestampMillis),
          isSilent = isSilent,
          isFilteredByDoNotDisturb = ranking?.matchesInterruptionFilter() == false,
          nativeActions = notification.parseActions(),
@@ -82,11 +83,19 @@ class NotificationParser(
          forceVibrate = sbn.packageName == context.packageName &&
             notification.extras.getBoolean(NotificationConstants.KEY_FORCE_VIBRATE, false),
          overrideVibrationPattern = parseVibrationPattern(notification),
-         iconDrawable = notification.smallIcon?.loadDrawable(context),
+         icon = notification.smallIcon,
+         iconId = notification.smallIcon?.getStableId(),
          largeImage = largeImage
       )
    }
 
+   /**
+    * Forget the state kept for the notification with the [key] after it was removed
+    */
+   fun onNotificationRemoved(key: String) {
+      messagingStyleRenderer.forget(key)
+   }
+
    private fun parseSubtitleAndBody(
       notification: Notification,
       messagingStyleText: String?,
@@ -152,51 +161,55 @@ class NotificationParser(
       return channelId to isSilent
    }
 
-   private fun Notification.parseMessagingStyle(showChronologically: Boolean): Pair<Uri?, String?> {
-      val messagingStyle = NotificationCompat.MessagingStyle.extractMessagingStyleFromNotification(this) ?: return (null to null)
+   private fun Notification.parseMessagingStyle(key: String, showChronologically: Boolean): RenderedConversation? {
+      val messagingStyle = NotificationCompat.MessagingStyle.extractMessagingStyleFromNotification(this) ?: return null
 
-      val messages = (messagingStyle.messages + messagingStyle.historicMessages).let { unsortedMessages ->
-         if (showChronologically) {
-            unsortedMessages.sortedBy { it.timestamp }
-         } else {
-            unsortedMessages.sortedByDescending { it.timestamp }
-         }
-      }
-      if (messages.isEmpty()) {
-         return (null to null)
+      val messages = (messagingStyle.messages + messagingStyle.historicMessages).map { message ->
+         ConversationMessage(
+            timestamp = message.timestamp,
+            personName = message.person?.name ?: messagingStyle.user.name,
+            text = message.text,
+            imageUri = message.dataUri.takeIf { message.dataMimeType?.startsWith("image/") == true }
+         )
       }
 
-      var lastName: CharSequence? = null
-      var firstImage: Uri? = null
-
-      val text = messages.joinToString("\n") { message ->
-         if (firstImage == null && message.dataMimeType?.startsWith("image/") == true) {
-            firstImage = message.dataUri
-         }
+      return messagingStyleRenderer.render(key, messages, showChronologically)
+   }
 
-         val personName = message.person?.name ?: messagingStyle.user.name
-         val text = message.text?.toString().orEmpty()
-         if (personName != null && lastName != personName) {
-            "$personName: $text"
-         } else {
-            text
-         }.also {
-            lastName = personName
-         }
+   /**
+    * Only the extras are kept here. Picture is unparcelled when the image is loaded, so hidden notifications and
+    * updates that are never shown on the watch do not decode it or keep it in memory.
+    */
+   private fun Notification.parseBigPicture(): LazyImage? {
+      val extras = extras
+      if (!extras.containsKey(NotificationCompat.EXTRA_PICTURE) && !extras.containsKey(NotificationCompat.EXTRA_PICTURE_ICON)) {
+         return null
       }
 
-      return firstImage to text
+      // Platform BigPictureStyle always writes both keys, but either of them can be null. When both are, the image
+      // is treated as no longer available.
+      return LazyImage {
+         BundleCompat.getParcelable(extras, NotificationCompat.EXTRA_PICTURE, Bitmap::class.java)
+            ?.let { Icon.createWithBitmap(it) }
+            ?: BundleCompat.getParcelable(extras, NotificationCompat.EXTRA_PICTURE_ICON, Icon::class.java)
+      }
    }
 
-   private fun Notification.parseMessagingStyleTimestamp(): Long? {
-      val messagingStyle = NotificationCompat.MessagingStyle.extractMessagingStyleFromNotification(this) ?: return null
+   /**
+    * Resource IDs are reassigned when the app updates, so the ID also includes the last update time of the app.
+    */
+   private fun Icon.getStableId(): String? {
+      if (Build.VERSION.SDK_INT < Build.VERSION_CODES.P || type != Icon.TYPE_RESOURCE) {
+         return null
+      }
 
-      val messages = (messagingStyle.messages + messagingStyle.historicMessages)
-      if (messages.isEmpty()) {
+      val lastUpdateTime = try {
+         context.packageManager.getPackageInfo(resPackage, 0).lastUpdateTime
+      } catch (ignored: PackageManager.NameNotFoundException) {
          return null
       }
 
-      return messages.maxOf { it.timestamp }
+      return "$resPackage:$resId:$lastUpdateTime"
    }
 
    private fun Notification.parseInboxStyle(): String? {
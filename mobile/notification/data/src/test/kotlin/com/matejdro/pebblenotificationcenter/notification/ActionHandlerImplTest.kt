@@ -8,6 +8,7 @@ import com.matejdro.pebblenotificationcenter.bluetooth.SubmenuItem
 import com.matejdro.pebblenotificationcenter.bluetooth.SubmenuType
 import com.matejdro.pebblenotificationcenter.bluetooth.images.FakeImageSender
 import com.matejdro.pebblenotificationcenter.notification.model.Action
+import com.matejdro.pebblenotificationcenter.notification.model.LazyImage
 import com.matejdro.pebblenotificationcenter.notification.model.ParsedNotification
 import com.matejdro.pebblenotificationcenter.notification.model.ProcessedNotification
 import com.matejdro.pebblenotificationcenter.rules.FakeRulesRepository
@@ -515,7 +516,7 @@ class ActionHandlerImplTest {
    fun `Send bitmap to the watch when triggering show image action`() = runTest {
       insertDefaultRules()
 
-      val icon = Icon.createWithContentUri("content://image")
+      val icon = LazyImage { Icon.createWithContentUri("content://image") }
 
       repo.putNotification(
          2,
@@ -1,22 +1,34 @@
 package com.matejdro.pebblenotificationcenter.notification
 
+import androidx.datastore.core.DataStore
 import androidx.datastore.preferences.core.edit
 import androidx.datastore.preferences.core.emptyPreferences
 import app.cash.turbine.test
 import com.matejdro.pebblenotificationcenter.common.test.InMemoryDataStore
 import com.matejdro.pebblenotificationcenter.notification.model.Action
 import com.matejdro.pebblenotificationcenter.rules.GlobalPreferenceKeys
+import com.matejdro.pebblenotificationcenter.rules.keys.get
 import com.matejdro.pebblenotificationcenter.rules.keys.set
+import dispatch.core.DefaultCoroutineScope
+import io.kotest.matchers.collections.shouldContain
+import io.kotest.matchers.collections.shouldNotContain
 import io.kotest.matchers.shouldBe
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.first
 import kotlinx.coroutines.test.runCurrent
 import kotlinx.coroutines.test.runTest
 import org.junit.jupiter.api.BeforeEach
 import org.junit.jupiter.api.Test
+import si.inova.kotlinova.core.test.TestScopeWithDispatcherProvider
 import si.inova.kotlinova.core.test.fakes.FakeActivity
+import java.io.IOException
+import kotlin.time.Duration.Companion.seconds
 
 class ActionOrderRepositoryImplTest {
+   private val scope = TestScopeWithDispatcherProvider()
    private val context = FakeActivity()
    private val preferenceStore = InMemoryDataStore(emptyPreferences())
+   private val failingPreferenceStore = FailingDataStore(preferenceStore)
    private lateinit var repo: ActionOrderRepositoryImpl
 
    @BeforeEach
@@ -31,11 +43,15 @@ class ActionOrderRepositoryImplTest {
       context.resources.putString(R.string.show_image, "Show image")
       context.resources.putString(R.string.hide_from_watch, "Hide from watch")
 
-      repo = ActionOrderRepositoryImpl(context, preferenceStore)
+      repo = ActionOrderRepositoryImpl(
+         context,
+         failingPreferenceStore,
+         DefaultCoroutineScope(scope.backgroundScope.coroutineContext)
+      )
    }
 
    @Test
-   fun `Start with default actions`() = runTest {
+   fun `Start with default actions`() = scope.runTest {
       repo.getList().test {
          runCurrent()
 
@@ -54,7 +70,7 @@ class ActionOrderRepositoryImplTest {
    }
 
    @Test
-   fun `Add missing default actions at the end`() = runTest {
+   fun `Add missing default actions at the end`() = scope.runTest {
       preferenceStore.edit { prefs ->
          prefs[GlobalPreferenceKeys.actionOrder] = listOf(
             "Other actions",
@@ -85,7 +101,7 @@ class ActionOrderRepositoryImplTest {
    }
 
    @Test
-   fun `Do not remove non-default entries after adding default ones`() = runTest {
+   fun `Do not remove non-default entries after adding default ones`() = scope.runTest {
       preferenceStore.edit { prefs ->
          prefs[GlobalPreferenceKeys.actionOrder] = listOf(
             "Reply",
@@ -119,7 +135,7 @@ class ActionOrderRepositoryImplTest {
    }
 
    @Test
-   fun `Reorder list items up`() = runTest {
+   fun `Reorder list items up`() = scope.runTest {
       repo.getList().test {
          runCurrent()
          repo.moveOrder("Pause app", 0)
@@ -140,7 +156,7 @@ class ActionOrderRepositoryImplTest {
    }
 
    @Test
-   fun `Reorder list items down`() = runTest {
+   fun `Reorder list items down`() = scope.runTest {
       repo.getList().test {
          runCurrent()
          repo.moveOrder("Dismiss", 5)
@@ -161,7 +177,7 @@ class ActionOrderRepositoryImplTest {
    }
 
    @Test
-   fun `Sort provided list according to the default order`() = runTest {
+   fun `Sort provided list according to the default order`() = scope.runTest {
       val inputList = listOf(
          Action.Dismiss("Pause app", 0u),
          Action.Dismiss("Dismiss", 1u),
@@ -176,7 +192,7 @@ class ActionOrderRepositoryImplTest {
    }
 
    @Test
-   fun `Sort provided list according to the stored action order`() = runTest {
+   fun `Sort provided list according to the stored action order`() = scope.runTest {
       repo.getList().test {
          runCurrent()
          cancelAndIgnoreRemainingEvents()
@@ -198,7 +214,7 @@ class ActionOrderRepositoryImplTest {
    }
 
    @Test
-   fun `Unknown actions should be sorted according to the 'Other Actions' entry`() = runTest {
+   fun `Unknown actions should be sorted according to the 'Other Actions' entry`() = scope.runTest {
       val inputList = listOf(
          Action.Dismiss("Pause app", 0u),
          Action.Dismiss("Dismiss", 1u),
@@ -213,7 +229,7 @@ class ActionOrderRepositoryImplTest {
    }
 
    @Test
-   fun `Unknown actions should be added to the list after the 'Other Actions' entry`() = runTest {
+   fun `Unknown actions should be added to the list after the 'Other Actions' entry`() = scope.runTest {
       val inputList = listOf(
          Action.Dismiss("Pause app", 0u),
          Action.Dismiss("Dismiss", 1u),
@@ -221,6 +237,7 @@ class ActionOrderRepositoryImplTest {
       )
 
       repo.sort(inputList)
+      delay(2.seconds)
 
       repo.getList().test {
          runCurrent()
@@ -239,4 +256,109 @@ class ActionOrderRepositoryImplTest {
          )
       }
    }
+
+   @Test
+   fun `Sort unknown actions without remembering them`() = scope.runTest {
+      val inputList = listOf(
+         Action.Dismiss("Pause app", 0u),
+         Action.Dismiss("Reply", 3u),
+         Action.Dismiss("Dismiss", 1u),
+      )
+
+      runCurrent()
+      val orderVersion = repo.orderVersion
+
+      repo.sort(inputList, rememberNewActions = false) shouldBe listOf(
+         Action.Dismiss("Dismiss", 1u),
+         Action.Dismiss("Reply", 3u),
+         Action.Dismiss("Pause app", 0u),
+      )
+      delay(2.seconds)
+
+      repo.orderVersion shouldBe orderVersion
+      preferenceStore.data.first()[GlobalPreferenceKeys.actionOrder].shouldNotContain("Reply")
+   }
+
+   @Test
+   fun `Write unknown actions to the disk after sorting`() = scope.runTest {
+      val inputList = listOf(
+         Action.Dismiss("Dismiss", 1u),
+         Action.Dismiss("Reply", 3u),
+      )
+
+      repo.sort(inputList)
+      preferenceStore.data.first()[GlobalPreferenceKeys.actionOrder].shouldNotContain("Reply")
+
+      delay(2.seconds)
+      preferenceStore.data.first()[GlobalPreferenceKeys.actionOrder].shouldContain("Reply")
+   }
+
+   @Test
+   fun `Do not change order version when persisting already ranked actions`() = scope.runTest {
+      runCurrent()
+      repo.sort(listOf(Action.Dismiss("Reply", 3u)))
+      val orderVersion = repo.orderVersion
+
+      delay(2.seconds)
+
+      preferenceStore.data.first()[GlobalPreferenceKeys.actionOrder].shouldContain("Reply")
+      repo.orderVersion shouldBe orderVersion
+   }
+
+   @Test
+   fun `Persist unknown actions with the next batch after a failed write`() = scope.runTest {
+      runCurrent()
+      failingPreferenceStore.failWrites = true
+      repo.sort(listOf(Action.Dismiss("Reply", 3u)))
+      delay(2.seconds)
+
+      failingPreferenceStore.failWrites = false
+      repo.sort(listOf(Action.Dismiss("Like", 4u)))
+      delay(2.seconds)
+
+      preferenceStore.data.first()[GlobalPreferenceKeys.actionOrder].shouldContain("Reply")
+      preferenceStore.data.first()[GlobalPreferenceKeys.actionOrder].shouldContain("Like")
+   }
+
+   @Test
+   fun `Sort according to the order changed outside the repository`() = scope.runTest {
+      preferenceStore.edit { prefs ->
+         prefs[GlobalPreferenceKeys.actionOrder] = listOf(
+            "Pause app",
+            "Other actions",
+            "Dismiss",
+            "Snooze",
+            "Show image",
+            "Unpause app",
+            "Pause conversation",
+            "Unpause conversation",
+            "Hide from watch",
+         )
+      }
+      runCurrent()
+
+      val inputList = listOf(
+         Action.Dismiss("Dismiss", 1u),
+         Action.Dismiss("Other actions", 2u),
+         Action.Dismiss("Pause app", 0u),
+      )
+
+      repo.sort(inputList) shouldBe listOf(
+         Action.Dismiss("Pause app", 0u),
+         Action.Dismiss("Other actions", 2u),
+         Action.Dismiss("Dismiss", 1u),
+      )
+   }
+}
+
+private class FailingDataStore<T>(private val delegate: DataStore<T>) : DataStore<T> by delegate {
+   var failWrites = false
+
+   override suspend fun updateData(transform: suspend (t: T) -> T): T {
+      if (failWrites) {
+         throw IOException("Write failed")
+      }
+
+      return delegate.updateData(transform)
+   }
 }
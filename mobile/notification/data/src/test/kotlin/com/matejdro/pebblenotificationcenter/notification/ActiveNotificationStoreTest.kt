@@ -0,0 +1,90 @@
+package com.matejdro.pebblenotificationcenter.notification
+
+import com.matejdro.pebblenotificationcenter.notification.model.ParsedNotification
+import com.matejdro.pebblenotificationcenter.notification.model.ProcessedNotification
+import io.kotest.matchers.collections.shouldBeEmpty
+import io.kotest.matchers.collections.shouldContainExactly
+import io.kotest.matchers.collections.shouldContainExactlyInAnyOrder
+import io.kotest.matchers.nulls.shouldBeNull
+import io.kotest.matchers.shouldBe
+import org.junit.jupiter.api.Test
+import java.time.Instant
+
+class ActiveNotificationStoreTest {
+   private val store = ActiveNotificationStore()
+
+   @Test
+   fun `Return notifications from a package`() {
+      store.put(notification("a", "com.app1"))
+      store.put(notification("b", "com.app2"))
+      store.put(notification("c", "com.app1"))
+
+      store.getFromPackage("com.app1").map { it.systemData.key }.shouldContainExactlyInAnyOrder("a", "c")
+      store.getFromPackage("com.app2").map { it.systemData.key }.shouldContainExactly("b")
+      store.getFromPackage("com.app3").shouldBeEmpty()
+   }
+
+   @Test
+   fun `Remove notifications from the package index`() {
+      store.put(notification("a", "com.app1"))
+      store.put(notification("b", "com.app1"))
+
+      store.remove("a")
+
+      store.getFromPackage("com.app1").map { it.systemData.key }.shouldContainExactly("b")
+      store["a"].shouldBeNull()
+   }
+
+   @Test
+   fun `Move notification between package indices when its package changes`() {
+      store.put(notification("a", "com.app1"))
+      store.put(notification("a", "com.app2"))
+
+      store.getFromPackage("com.app1").shouldBeEmpty()
+      store.getFromPackage("com.app2").map { it.systemData.key }.shouldContainExactly("a")
+   }
+
+   @Test
+   fun `Keep indices when updating a notification`() {
+      store.put(notification("a", "com.app1"))
+
+      store.update("a") { it.copy(unread = true) }
+
+      store["a"]?.unread shouldBe true
+      store.getFromPackage("com.app1").map { it.unread }.shouldContainExactly(true)
+   }
+
+   @Test
+   fun `Do not update missing notifications`() {
+      store.update("a") { it.copy(unread = false) }.shouldBeNull()
+
+      store.getAll().shouldBeEmpty()
+   }
+
+   @Test
+   fun `Clear all indices`() {
+      store.put(notification("a", "com.app1"))
+      store.put(notification("b", "com.app2"))
+
+      store.clear()
+
+      store.getAll().shouldBeEmpty()
+      store.getFromPackage("com.app1").shouldBeEmpty()
+      store.getFromPackage("com.app2").shouldBeEmpty()
+   }
+
+   private fun notification(key: String, pkg: String): ProcessedNotification {
+      return ProcessedNotification(
+         ParsedNotification(
+            key,
+            pkg,
+            "Title",
+            "sTitle",
+            "Body",
+            // 19:18:25 GMT | Sunday, January 4, 2026
+            Instant.ofEpochSecond(1_767_554_305)
+         ),
+         0
+      )
+   }
+}
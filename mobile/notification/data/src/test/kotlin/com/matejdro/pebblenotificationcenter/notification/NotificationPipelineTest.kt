@@ -0,0 +1,102 @@
+package com.matejdro.pebblenotificationcenter.notification
+
+import io.kotest.matchers.collections.shouldContainExactly
+import kotlinx.coroutines.CoroutineExceptionHandler
+import kotlinx.coroutines.CoroutineScope
+import kotlinx.coroutines.Job
+import kotlinx.coroutines.SupervisorJob
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.test.StandardTestDispatcher
+import kotlinx.coroutines.test.TestScope
+import kotlinx.coroutines.test.advanceTimeBy
+import kotlinx.coroutines.test.runCurrent
+import kotlinx.coroutines.test.runTest
+import org.junit.jupiter.api.Test
+import kotlin.time.Duration.Companion.milliseconds
+
+class NotificationPipelineTest {
+   private val committed = mutableListOf<String>()
+
+   @Test
+   fun `Prepare notifications concurrently`() = runTest {
+      val pipeline = createPipeline()
+
+      pipeline.submit("key1", prepare = { delay(100.milliseconds); "A" }) { committed.add(it) }
+      pipeline.submit("key2", prepare = { delay(100.milliseconds); "B" }) { committed.add(it) }
+
+      advanceTimeBy(101.milliseconds)
+      runCurrent()
+
+      committed.shouldContainExactly("A", "B")
+   }
+
+   @Test
+   fun `Commit events of the same key in the submission order`() = runTest {
+      val pipeline = createPipeline()
+
+      pipeline.submit("key", prepare = { delay(100.milliseconds); "A" }) { committed.add(it) }
+      pipeline.submit("key", prepare = { "B" }) { committed.add(it) }
+
+      runCurrent()
+      committed.shouldContainExactly()
+
+      advanceTimeBy(101.milliseconds)
+      runCurrent()
+
+      committed.shouldContainExactly("A", "B")
+   }
+
+   @Test
+   fun `Do not wait for events of other keys`() = runTest {
+      val pipeline = createPipeline()
+
+      pipeline.submit("key1", prepare = { delay(100.milliseconds); "A" }) { committed.add(it) }
+      pipeline.submit("key2", prepare = { "B" }) { committed.add(it) }
+
+      runCurrent()
+      committed.shouldContainExactly("B")
+
+      advanceTimeBy(101.milliseconds)
+      runCurrent()
+
+      committed.shouldContainExactly("B", "A")
+   }
+
+   @Test
+   fun `Commit events of multiple keys after all previous events of these keys`() = runTest {
+      val pipeline = createPipeline()
+
+      pipeline.submit("key1", prepare = { delay(100.milliseconds); "A" }) { committed.add(it) }
+      pipeline.submit("key2", prepare = { delay(200.milliseconds); "B" }) { committed.add(it) }
+      pipeline.submit(listOf("key1", "key2"), prepare = { "C" }) { committed.add(it) }
+
+      advanceTimeBy(101.milliseconds)
+      runCurrent()
+      committed.shouldContainExactly("A")
+
+      advanceTimeBy(100.milliseconds)
+      runCurrent()
+
+      committed.shouldContainExactly("A", "B", "C")
+   }
+
+   @Test
+   fun `Keep committing events after a failed commit of the same key`() = runTest {
+      val scopeIgnoringErrors = CoroutineScope(
+         backgroundScope.coroutineContext +
+            SupervisorJob(backgroundScope.coroutineContext[Job]) +
+            CoroutineExceptionHandler { _, _ -> }
+      )
+      val pipeline = NotificationPipeline(scopeIgnoringErrors, StandardTestDispatcher(testScheduler))
+
+      pipeline.submit("key", prepare = { "A" }) { error("Commit failed") }
+      pipeline.submit("key", prepare = { "B" }) { committed.add(it) }
+      runCurrent()
+
+      committed.shouldContainExactly("B")
+   }
+
+   private fun TestScope.createPipeline(): NotificationPipeline {
+      return NotificationPipeline(backgroundScope, StandardTestDispatcher(testScheduler))
+   }
+}
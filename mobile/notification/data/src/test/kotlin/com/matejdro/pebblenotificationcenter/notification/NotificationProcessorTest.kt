@@ -5,6 +5,7 @@ import android.graphics.drawable.Icon
 import android.os.Build
 import androidx.datastore.preferences.core.edit
 import androidx.datastore.preferences.core.emptyPreferences
+import com.matejdro.pebblenotificationcenter.bluetooth.FakeNotificationDetailsPrebuilder
 import com.matejdro.pebblenotificationcenter.bluetooth.FakeWatchSyncer
 import com.matejdro.pebblenotificationcenter.bluetooth.FakeWatchappOpenController
 import com.matejdro.pebblenotificationcenter.common.test.InMemoryDataStore
@@ -12,6 +13,7 @@ import com.matejdro.pebblenotificationcenter.notification.history.FakeHistoryIns
 import com.matejdro.pebblenotificationcenter.notification.history.HideReason
 import com.matejdro.pebblenotificationcenter.notification.history.MuteReason
 import com.matejdro.pebblenotificationcenter.notification.model.Action
+import com.matejdro.pebblenotificationcenter.notification.model.LazyImage
 import com.matejdro.pebblenotificationcenter.notification.model.NativeAction
 import com.matejdro.pebblenotificationcenter.notification.model.ParsedNotification
 import com.matejdro.pebblenotificationcenter.notification.model.PauseStatus
@@ -59,9 +61,13 @@ class NotificationProcessorTest {
    private val historyInserter = FakeHistoryInserter()
 
    private val screenStateChecker = FakeScreenStateChecker()
+
+   private val detailsPrebuilder = FakeNotificationDetailsPrebuilder()
+
    private val processor = NotificationProcessor(
       context,
       watchSyncer,
+      detailsPrebuilder,
       openController,
       RuleResolver(rulesRepository),
       globalPreferences,
@@ -190,6 +196,63 @@ class NotificationProcessorTest {
       watchSyncer.clearAllCalled shouldBe true
    }
 
+   @Test
+   fun `It should sync notifications posted together in a single batch`() = runTest {
+      val notifications = listOf("key1", "key2").map { key ->
+         ParsedNotification(
+            key,
+            "com.app",
+            "Title",
+            "sTitle",
+            "Body",
+            // 19:18:25 GMT | Sunday, January 4, 2026
+            Instant.ofEpochSecond(1_767_554_305)
+         )
+      }
+
+      processor.onNotificationsPosted(notifications.map { processor.prepareNotification(it) }, suppressVibration = true)
+
+      watchSyncer.committedBatches shouldBe 1
+      processor.getNotification(1)?.systemData?.key shouldBe "key1"
+      processor.getNotification(2)?.systemData?.key shouldBe "key2"
+      processor.getNotificationByKey("key2")?.bucketId shouldBe 2
+   }
+
+   @Test
+   fun `It should prebuild details of the posted notifications`() = runTest {
+      val notification = ParsedNotification(
+         "key",
+         "com.app",
+         "Title",
+         "sTitle",
+         "Body",
+         // 19:18:25 GMT | Sunday, January 4, 2026
+         Instant.ofEpochSecond(1_767_554_305)
+      )
+
+      processor.onNotificationPosted(notification)
+
+      detailsPrebuilder.prebuiltNotifications.map { it.bucketId }.shouldContainExactly(1)
+   }
+
+   @Test
+   fun `It should invalidate prebuilt details of the dismissed notifications`() = runTest {
+      val notification = ParsedNotification(
+         "key",
+         "com.app",
+         "Title",
+         "sTitle",
+         "Body",
+         // 19:18:25 GMT | Sunday, January 4, 2026
+         Instant.ofEpochSecond(1_767_554_305)
+      )
+
+      processor.onNotificationPosted(notification)
+      processor.onNotificationDismissed("key")
+
+      detailsPrebuilder.invalidatedBuckets.shouldContainExactly(1)
+   }
+
    @Test
    fun `It should allow getting received notifications`() = runTest {
       val notification = ParsedNotification(
@@ -1435,6 +1498,7 @@ class NotificationProcessorTest {
       val processorWithOldVersion = NotificationProcessor(
          context,
          watchSyncer,
+         detailsPrebuilder,
          openController,
          RuleResolver(rulesRepository),
          globalPreferences,
@@ -1474,7 +1538,7 @@ class NotificationProcessorTest {
          "Body",
          // 19:18:25 GMT | Sunday, January 4, 2026
          Instant.ofEpochSecond(1_767_554_305),
-         largeImage = Icon.createWithContentUri("content://icon")
+         largeImage = LazyImage { Icon.createWithContentUri("content://icon") }
       )
 
       processor.onNotificationPosted(notification)
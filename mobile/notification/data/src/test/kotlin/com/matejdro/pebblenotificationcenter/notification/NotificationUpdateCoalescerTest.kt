@@ -0,0 +1,141 @@
+package com.matejdro.pebblenotificationcenter.notification
+
+import io.kotest.matchers.collections.shouldContainExactly
+import kotlinx.coroutines.test.TestScope
+import kotlinx.coroutines.test.advanceTimeBy
+import kotlinx.coroutines.test.runCurrent
+import kotlinx.coroutines.test.runTest
+import org.junit.jupiter.api.Test
+import kotlin.time.Duration.Companion.milliseconds
+
+class NotificationUpdateCoalescerTest {
+   private val processedUpdates = mutableListOf<String>()
+
+   @Test
+   fun `Process first update immediately`() = runTest {
+      val coalescer = createCoalescer()
+
+      coalescer.submit("key", "A")
+      runCurrent()
+
+      processedUpdates.shouldContainExactly("A")
+   }
+
+   @Test
+   fun `Only process the latest of the updates within the window`() = runTest {
+      val coalescer = createCoalescer()
+
+      coalescer.submit("key", "A")
+      runCurrent()
+      coalescer.submit("key", "B")
+      coalescer.submit("key", "C")
+      coalescer.submit("key", "D")
+      runCurrent()
+
+      processedUpdates.shouldContainExactly("A")
+
+      advanceTimeBy(501.milliseconds)
+      runCurrent()
+
+      processedUpdates.shouldContainExactly("A", "D")
+   }
+
+   @Test
+   fun `Process updates of different keys independently`() = runTest {
+      val coalescer = createCoalescer()
+
+      coalescer.submit("key1", "A")
+      coalescer.submit("key2", "B")
+      runCurrent()
+
+      processedUpdates.shouldContainExactly("A", "B")
+   }
+
+   @Test
+   fun `Process update immediately after the window without updates ends`() = runTest {
+      val coalescer = createCoalescer()
+
+      coalescer.submit("key", "A")
+      runCurrent()
+      advanceTimeBy(501.milliseconds)
+      runCurrent()
+
+      coalescer.submit("key", "B")
+      runCurrent()
+
+      processedUpdates.shouldContainExactly("A", "B")
+   }
+
+   @Test
+   fun `Do not process pending updates of cancelled keys`() = runTest {
+      val coalescer = createCoalescer()
+
+      coalescer.submit("key", "A")
+      runCurrent()
+      coalescer.submit("key", "B")
+      coalescer.cancel("key")
+
+      advanceTimeBy(501.milliseconds)
+      runCurrent()
+
+      processedUpdates.shouldContainExactly("A")
+   }
+
+   @Test
+   fun `Process first update after cancellation immediately`() = runTest {
+      val coalescer = createCoalescer()
+
+      coalescer.submit("key", "A")
+      runCurrent()
+      coalescer.cancel("key")
+      coalescer.submit("key", "B")
+      runCurrent()
+
+      processedUpdates.shouldContainExactly("A", "B")
+   }
+
+   @Test
+   fun `Process alerting update immediately`() = runTest {
+      val coalescer = createCoalescer()
+
+      coalescer.submit("key", "A")
+      runCurrent()
+      coalescer.submit("key", "B")
+      coalescer.submit("key", "!C")
+      runCurrent()
+
+      processedUpdates.shouldContainExactly("A", "!C")
+
+      advanceTimeBy(1000.milliseconds)
+      runCurrent()
+
+      processedUpdates.shouldContainExactly("A", "!C")
+   }
+
+   @Test
+   fun `Do not let a silent update replace an alerting update within the window`() = runTest {
+      val coalescer = createCoalescer()
+
+      coalescer.submit("key", "A")
+      runCurrent()
+      coalescer.submit("key", "!B")
+      runCurrent()
+      coalescer.submit("key", "C")
+      runCurrent()
+
+      processedUpdates.shouldContainExactly("A", "!B")
+
+      advanceTimeBy(501.milliseconds)
+      runCurrent()
+
+      processedUpdates.shouldContainExactly("A", "!B", "C")
+   }
+
+   private fun TestScope.createCoalescer(): NotificationUpdateCoalescer<String> {
+      return NotificationUpdateCoalescer(
+         backgroundScope,
+         500.milliseconds,
+         isAlerting = { it.startsWith("!") }
+      ) { processedUpdates.add(it) }
+   }
+}
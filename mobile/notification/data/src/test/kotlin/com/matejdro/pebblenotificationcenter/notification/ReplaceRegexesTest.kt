@@ -2,6 +2,7 @@ package com.matejdro.pebblenotificationcenter.notification
 
 import io.kotest.assertions.throwables.shouldThrow
 import io.kotest.matchers.shouldBe
+import io.kotest.matchers.types.shouldBeSameInstanceAs
 import org.junit.jupiter.api.Test
 
 class ReplaceRegexesTest {
@@ -36,4 +37,44 @@ class ReplaceRegexesTest {
    fun `Allow special whitespace in the literals`() {
       replaceRegexes("abc", listOf("a.." to "\\\\t\\\\r\\\\n")) shouldBe "\t\r\n"
    }
+
+   @Test
+   fun `Allow special whitespace next to capturing groups`() {
+      replaceRegexes("abc", listOf("a(.)." to "$1\\\\n$1")) shouldBe "b\nb"
+   }
+
+   @Test
+   fun `Do not unescape whitespace that was already in the input text`() {
+      replaceRegexes("a\\nc", listOf("a" to "e")) shouldBe "e\\nc"
+   }
+
+   @Test
+   fun `Keep escaped dollar signs as literals`() {
+      replaceRegexes("abc", listOf("b" to "\\$1")) shouldBe "a$1c"
+   }
+
+   @Test
+   fun `Apply multiple replacements in order`() {
+      replaceRegexes("abc", listOf("a" to "b", "bb" to "d")) shouldBe "dc"
+   }
+
+   @Test
+   fun `Reuse compiled replacements for identical replacement sets`() {
+      val cache = RegexReplacementCache()
+
+      val first = cache.get(setOf("a" to "b"))
+      val second = cache.get(setOf("a" to "b"))
+
+      first shouldBeSameInstanceAs second
+   }
+
+   @Test
+   fun `Compile again when the replacement set changes`() {
+      val cache = RegexReplacementCache()
+
+      cache.get(setOf("a" to "b"))
+      val changed = cache.get(setOf("a" to "c"))
+
+      changed.replace("abc") shouldBe "cbc"
+   }
 }
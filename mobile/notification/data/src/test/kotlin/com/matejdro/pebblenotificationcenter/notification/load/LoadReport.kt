@@ -0,0 +1,81 @@
+package com.matejdro.pebblenotificationcenter.notification.load
+
+import java.io.File
+import kotlin.math.ceil
+import kotlin.time.Duration
+import kotlin.time.DurationUnit
+
+/**
+ * Result of running a [NotificationStormScenario] through the [NotificationLoadGenerator].
+ *
+ * Timings are wall-clock times of the processor calls. Counters are deterministic, so they can be used as
+ * regression budgets in tests.
+ */
+data class LoadReport(
+   val scenario: String,
+   val events: Int,
+   val postedNotifications: Int,
+   val scenarioDuration: Duration,
+   val processingTime: Duration,
+   val stageTimings: Map<String, List<Duration>>,
+   /**
+    * Number of notifications that were written into the watch buckets
+    */
+   val bucketWrites: Int,
+   /**
+    * Number of notifications that were removed from the watch buckets
+    */
+   val bucketDeletions: Int,
+   val dataStoreReads: Int,
+   val historyWrites: Int,
+) {
+   /**
+    * Number of events that the processor could handle per second of processing time
+    */
+   val throughput: Double
+      get() = events / processingTime.toDouble(DurationUnit.SECONDS)
+
+   val bucketChurn: Int
+      get() = bucketWrites + bucketDeletions
+
+   fun percentile(stage: String, percentile: Double): Duration {
+      val sorted = stageTimings[stage].orEmpty().sorted()
+      if (sorted.isEmpty()) {
+         return Duration.ZERO
+      }
+
+      val rank = ceil(percentile / 100 * sorted.size).toInt().coerceIn(1, sorted.size)
+      return sorted[rank - 1]
+   }
+
+   fun format(): String {
+      return buildString {
+         appendLine("=== $scenario ===")
+         appendLine("Events: $events over $scenarioDuration ($postedNotifications posted notifications)")
+         appendLine("Processing time: $processingTime, throughput: ${throughput.toInt()} events/s")
+         for (stage in stageTimings.keys.sorted()) {
+            appendLine(
+               "   $stage: n=${stageTimings.getValue(stage).size} " +
+                  "p50=${percentile(stage, 50.0)} p99=${percentile(stage, 99.0)}"
+            )
+         }
+         appendLine("Bucket churn: $bucketChurn ($bucketWrites writes, $bucketDeletions deletions)")
+         appendLine("DataStore reads: $dataStoreReads")
+         append("History writes: $historyWrites")
+      }
+   }
+
+   /**
+    * Write the [format]ted report into the module's build reports, so it is kept as a build artifact
+    * and can be compared between releases.
+    */
+   fun writeToReports() {
+      val fileName = scenario.lowercase().replace(' ', '-')
+      val file = File(REPORTS_FOLDER, "$fileName.txt")
+      file.parentFile.mkdirs()
+      file.writeText(format())
+   }
+}
+
+// Unit tests run with the module folder as the working directory
+private const val REPORTS_FOLDER = "build/reports/notificationLoad"
@@ -0,0 +1,160 @@
+package com.matejdro.pebblenotificationcenter.notification.load
+
+import android.os.Build
+import androidx.datastore.core.DataStore
+import androidx.datastore.preferences.core.Preferences
+import androidx.datastore.preferences.core.emptyPreferences
+import com.matejdro.pebblenotificationcenter.bluetooth.FakeNotificationDetailsPrebuilder
+import com.matejdro.pebblenotificationcenter.bluetooth.FakeWatchSyncer
+import com.matejdro.pebblenotificationcenter.bluetooth.FakeWatchappOpenController
+import com.matejdro.pebblenotificationcenter.common.test.InMemoryDataStore
+import com.matejdro.pebblenotificationcenter.notification.FakePauseController
+import com.matejdro.pebblenotificationcenter.notification.NotificationProcessor
+import com.matejdro.pebblenotificationcenter.notification.R
+import com.matejdro.pebblenotificationcenter.notification.RuleResolver
+import com.matejdro.pebblenotificationcenter.notification.history.FakeHistoryInserter
+import com.matejdro.pebblenotificationcenter.notification.util.FakeScreenStateChecker
+import com.matejdro.pebblenotificationcenter.rules.FakeRulesRepository
+import com.matejdro.pebblenotificationcenter.rules.RulesRepository
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.Flow
+import kotlinx.coroutines.flow.onStart
+import si.inova.kotlinova.core.test.fakes.FakeActivity
+import kotlin.time.Duration
+import kotlin.time.Duration.Companion.nanoseconds
+
+/**
+ * Replays [NotificationStormScenario]s against a real [NotificationProcessor], backed by fakes that count
+ * the work the processor hands off to the rest of the app.
+ *
+ * Must run inside a test coroutine, so the delays between the events pass in virtual time.
+ */
+class NotificationLoadGenerator(
+   private val rules: List<String> = listOf("Default Rule"),
+) {
+   suspend fun run(scenario: NotificationStormScenario): LoadReport {
+      val harness = Harness()
+      harness.setUp(rules)
+
+      val stageTimings = HashMap<String, MutableList<Duration>>()
+
+      var currentTime = Duration.ZERO
+      var postedNotifications = 0
+      for (event in scenario.events) {
+         delay(event.at - currentTime)
+         currentTime = event.at
+
+         val processor = harness.processor
+         when (event) {
+            is StormEvent.Posted -> {
+               val prepared = measure(stageTimings, STAGE_PREPARE) {
+                  processor.prepareNotification(event.notification)
+               }
+               measure(stageTimings, STAGE_COMMIT) { processor.onNotificationPosted(prepared) }
+               postedNotifications++
+            }
+
+            is StormEvent.Dismissed -> {
+               measure(stageTimings, STAGE_DISMISS) { processor.onNotificationDismissed(event.key) }
+            }
+
+            is StormEvent.CatchUp -> {
+               val prepared = event.notifications.map {
+                  measure(stageTimings, STAGE_PREPARE) { processor.prepareNotification(it) }
+               }
+               measure(stageTimings, STAGE_CATCH_UP) {
+                  processor.onNotificationsPosted(prepared, suppressVibration = true)
+               }
+               postedNotifications += event.notifications.size
+            }
+         }
+      }
+
+      return LoadReport(
+         scenario = scenario.name,
+         events = scenario.events.sumOf { if (it is StormEvent.CatchUp) it.notifications.size else 1 },
+         postedNotifications = postedNotifications,
+         scenarioDuration = scenario.duration,
+         processingTime = stageTimings.values.flatten().fold(Duration.ZERO, Duration::plus),
+         stageTimings = stageTimings,
+         bucketWrites = harness.watchSyncer.syncedNotifications.size,
+         bucketDeletions = harness.watchSyncer.clearedNotifications.size,
+         dataStoreReads = harness.globalPreferences.reads + harness.rulesRepository.preferenceReads,
+         historyWrites = harness.historyInserter.insertedEntries.size,
+      )
+   }
+
+   private inline fun <T> measure(
+      stageTimings: MutableMap<String, MutableList<Duration>>,
+      stage: String,
+      block: () -> T,
+   ): T {
+      val start = System.nanoTime()
+      val result = block()
+      stageTimings.getOrPut(stage) { ArrayList() }.add((System.nanoTime() - start).nanoseconds)
+      return result
+   }
+
+   private class Harness {
+      val watchSyncer = FakeWatchSyncer()
+      val globalPreferences = CountingDataStore(InMemoryDataStore(emptyPreferences()))
+      val rulesRepository = CountingRulesRepository(FakeRulesRepository())
+      val historyInserter = FakeHistoryInserter()
+      private val context = FakeActivity()
+
+      val processor = NotificationProcessor(
+         context,
+         watchSyncer,
+         FakeNotificationDetailsPrebuilder(),
+         FakeWatchappOpenController(),
+         RuleResolver(rulesRepository),
+         globalPreferences,
+         FakePauseController(),
+         historyInserter,
+         FakeScreenStateChecker(),
+         androidVersion = Build.VERSION_CODES.VANILLA_ICE_CREAM
+      )
+
+      suspend fun setUp(rules: List<String>) {
+         context.resources.putString(R.string.dismiss, "Dismiss")
+         context.resources.putString(R.string.pause_app, "Pause app")
+         context.resources.putString(R.string.unpause_app, "Unpause app")
+         context.resources.putString(R.string.pause_conversation, "Pause conversation")
+         context.resources.putString(R.string.unpause_conversation, "Unpause conversation")
+         context.resources.putString(R.string.app_suffix) { "${it.elementAt(0)} (App)" }
+         context.resources.putString(R.string.snooze, "Snooze")
+         context.resources.putString(R.string.show_image, "Show image")
+         context.resources.putString(R.string.hide_from_watch, "Hide from watch")
+
+         for (rule in rules) {
+            rulesRepository.insert(rule)
+         }
+      }
+   }
+}
+
+private class CountingDataStore<T>(private val delegate: DataStore<T>) : DataStore<T> {
+   var reads = 0
+      private set
+
+   override val data: Flow<T>
+      get() = delegate.data.onStart { reads++ }
+
+   override suspend fun updateData(transform: suspend (t: T) -> T): T {
+      return delegate.updateData(transform)
+   }
+}
+
+private class CountingRulesRepository(private val delegate: RulesRepository) : RulesRepository by delegate {
+   var preferenceReads = 0
+      private set
+
+   override fun getRulePreferences(id: Int): Flow<Preferences> {
+      return delegate.getRulePreferences(id).onStart { preferenceReads++ }
+   }
+}
+
+const val STAGE_PREPARE = "prepare"
+const val STAGE_COMMIT = "commit"
+const val STAGE_DISMISS = "dismiss"
+const val STAGE_CATCH_UP = "catch-up commit"
@@ -0,0 +1,61 @@
+package com.matejdro.pebblenotificationcenter.notification.load
+
+import io.kotest.assertions.assertSoftly
+import io.kotest.matchers.ints.shouldBeLessThanOrEqual
+import io.kotest.matchers.shouldBe
+import kotlinx.coroutines.test.runTest
+import org.junit.jupiter.api.Test
+
+/**
+ * Runs the canned notification storms and checks them against the work budgets, so regressions
+ * (extra DataStore reads, duplicated bucket writes...) are caught before release.
+ */
+class NotificationLoadTest {
+   private val generator = NotificationLoadGenerator()
+
+   @Test
+   fun `Chat burst stays within budget`() = runTest {
+      val report = generator.run(NotificationStormScenario.chatBurst())
+      report.writeToReports()
+
+      report.postedNotifications shouldBe 600
+      report.assertWithinBudget()
+   }
+
+   @Test
+   fun `Progress bar spam stays within budget`() = runTest {
+      val report = generator.run(NotificationStormScenario.progressBarSpam())
+      report.writeToReports()
+
+      report.postedNotifications shouldBe 600
+      report.bucketDeletions shouldBe 1
+      report.assertWithinBudget()
+   }
+
+   @Test
+   fun `Startup catch-up stays within budget`() = runTest {
+      val report = generator.run(NotificationStormScenario.startupCatchUp())
+      report.writeToReports()
+
+      assertSoftly {
+         report.postedNotifications shouldBe 100
+         report.bucketWrites shouldBe 100
+         report.bucketDeletions shouldBe 100
+         report.stageTimings.getValue(STAGE_CATCH_UP).size shouldBe 1
+      }
+      report.assertWithinBudget()
+   }
+
+   private fun LoadReport.assertWithinBudget() {
+      assertSoftly {
+         bucketWrites shouldBeLessThanOrEqual postedNotifications
+         historyWrites shouldBeLessThanOrEqual postedNotifications
+         dataStoreReads shouldBeLessThanOrEqual postedNotifications * MAX_DATASTORE_READS_PER_NOTIFICATION
+      }
+   }
+}
+
+/**
+ * One read of the rule preferences (there is only the default rule) and one of the global preferences
+ */
+private const val MAX_DATASTORE_READS_PER_NOTIFICATION = 2
@@ -0,0 +1,149 @@
+package com.matejdro.pebblenotificationcenter.notification.load
+
+import com.matejdro.pebblenotificationcenter.notification.model.ParsedNotification
+import java.time.Instant
+import kotlin.time.Duration
+import kotlin.time.Duration.Companion.milliseconds
+import kotlin.time.Duration.Companion.minutes
+import kotlin.time.Duration.Companion.seconds
+import kotlin.time.toJavaDuration
+
+/**
+ * Scripted sequence of notification events that [NotificationLoadGenerator] replays against the notification processor.
+ */
+class NotificationStormScenario(
+   val name: String,
+   events: List<StormEvent>,
+) {
+   val events: List<StormEvent> = events.sortedBy { it.at }
+
+   val duration: Duration
+      get() = events.lastOrNull()?.at ?: Duration.ZERO
+
+   companion object {
+      /**
+       * Busy group chats: 10 apps, each posting 20 updates per minute to its conversation for 3 minutes
+       */
+      fun chatBurst(
+         apps: Int = 10,
+         updatesPerMinute: Int = 20,
+         length: Duration = 3.minutes,
+      ): NotificationStormScenario {
+         val interval = 60.seconds / updatesPerMinute
+         val updatesPerApp = (length / interval).toInt()
+
+         val events = (0 until apps).flatMap { app ->
+            // Spread apps across the interval, so they do not all post at the same moment
+            val offset = interval * app / apps
+
+            List(updatesPerApp) { update ->
+               val at = offset + interval * update
+               StormEvent.Posted(
+                  at,
+                  notification(
+                     key = "chat$app",
+                     pkg = "com.chat$app",
+                     title = "Group chat $app",
+                     subtitle = "Sender ${update % 5}",
+                     body = "Message number $update, which is long enough to need a few lines on the watch",
+                     at = at
+                  ).copy(conversationTitle = "Group chat $app")
+               )
+            }
+         }
+
+         return NotificationStormScenario("Chat burst", events)
+      }
+
+      /**
+       * Download notification that updates its progress 10 times per second and is dismissed when complete.
+       * It is not marked as ongoing, so it is not hidden by the default rules (worst case).
+       */
+      fun progressBarSpam(updates: Int = 600): NotificationStormScenario {
+         val interval = 100.milliseconds
+         val posts = List(updates) { update ->
+            val at = interval * update
+            StormEvent.Posted(
+               at,
+               notification(
+                  key = "download",
+                  pkg = "com.downloader",
+                  title = "Downloading update.zip",
+                  subtitle = "",
+                  body = "${update * 100 / updates}%",
+                  at = at
+               )
+            )
+         }
+
+         return NotificationStormScenario(
+            "Progress bar spam",
+            posts + StormEvent.Dismissed(interval * updates, "download")
+         )
+      }
+
+      /**
+       * Service (re)start with 100 notifications already in the tray, followed by the user dismissing all of them
+       */
+      fun startupCatchUp(count: Int = 100): NotificationStormScenario {
+         val notifications = List(count) {
+            notification(
+               key = "startup$it",
+               pkg = "com.app${it % 20}",
+               title = "Notification $it",
+               subtitle = "",
+               body = "Notification that was posted before the service started",
+               at = Duration.ZERO
+            )
+         }
+
+         val dismissals = notifications.mapIndexed { index, notification ->
+            StormEvent.Dismissed(10.seconds + 50.milliseconds * index, notification.key)
+         }
+
+         return NotificationStormScenario(
+            "Startup catch-up",
+            listOf(StormEvent.CatchUp(Duration.ZERO, notifications)) + dismissals
+         )
+      }
+
+      val canned: List<NotificationStormScenario>
+         get() = listOf(chatBurst(), progressBarSpam(), startupCatchUp())
+   }
+}
+
+sealed interface StormEvent {
+   /**
+    * Time of the event, from the start of the scenario
+    */
+   val at: Duration
+
+   data class Posted(override val at: Duration, val notification: ParsedNotification) : StormEvent
+   data class Dismissed(override val at: Duration, val key: String) : StormEvent
+
+   /**
+    * Multiple notifications posted at once, as the service does when it (re)connects
+    */
+   data class CatchUp(override val at: Duration, val notifications: List<ParsedNotification>) : StormEvent
+}
+
+private fun notification(
+   key: String,
+   pkg: String,
+   title: String,
+   subtitle: String,
+   body: String,
+   at: Duration,
+): ParsedNotification {
+   return ParsedNotification(
+      key,
+      pkg,
+      title,
+      subtitle,
+      body,
+      SCENARIO_START + at.toJavaDuration(),
+   )
+}
+
+// 19:18:25 GMT | Sunday, January 4, 2026
+private val SCENARIO_START = Instant.ofEpochSecond(1_767_554_305)
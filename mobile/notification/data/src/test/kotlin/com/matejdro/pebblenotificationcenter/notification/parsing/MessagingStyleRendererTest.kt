@@ -0,0 +1,151 @@
+package com.matejdro.pebblenotificationcenter.notification.parsing
+
+import android.net.Uri
+import io.kotest.matchers.nulls.shouldBeNull
+import io.kotest.matchers.nulls.shouldNotBeNull
+import io.kotest.matchers.shouldBe
+import io.kotest.matchers.types.shouldBeSameInstanceAs
+import org.junit.jupiter.api.Test
+
+class MessagingStyleRendererTest {
+   private val renderer = MessagingStyleRenderer()
+
+   @Test
+   fun `Render conversation in reverse chronological order`() {
+      val conversation = renderer.render(
+         "key",
+         listOf(
+            message(1, "Alice", "Hello"),
+            message(2, "Alice", "How are you?"),
+            message(3, "Bob", "Fine"),
+         ),
+         chronological = false
+      )
+
+      conversation.shouldNotBeNull().text shouldBe "Bob: Fine\nAlice: How are you?\nHello"
+      conversation.newestTimestamp shouldBe 3L
+   }
+
+   @Test
+   fun `Append new messages to the chronological conversation`() {
+      val history = listOf(
+         message(1, "Alice", "Hello"),
+         message(2, "Bob", "Hi"),
+      )
+      renderer.render("key", history, chronological = true)
+
+      val updated = history + message(3, "Bob", "How are you?") + message(4, "Alice", "Fine")
+
+      renderer.render("key", updated, chronological = true).shouldNotBeNull().text shouldBe
+         renderFromScratch(updated, chronological = true)
+   }
+
+   @Test
+   fun `Remove name of the previous first message when new message is from the same person`() {
+      val history = listOf(
+         message(1, "Alice", "Hello"),
+         message(2, "Bob", "Hi"),
+      )
+      renderer.render("key", history, chronological = false)
+
+      val updated = history + message(3, "Bob", "How are you?")
+      val conversation = renderer.render("key", updated, chronological = false)
+
+      conversation.shouldNotBeNull().text shouldBe "Bob: How are you?\nHi\nAlice: Hello"
+      conversation.text shouldBe renderFromScratch(updated, chronological = false)
+   }
+
+   @Test
+   fun `Return the same result when conversation did not change`() {
+      val history = listOf(
+         message(1, "Alice", "Hello"),
+         message(2, "Bob", "Hi"),
+      )
+      val first = renderer.render("key", history, chronological = false)
+
+      renderer.render("key", history.toList(), chronological = false) shouldBeSameInstanceAs first
+   }
+
+   @Test
+   fun `Render from scratch when old messages are removed`() {
+      val history = listOf(
+         message(1, "Alice", "Hello"),
+         message(2, "Bob", "Hi"),
+      )
+      renderer.render("key", history, chronological = false)
+
+      val updated = history.drop(1) + message(3, "Alice", "Bye")
+
+      renderer.render("key", updated, chronological = false).shouldNotBeNull().text shouldBe "Alice: Bye\nBob: Hi"
+   }
+
+   @Test
+   fun `Render from scratch when new message is not newer than the previous ones`() {
+      val history = listOf(
+         message(1, "Alice", "Hello"),
+         message(3, "Bob", "Hi"),
+      )
+      renderer.render("key", history, chronological = true)
+
+      val updated = history + message(2, "Bob", "Late message")
+
+      renderer.render("key", updated, chronological = true).shouldNotBeNull().text shouldBe
+         "Alice: Hello\nBob: Late message\nHi"
+   }
+
+   @Test
+   fun `Render from scratch when the order setting changes`() {
+      val history = listOf(
+         message(1, "Alice", "Hello"),
+         message(2, "Bob", "Hi"),
+      )
+      renderer.render("key", history, chronological = true)
+
+      renderer.render("key", history, chronological = false).shouldNotBeNull().text shouldBe "Bob: Hi\nAlice: Hello"
+   }
+
+   @Test
+   fun `Keep the first displayed image`() {
+      val oldImage = Uri.parse("content://images/old")
+      val newImage = Uri.parse("content://images/new")
+
+      val history = listOf(message(1, "Alice", "Hello", oldImage))
+      renderer.render("key", history, chronological = false)
+      renderer.render("key", history + message(2, "Alice", "Look", newImage), chronological = false)
+         .shouldNotBeNull().firstImage shouldBe newImage
+
+      renderer.render("key2", history, chronological = true)
+      renderer.render("key2", history + message(2, "Alice", "Look", newImage), chronological = true)
+         .shouldNotBeNull().firstImage shouldBe oldImage
+   }
+
+   @Test
+   fun `Match full render over a long stream of updates`() {
+      for (chronological in listOf(true, false)) {
+         var conversation = emptyList<ConversationMessage>()
+         for (index in 1..50) {
+            conversation = conversation + message(
+               timestamp = index.toLong(),
+               name = listOf("Alice", "Alice", "Bob", null)[index % 4],
+               text = "Message $index"
+            )
+
+            renderer.render("key$chronological", conversation, chronological).shouldNotBeNull().text shouldBe
+               renderFromScratch(conversation, chronological)
+         }
+      }
+   }
+
+   @Test
+   fun `Return null for empty conversations`() {
+      renderer.render("key", emptyList(), chronological = false).shouldBeNull()
+   }
+
+   private fun renderFromScratch(messages: List<ConversationMessage>, chronological: Boolean): String {
+      return MessagingStyleRenderer().render("key", messages, chronological).shouldNotBeNull().text
+   }
+
+   private fun message(timestamp: Long, name: String?, text: String, image: Uri? = null): ConversationMessage {
+      return ConversationMessage(timestamp, name, text, image)
+   }
+}
@@ -29,6 +29,7 @@ rootProject.name = "PebbleNotificationCenter"
 
 include(":app")
 include(":app-screenshot-tests")
+include(":benchmarks")
 include(":common")
 include(":common-android")
 include(":common-compose")
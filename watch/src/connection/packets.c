@@ -10,19 +10,26 @@
 #include "ui/window_image.h"
 #include "ui/window_notification/data_loading.h"
 #include "ui/window_notification/idle_handler.h"
+#include "utils/compression.h"
+
+// Phone sends compressed packet data in this key instead of the key 1
+#define KEY_COMPRESSED_DATA 100
+#define WATCH_FLAG_SUPPORTS_COMPRESSION 0x02
 
 static void receive_phone_welcome(const DictionaryIterator* iterator);
 static void receive_sync_restart(const DictionaryIterator* iterator);
-static void receive_sync_next_packet(const DictionaryIterator* iterator);
-static void receive_notification_details_text_packet(const DictionaryIterator* iterator);
+static void receive_sync_next_packet(uint8_t* data, size_t data_length);
+static void receive_notification_details_text_packet(const uint8_t* data, size_t data_length);
 static void receive_submenu_packet(const DictionaryIterator* iterator);
 static void receive_watch_packet(const DictionaryIterator* received);
 static void receive_vibrate_packet(const DictionaryIterator* iterator);
-static void receive_image_packet(const DictionaryIterator* iterator);
+static void receive_image_packet(const uint8_t* data, size_t data_length);
+static bool read_packet_data(const DictionaryIterator* iterator, uint8_t** data, size_t* data_length);
 
 static int close_retries_left = 3;
 static bool close_via_phone = true;
 static uint8_t active_buckets_holder[MAX_BUCKETS];
+static uint8_t* decompression_buffer = NULL;
 
 void packets_init()
 {
@@ -43,7 +50,7 @@ void send_watch_welcome()
     dict_write_uint16(iterator, 1, PROTOCOL_VERSION);
     dict_write_uint16(iterator, 2, bucket_sync_current_version);
     dict_write_uint16(iterator, 3, appmessage_max_size);
-    dict_write_uint8(iterator, 4, PBL_IF_COLOR_ELSE(1, 0));
+    dict_write_uint8(iterator, 4, PBL_IF_COLOR_ELSE(1, 0) | WATCH_FLAG_SUPPORTS_COMPRESSION);
     dict_write_uint16(iterator, 5, PBL_DISPLAY_WIDTH);
     dict_write_uint16(iterator, 6, PBL_DISPLAY_HEIGHT);
     dict_write_data(iterator, 7, active_buckets_holder, active_buckets->count);
@@ -176,10 +183,33 @@ bool send_request_image(const uint8_t notification_id, const bool crop)
     return true;
 }
 
+bool send_move_window(const uint8_t selected_index)
+{
+    DictionaryIterator* iterator;
+    const AppMessageResult res = app_message_outbox_begin(&iterator);
+
+    if (res != APP_MSG_OK)
+    {
+        return false;
+    }
+
+    dict_write_uint8(iterator, 0, 16);
+    dict_write_uint8(iterator, 1, selected_index);
+    bluetooth_app_message_outbox_send();
+    return true;
+}
+
 static void receive_watch_packet(const DictionaryIterator* received)
 {
     const uint8_t packet_id = dict_find(received, 0)->value->uint8;
 
+    uint8_t* data = NULL;
+    size_t data_length = 0;
+    if (!read_packet_data(received, &data, &data_length))
+    {
+        return;
+    }
+
     switch (packet_id)
     {
     case 1:
@@ -189,10 +219,10 @@ static void receive_watch_packet(const DictionaryIterator* received)
         receive_sync_restart(received);
         break;
     case 3:
-        receive_sync_next_packet(received);
+        receive_sync_next_packet(data, data_length);
         break;
     case 5:
-        receive_notification_details_text_packet(received);
+        receive_notification_details_text_packet(data, data_length);
         break;
     case 7:
         receive_vibrate_packet(received);
@@ -201,7 +231,7 @@ static void receive_watch_packet(const DictionaryIterator* received)
         receive_submenu_packet(received);
         break;
     case 11:
-        receive_image_packet(received);
+        receive_image_packet(data, data_length);
         break;
     case 12:
         send_watch_welcome();
@@ -251,20 +281,14 @@ static void receive_sync_restart(const DictionaryIterator* iterator)
     bucket_sync_on_start_received(dict_entry->value->data, dict_entry->length);
 }
 
-static void receive_sync_next_packet(const DictionaryIterator* iterator)
+static void receive_sync_next_packet(uint8_t* data, const size_t data_length)
 {
-    // ReSharper disable once CppLocalVariableMayBeConst
-    Tuple* dict_entry = dict_find(iterator, 1);
-
-    bucket_sync_on_next_packet_received(dict_entry->value->data, dict_entry->length);
+    bucket_sync_on_next_packet_received(data, data_length);
 }
 
-static void receive_notification_details_text_packet(const DictionaryIterator* iterator)
+static void receive_notification_details_text_packet(const uint8_t* data, const size_t data_length)
 {
-    // ReSharper disable once CppLocalVariableMayBeConst
-    Tuple* dict_entry = dict_find(iterator, 1);
-
-    notification_details_fetcher_on_text_received(dict_entry->value->data, dict_entry->length);
+    notification_details_fetcher_on_text_received(data, data_length);
 }
 
 static void receive_vibrate_packet(const DictionaryIterator* iterator)
@@ -306,8 +330,57 @@ static void receive_submenu_packet(const DictionaryIterator* iterator)
     window_notification_data_receive_show_submenu(data_dict_entry->value->data, data_dict_entry->length);
 }
 
-static void receive_image_packet(const DictionaryIterator* iterator)
+static void receive_image_packet(const uint8_t* data, const size_t data_length)
 {
-    const Tuple* data_dict_entry = dict_find(iterator, 1);
-    window_image_show(data_dict_entry->value->data, data_dict_entry->length);
+    window_image_show(data, data_length);
+}
+
+/**
+ * Find the data (key 1) of the packet, decompressing it first if the phone sent it compressed.
+ * Packets without any data return NULL data. Returns false if the compressed data could not be decompressed.
+ */
+static bool read_packet_data(const DictionaryIterator* iterator, uint8_t** data, size_t* data_length)
+{
+    // ReSharper disable once CppLocalVariableMayBeConst
+    Tuple* dict_entry = dict_find(iterator, 1);
+    if (dict_entry != NULL)
+    {
+        *data = dict_entry->value->data;
+        *data_length = dict_entry->length;
+        return true;
+    }
+
+    const Tuple* compressed_dict_entry = dict_find(iterator, KEY_COMPRESSED_DATA);
+    if (compressed_dict_entry == NULL)
+    {
+        return true;
+    }
+
+    // Phone only compresses packets that would fit into the inbox uncompressed,
+    // so one inbox-sized buffer is enough for all of them
+    if (decompression_buffer == NULL)
+    {
+        decompression_buffer = malloc(appmessage_max_size);
+        if (decompression_buffer == NULL)
+        {
+            return false;
+        }
+    }
+
+    const int decompressed_length = decompress_packet_data(
+        compressed_dict_entry->value->data,
+        compressed_dict_entry->length,
+        decompression_buffer,
+        appmessage_max_size
+    );
+
+    if (decompressed_length < 0)
+    {
+        window_status_show_error("Corrupted data\n\nPlease try again");
+        return false;
+    }
+
+    *data = decompression_buffer;
+    *data_length = decompressed_length;
+    return true;
 }
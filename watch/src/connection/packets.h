@@ -9,4 +9,5 @@ void send_close_me();
 bool send_setting(uint8_t id, uint8_t value);
 bool send_reload_notifications();
 bool send_request_image(uint8_t notification_id, bool crop);
+bool send_move_window(uint8_t selected_index);
 void packets_init();
\ No newline at end of file
@@ -20,4 +20,15 @@ void reload_preferences()
     preferences.no_scroll_wrap = (bucket_data[0] & 0x04) != 0;
     preferences.enable_backlight_on_vibration = (bucket_data[0] & 0x08) != 0;
     preferences.auto_close_timeout = read_uint16_from_byte_array(bucket_data, 1);
+
+    if (bucket_sync_get_bucket_size(1) >= 5)
+    {
+        preferences.notification_count = bucket_data[3];
+        preferences.notification_window_start = bucket_data[4];
+    }
+    else
+    {
+        preferences.notification_count = 0;
+        preferences.notification_window_start = 0;
+    }
 }
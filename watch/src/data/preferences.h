@@ -8,6 +8,9 @@ typedef struct
     bool no_scroll_wrap;
     bool enable_backlight_on_vibration;
     uint16_t auto_close_timeout;
+    // Total number of notifications on the phone. Watch only stores a window of them, starting at the window start.
+    uint8_t notification_count;
+    uint8_t notification_window_start;
 } Preferences;
 
 extern Preferences preferences;
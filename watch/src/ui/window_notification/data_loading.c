@@ -15,6 +15,25 @@ static BucketList* buckets;
 
 static const uint32_t STORAGE_BUCKET_FLAGS_ID_MIN = 3000;
 
+// When the selected notification is this close to the edge of the window, phone is asked to move the window
+#define WINDOW_EDGE_MARGIN 3
+
+static int16_t last_requested_window_index = -1;
+
+// How long to wait for the bucket data after the bucket list changes, before the list is re-indexed anyway
+#define PENDING_INGEST_TIMEOUT_MS 500
+
+static AppTimer* pending_ingest_timer = NULL;
+
+static void cancel_pending_ingest()
+{
+    if (pending_ingest_timer != NULL)
+    {
+        app_timer_cancel(pending_ingest_timer);
+        pending_ingest_timer = NULL;
+    }
+}
+
 static void apply_date_to_body()
 {
     const time_t current_unix_time = time(NULL);
@@ -64,6 +83,16 @@ static void reload_data_for_current_bucket()
         window_notification_data.icon = NULL;
     }
 
+    if (window_notification_data.currently_selected_bucket == 0)
+    {
+        // Notification is outside the window. Wait for the phone to move the window.
+        strcpy(window_notification_data.title_text, "");
+        strcpy(window_notification_data.subtitle_text, "");
+        strcpy(window_notification_data.body_text, "Loading...");
+        window_notification_ui_redraw_scroller_content();
+        return;
+    }
+
     if (!bucket_sync_load_bucket(window_notification_data.currently_selected_bucket, bucket_data))
     {
         // Bucket is not on the device yet. Show blank for now and wait for the buckets to load.
@@ -111,6 +140,29 @@ static uint8_t get_bucket_flags(const uint8_t id)
     return 0;
 }
 
+static void request_window_move(const uint8_t selected_index)
+{
+    if (last_requested_window_index == selected_index)
+    {
+        return;
+    }
+
+    if (send_move_window(selected_index))
+    {
+        last_requested_window_index = selected_index;
+    }
+}
+
+static bool is_near_window_edge(const uint8_t index_in_window)
+{
+    const bool more_before = window_notification_data.window_start > 0;
+    const bool more_after = window_notification_data.window_start + window_notification_data.window_bucket_count <
+        window_notification_data.bucket_count;
+
+    return (more_before && index_in_window < WINDOW_EDGE_MARGIN) ||
+        (more_after && index_in_window + WINDOW_EDGE_MARGIN >= window_notification_data.window_bucket_count);
+}
+
 void window_notification_data_select_bucket_on_index(const uint8_t target_index)
 {
     if (window_notification_data.currently_selected_bucket != 0)
@@ -135,6 +187,27 @@ void window_notification_data_select_bucket_on_index(const uint8_t target_index)
         }
     }
 
+    if (target_index >= window_notification_data.bucket_count)
+    {
+        window_notification_data_select_bucket_on_index(window_notification_data.bucket_count - 1);
+        return;
+    }
+
+    const int16_t target_index_in_window = target_index - window_notification_data.window_start;
+    if (target_index_in_window < 0 || target_index_in_window >= window_notification_data.window_bucket_count)
+    {
+        // Notification is not on the watch. Ask the phone to move the window to it.
+        window_notification_data.currently_selected_bucket = 0;
+        window_notification_data.currently_selected_bucket_index = target_index;
+        window_notification_data.num_actions = 0;
+
+        request_window_move(target_index);
+        reload_data_for_current_bucket();
+        window_notification_ui_on_bucket_selected();
+        window_notification_action_list_hide();
+        return;
+    }
+
     uint8_t index_without_settings = 0;
 
     for (int i = 0; i < buckets->count; i++)
@@ -143,7 +216,7 @@ void window_notification_data_select_bucket_on_index(const uint8_t target_index)
 
         if (id != 1)
         {
-            if (index_without_settings == target_index)
+            if (index_without_settings == target_index_in_window)
             {
                 window_notification_data.currently_selected_bucket = id;
                 window_notification_data.currently_selected_bucket_index = target_index;
@@ -162,6 +235,11 @@ void window_notification_data_select_bucket_on_index(const uint8_t target_index)
                 }
 
 
+                if (is_near_window_edge(index_without_settings))
+                {
+                    request_window_move(target_index);
+                }
+
                 reload_data_for_current_bucket();
                 window_notification_ui_on_bucket_selected();
                 window_notification_action_list_hide();
@@ -178,41 +256,47 @@ void window_notification_data_select_bucket_on_index(const uint8_t target_index)
 
 void notification_window_ingest_bucket_metadata()
 {
+    cancel_pending_ingest();
+
     if (!idle_handler_has_user_interacted_since_app_start && launch_reason() == APP_LAUNCH_PHONE)
     {
         // Force switch to the new notification after app is opened due to new notification
         window_notification_data.currently_selected_bucket = 0;
         window_notification_data.currently_selected_bucket_index = 0;
     }
+    const uint8_t window_start = preferences.notification_window_start;
     uint8_t count_without_settings = 0;
     int16_t current_bucket_index = -1;
     for (int i = 0; i < buckets->count; i++)
     {
         const uint8_t id = buckets->data[i].id;
         const uint8_t flags = buckets->data[i].flags;
+        const uint8_t index = window_start + count_without_settings;
+
+        if (id == 1 || index >= MAX_NOTIFICATIONS)
+        {
+            continue;
+        }
 
         if (is_notification_unread(flags, id))
         {
-            window_notification_data.dot_states[count_without_settings] = UNREAD;
+            window_notification_data.dot_states[index] = UNREAD;
         }
         else if ((flags & 0x02) != 0)
         {
-            window_notification_data.dot_states[count_without_settings] = PAUSED;
+            window_notification_data.dot_states[index] = PAUSED;
         }
         else
         {
-            window_notification_data.dot_states[count_without_settings] = NORMAL;
+            window_notification_data.dot_states[index] = NORMAL;
         }
 
         if (id == window_notification_data.currently_selected_bucket)
         {
-            current_bucket_index = count_without_settings;
+            current_bucket_index = index;
         }
 
-        if (id != 1)
-        {
-            count_without_settings++;
-        }
+        count_without_settings++;
     }
 
     if (count_without_settings == 0)
@@ -222,7 +306,27 @@ void notification_window_ingest_bucket_metadata()
         return;
     }
 
-    window_notification_data.bucket_count = count_without_settings;
+    if (window_start != window_notification_data.window_start)
+    {
+        last_requested_window_index = -1;
+    }
+
+    window_notification_data.window_start = window_start;
+    window_notification_data.window_bucket_count = count_without_settings;
+
+    // Phone might not have sent the new count yet, so make sure that the whole window is always counted
+    const uint8_t window_end = window_start + count_without_settings;
+    window_notification_data.bucket_count = MIN(MAX(preferences.notification_count, window_end), MAX_NOTIFICATIONS);
+
+    // Watch does not know the state of the notifications outside the window
+    for (int i = 0; i < window_notification_data.bucket_count; i++)
+    {
+        if (i < window_start || i >= window_end)
+        {
+            window_notification_data.dot_states[i] = NORMAL;
+        }
+    }
+
     window_notification_ui_on_bucket_list_updated();
 
     if (current_bucket_index != -1)
@@ -235,10 +339,29 @@ void notification_window_ingest_bucket_metadata()
     }
 }
 
+static void on_pending_ingest_timeout(void* context)
+{
+    pending_ingest_timer = NULL;
+    notification_window_ingest_bucket_metadata();
+}
+
 static void on_buckets_changed()
 {
     buckets = bucket_sync_get_bucket_list();
-    notification_window_ingest_bucket_metadata();
+
+    if (bucket_sync_is_currently_syncing)
+    {
+        // When the window moves, bucket list changes before the bucket 1 with the new window start arrives.
+        // Wait for the bucket data, so the buckets are not mapped to indexes with the old window start.
+        if (pending_ingest_timer == NULL)
+        {
+            pending_ingest_timer = app_timer_register(PENDING_INGEST_TIMEOUT_MS, on_pending_ingest_timeout, NULL);
+        }
+    }
+    else
+    {
+        notification_window_ingest_bucket_metadata();
+    }
 
     idle_handler_notify_notifications_updated();
 }
@@ -250,12 +373,21 @@ static void on_bucket_updated(const BucketMetadata bucket_metadata, void* contex
         // Settings update
         reload_preferences();
         idle_handler_register_timers();
+
+        // Settings bucket also carries the position of the notification window
+        notification_window_ingest_bucket_metadata();
         return;
     }
 
     const uint8_t new_notification_id = bucket_metadata.id;
     persist_delete(new_notification_id + STORAGE_BUCKET_FLAGS_ID_MIN);
 
+    if (pending_ingest_timer != NULL)
+    {
+        // Phone sends the bucket 1 before all other buckets of the same sync, so the window start is up to date now
+        notification_window_ingest_bucket_metadata();
+        return;
+    }
 
     uint8_t count_without_settings = 0;
     for (int i = 0; i < buckets->count; i++)
@@ -265,18 +397,23 @@ static void on_bucket_updated(const BucketMetadata bucket_metadata, void* contex
         if (id == new_notification_id)
         {
             const uint8_t flags = bucket_metadata.flags;
+            const uint8_t index = window_notification_data.window_start + count_without_settings;
+            if (index >= MAX_NOTIFICATIONS)
+            {
+                break;
+            }
 
             if ((flags & 0x01) != 0)
             {
-                window_notification_data.dot_states[count_without_settings] = UNREAD;
+                window_notification_data.dot_states[index] = UNREAD;
             }
             else if ((flags & 0x02) != 0)
             {
-                window_notification_data.dot_states[count_without_settings] = PAUSED;
+                window_notification_data.dot_states[index] = PAUSED;
             }
             else
             {
-                window_notification_data.dot_states[count_without_settings] = NORMAL;
+                window_notification_data.dot_states[index] = NORMAL;
             }
             window_notification_ui_on_bucket_list_updated();
             break;
@@ -385,6 +522,7 @@ void window_notification_data_init()
 
 void window_notification_data_deinit()
 {
+    cancel_pending_ingest();
     bucket_sync_set_bucket_list_change_callback(NULL);
     bucket_sync_clear_bucket_data_change_callback(on_bucket_updated, NULL);
 }
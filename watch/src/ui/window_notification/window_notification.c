@@ -27,6 +27,8 @@ NotificationWindowData window_notification_data = {
     .currently_selected_bucket = 0,
     .currently_selected_bucket_index = 0,
     .bucket_count = 0,
+    .window_start = 0,
+    .window_bucket_count = 0,
     .open_menu_on_success = 0,
     .icon = NULL,
 };
@@ -5,6 +5,8 @@
 #include "ui/layers/status_bar.h"
 
 #define MAX_BODY_TEXT_SIZE 4000
+// Max number of notifications in the list. Only a window of them is stored in the buckets on the watch.
+#define MAX_NOTIFICATIONS 100
 
 typedef struct
 {
@@ -25,9 +27,15 @@ typedef struct
     bool active;
 
     uint8_t currently_selected_bucket;
+    // Index of the selected notification in the full list of notifications (including those outside the window)
     int16_t currently_selected_bucket_index;
+    // Number of all notifications (including those outside the window)
     uint8_t bucket_count;
-    enum DotState dot_states[14];
+    // Index of the first notification in the window
+    uint8_t window_start;
+    // Number of notifications in the window
+    uint8_t window_bucket_count;
+    enum DotState dot_states[MAX_NOTIFICATIONS];
 
     uint8_t title_font;
     char title_text[21];
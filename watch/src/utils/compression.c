@@ -0,0 +1,69 @@
+#include "compression.h"
+#include "commons/bytes.h"
+
+#define MIN_MATCH_LENGTH 3
+
+int decompress_packet_data(const uint8_t* input, const size_t input_length, uint8_t* output, const size_t output_capacity)
+{
+    if (input_length < 2)
+    {
+        return -1;
+    }
+
+    const size_t output_length = read_uint16_from_byte_array(input, 0);
+    if (output_length > output_capacity)
+    {
+        return -1;
+    }
+
+    size_t input_position = 2;
+    size_t output_position = 0;
+
+    while (input_position < input_length)
+    {
+        const uint8_t control = input[input_position++];
+
+        if ((control & 0x80) == 0)
+        {
+            // Literal run
+            const size_t run_length = control + 1;
+            if (input_position + run_length > input_length || output_position + run_length > output_length)
+            {
+                return -1;
+            }
+
+            memcpy(&output[output_position], &input[input_position], run_length);
+            input_position += run_length;
+            output_position += run_length;
+        }
+        else
+        {
+            // Back-reference into the already decompressed data
+            if (input_position >= input_length)
+            {
+                return -1;
+            }
+
+            const size_t match_length = ((control >> 3) & 0x0F) + MIN_MATCH_LENGTH;
+            const size_t offset = (((control & 0x07) << 8) | input[input_position++]) + 1;
+            if (offset > output_position || output_position + match_length > output_length)
+            {
+                return -1;
+            }
+
+            // Match can overlap with the bytes it is producing, so it has to be copied byte by byte
+            for (size_t i = 0; i < match_length; i++)
+            {
+                output[output_position] = output[output_position - offset];
+                output_position++;
+            }
+        }
+    }
+
+    if (output_position != output_length)
+    {
+        return -1;
+    }
+
+    return (int) output_position;
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <pebble.h>
+
+/**
+ * Decompress data, compressed by the phone (see "Compression" in protocol.md) into the output buffer.
+ * Returns number of decompressed bytes or -1 if data is corrupted or does not fit into the output buffer.
+ */
+int decompress_packet_data(const uint8_t* input, size_t input_length, uint8_t* output, size_t output_capacity);